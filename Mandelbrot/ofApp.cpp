@@ -16,8 +16,30 @@ void ofApp::setup(){
 
 	//  write mandelbrot to an image
 	//
+	if (bBenchmark) image.setUseTexture(false);		// no GL context when headless
 	image.allocate(1000, 1000, OF_IMAGE_COLOR);
 
+	if (bBenchmark) {
+		runBenchmark();
+		ofExit(check.passed() ? 0 : 1);
+		return;
+	}
+
+	mandelbrot();
+	saver.save(image.getPixels(), "mandelbrot.jpg");
+	saver.flush();
+
+	// hack - I couldn't get image to draw from memory without saving it out 
+	//        to an image on disk first.
+	//
+	im.loadImage("mandelbrot.jpg");
+}
+
+//  fill image with the set, returns the total number of iterations run
+//
+uint64_t ofApp::mandelbrot() {
+	uint64_t iterations = 0;
+
 	for (int y = 0; y < image.getHeight(); y++) {
 		for (int x = 0; x < image.getWidth(); x++) {
 
@@ -47,6 +69,7 @@ void ofApp::setup(){
 				a = r;
 				b = im;
 			}
+			iterations += i;
 			if (i < MAX_ITERATIONS) {
 				image.setColor(x, y, ofColor::black);
 			}
@@ -61,12 +84,25 @@ void ofApp::setup(){
 
 
 	}
-	image.save("mandelbrot.jpg");
+	return iterations;
+}
 
-	// hack - I couldn't get image to draw from memory without saving it out 
-	//        to an image on disk first.
-	//
-	im.loadImage("mandelbrot.jpg");
+//  time the 1000x1000 image and append the result to benchmark.json
+//  (run with --benchmark), with --check the image and time are also compared
+//  against bin/data/golden/ (see regression.h)
+//
+void ofApp::runBenchmark() {
+	Benchmark bench("Mandelbrot");
+
+	bench.start();
+	uint64_t iterations = mandelbrot();
+	double seconds = bench.stop();
+	bench.add("mandelbrot", seconds, { { "pixels", image.getWidth() * image.getHeight() }, { "iterations", (double)iterations } });
+	check.image("mandelbrot", image.getPixels());
+	check.time("mandelbrot", seconds);
+
+	bench.print();
+	bench.save("benchmark.json");
 }
 
 
@@ -75,6 +111,11 @@ void ofApp::update(){
 
 }
 
+//--------------------------------------------------------------
+void ofApp::exit(){
+	saver.flush();		//make sure the last render is on disk before we quit
+}
+
 //--------------------------------------------------------------
 void ofApp::draw(){
 	ofSetColor(255, 255, 255);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "ofMain.h"
+#include "benchmark.h"
+#include "regression.h"
+#include "imageSaver.h"
 
 class ofApp : public ofBaseApp{
 
@@ -8,6 +11,7 @@ class ofApp : public ofBaseApp{
 		void setup();
 		void update();
 		void draw();
+		void exit();
 
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -21,6 +25,12 @@ class ofApp : public ofBaseApp{
 		void dragEvent(ofDragInfo dragInfo);
 		void gotMessage(ofMessage msg);
 
+		uint64_t mandelbrot();
+		void runBenchmark();
+
 		ofImage image, im;
+		ImageSaver saver;			// encodes images on a background thread
+		bool bBenchmark = false;	// set by --benchmark in main()
+		RegressionCheck check;		// golden image and timing checks (--check)
 		
 };
@@ -1,13 +1,55 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "ofAppNoWindow.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char *argv[]){
+	ofApp *app = new ofApp();
+
+	// --benchmark renders the canonical scene without a window, appends the
+	// timings to bin/data/benchmark.json and exits
+	// --check also compares the renders against bin/data/golden/ and exits
+	// with 1 on a regression, --bless rewrites the references
+	// --psnr <dB> and --slowdown <fraction> set the tolerances
+	// --jpeg-quality <best|high|medium|low|worst> sets how much JPG renders are compressed (best)
+	// --threads <n> renders with n threads instead of one per core
+	// --fd-normals takes every normal from finite differences, even where the object has sdfDual()
+	// --relax <w> ray marches with over-relaxed steps of w * dist (1.2 - 1.9)
+	// --no-cones marches every primary ray from the camera, without the cone pre-pass
+	// --heatmap also writes the march steps of every pixel to marchHeatmap.PNG,
+	// how each one ended to marchEnd.PNG and a histogram to marchHistogram.txt
+	// --no-packets marches the primary rays one at a time instead of 8 at once
+	// --repeat-count <n> renders an n x n x n grid of the scene instead of an endless one
+	//
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--benchmark") app->bBenchmark = true;
+		else if (arg == "--check") app->check.enabled = true;
+		else if (arg == "--bless") app->check.enabled = app->check.bless = true;
+		else if (arg == "--psnr" && i + 1 < argc) app->check.minPSNR = ofToFloat(argv[++i]);
+		else if (arg == "--slowdown" && i + 1 < argc) app->check.maxSlowdown = ofToFloat(argv[++i]);
+		else if (arg == "--jpeg-quality" && i + 1 < argc) app->saver.setQuality(ImageSaver::qualityFromName(argv[++i]));
+		else if (arg == "--threads" && i + 1 < argc) app->numThreads = ofToInt(argv[++i]);
+		else if (arg == "--fd-normals") app->bDualNormals = false;
+		else if (arg == "--relax" && i + 1 < argc) app->relaxation = ofToFloat(argv[++i]);
+		else if (arg == "--no-cones") app->bCones = false;
+		else if (arg == "--heatmap") app->bHeatmap = true;
+		else if (arg == "--no-packets") app->bPackets = false;
+		else if (arg == "--repeat-count" && i + 1 < argc) app->repeatCount = glm::ivec3(ofToInt(argv[++i]));
+	}
+	if (app->check.enabled) app->bBenchmark = true;
+
+	if (app->bBenchmark) {
+		ofAppNoWindow window;
+		ofSetupOpenGL(&window, 1024, 768, OF_WINDOW);
+		return ofRunApp(app);
+	}
+
 	ofSetupOpenGL(1024,768,OF_WINDOW);			// <-------- setup the GL context
 
 	// this kicks off the running of my app
 	// can be OF_WINDOW or OF_FULLSCREEN
 	// pass in width and height too:
-	ofRunApp(new ofApp());
+	ofRunApp(app);
 
 }
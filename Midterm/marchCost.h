@@ -0,0 +1,123 @@
+#pragma once
+
+#include "ofMain.h"
+#include "imageSaver.h"
+#include <array>
+#include <iomanip>
+
+//  What marching one ray (or all the rays of a pixel) cost and how it ended.
+//
+struct MarchCost {
+	enum End { HIT, ESCAPED, OUT_OF_STEPS };	// worst last: a pixel shows the worst of its rays
+
+	int steps = 0;			// march steps
+	int evals = 0;			// object sdf evaluations
+	End end = HIT;			// why the march stopped
+
+	void add(const MarchCost &ray) {
+		steps += ray.steps;
+		evals += ray.evals;
+		end = std::max(end, ray.end);
+	}
+};
+
+//  A per-pixel record of MarchCost next to the beauty image, for seeing where
+//  the marcher spends its time.  The render fills in at() for every pixel
+//  (each pixel from one thread only, so no locking), then save() writes
+//
+//		<prefix>Heatmap.PNG		steps per pixel, blue (few) through red (maxSteps)
+//		<prefix>End.PNG			green for hits, blue for escapes past MAX_DISTANCE,
+//								red for rays that ran out of steps
+//		<prefix>Histogram.txt	pixels per range of steps, split by how they ended
+//
+//  and prints the histogram.
+//
+class MarchCostPass {
+public:
+	void allocate(int w, int h) {
+		width = w;
+		height = h;
+		pixels.assign(w * h, MarchCost());
+	}
+
+	bool isAllocated() const { return !pixels.empty(); }
+
+	//  x, y in image rows, the same as ofImage::setColor()
+	MarchCost &at(int x, int y) { return pixels[y * width + x]; }
+
+	//  blue -> cyan -> green -> yellow -> red as v goes from 0 to 1
+	static ofColor ramp(float v) {
+		v = ofClamp(v, 0, 1) * 4;
+		int band = std::min((int)v, 3);
+		float f = v - band;
+		switch (band) {
+		case 0: return ofColor(0, 255 * f, 255);
+		case 1: return ofColor(0, 255, 255 * (1 - f));
+		case 2: return ofColor(255 * f, 255, 0);
+		default: return ofColor(255, 255 * (1 - f), 0);
+		}
+	}
+
+	void heatmap(ofPixels &out, int maxSteps) const {
+		out.allocate(width, height, OF_IMAGE_COLOR);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				out.setColor(x, y, ramp((float)pixels[y * width + x].steps / maxSteps));
+			}
+		}
+	}
+
+	void ends(ofPixels &out) const {
+		static const ofColor colors[] = { ofColor(0, 200, 0), ofColor(0, 0, 200), ofColor(255, 0, 0) };
+		out.allocate(width, height, OF_IMAGE_COLOR);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				out.setColor(x, y, colors[pixels[y * width + x].end]);
+			}
+		}
+	}
+
+	//  one line per range of maxSteps / bins steps: the pixels that ended each
+	//  way, with the totals and the mean steps and evaluations at the end
+	//
+	string histogram(int maxSteps, int bins = 20) const {
+		vector<array<int, 3>> counts(bins, array<int, 3>{ {0, 0, 0} });
+		uint64_t steps = 0, evals = 0;
+		int ended[3] = { 0, 0, 0 };
+		for (const MarchCost &c : pixels) {
+			int bin = std::min(c.steps * bins / std::max(maxSteps, 1), bins - 1);
+			counts[bin][c.end]++;
+			ended[c.end]++;
+			steps += c.steps;
+			evals += c.evals;
+		}
+
+		stringstream ss;
+		ss << left << setw(11) << "steps" << right << setw(8) << "hit" << setw(10) << "escaped" << setw(14) << "out of steps" << "\n";
+		for (int b = 0; b < bins; b++) {
+			ss << setw(5) << b * maxSteps / bins << "-" << left << setw(5) << (b + 1) * maxSteps / bins - 1 << right;
+			for (int e = 0; e < 3; e++) ss << setw(e == 0 ? 8 : e == 1 ? 10 : 14) << counts[b][e];
+			ss << "\n";
+		}
+		int n = std::max((int)pixels.size(), 1);
+		ss << left << setw(11) << "total" << right << setw(8) << ended[0] << setw(10) << ended[1] << setw(14) << ended[2] << "\n";
+		ss << "mean steps " << (double)steps / n << ", mean sdf evals " << (double)evals / n << " per pixel\n";
+		return ss.str();
+	}
+
+	void save(ImageSaver &saver, const string &prefix, int maxSteps) const {
+		ofPixels out;
+		heatmap(out, maxSteps);
+		saver.save(out, prefix + "Heatmap.PNG");
+		ends(out);
+		saver.save(out, prefix + "End.PNG");
+
+		string text = histogram(maxSteps);
+		ofstream file(ofToDataPath(prefix + "Histogram.txt"));
+		file << text;
+		cout << text;
+	}
+
+	int width = 0, height = 0;
+	vector<MarchCost> pixels;
+};
@@ -106,6 +106,14 @@ void ofApp::setup() {
 
 	lights.push_back(new Light(60, glm::vec3(0, 20, 0), false));
 
+	//there is no GL context to back the textures when running headless
+	if (bBenchmark)
+	{
+		image.setUseTexture(false);
+		map.setUseTexture(false);
+		texture.setUseTexture(false);
+	}
+
 	image.allocate(imageW, imageH, ofImageType::OF_IMAGE_COLOR);		//allocates an image with desired dimensions
 	map.allocate(imageW, imageH, ofImageType::OF_IMAGE_COLOR);
 	
@@ -122,6 +130,11 @@ void ofApp::setup() {
 	gui.add(tValue.setup("t", ofVec2f(2, 0.75), ofVec2f(0, 0), ofVec2f(10, 10)));
 	bHide = false;
 
+	if (bBenchmark)
+	{
+		runBenchmark();
+		ofExit(check.passed() ? 0 : 1);
+	}
 }
 
 void ofApp::printChannel()
@@ -173,6 +186,11 @@ void ofApp::update(){
 
 }
 
+//--------------------------------------------------------------
+void ofApp::exit(){
+	saver.flush();		//make sure the last render is on disk before we quit
+}
+
 // draws a three plane coordinate axis for reference
 void ofApp::drawAxis(glm::vec3 pos)
 {
@@ -193,6 +211,7 @@ bool ofApp::isShadow(const Ray &r)
 {
 	glm::vec3 hp;
 	glm::vec3 nor;
+	rayCount++;
 
 	//loop through all the scene objects and see if any of them block a ray to a light source
 	for (int i = 0; i < scene.size(); i++)
@@ -212,6 +231,7 @@ bool ofApp::isSpotlightShadow(const Ray &r, const Light &l)
 {
 	glm::vec3 hp; 
 	glm::vec3 norm;
+	rayCount++;
 
 	for (int i = 0; i < scene.size(); i++)
 	{
@@ -227,20 +247,6 @@ bool ofApp::isSpotlightShadow(const Ray &r, const Light &l)
 	return false;
 }
 
-bool ofApp::isSpotlightShadowRM(const Ray &r, const Light &l)
-{
-	glm::vec3 hp;
-	if (rayMarch(r, hp))
-	{
-		if (inSpotLight(l, hp))
-		{
-			return true;
-		}
-	}
-
-	return false;
-}
-
 //function that checks to see if a point is within the scope of a spotlight
 //by comparing angles
 bool ofApp::inSpotLight(const Light &l, const glm::vec3 &p)
@@ -334,13 +340,6 @@ ofColor ofApp::allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColo
 					//tempColor = ofColor(0, 0, 0);		//if your in a shadow, then no light is reaching resulting in no color
 				}
 			}
-			else
-			{
-				if (isSpotlightShadowRM(r2, *lights[i]))
-				{
-					//tempColor = ofColor::black;			//if your in a shadow, then no light is reaching resulting in no color
-				}
-			}
 
 		}
 		else
@@ -352,14 +351,6 @@ ofColor ofApp::allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColo
 					//tempColor = ofColor(0, 0, 0);		//if your in a shadow, then no light is reaching resulting in no color
 				}
 			}
-			else
-			{
-				glm::vec3 hp;
-				if (rayMarch(r2, hp))
-				{
-					//tempColor = ofColor::black;			//if your in a shadow, then no light is reaching resulting in no color
-				}
-			}
 
 		}		//but of course if a scene has multiple lights and 1 >= more reaches that point, it'll start to show color and the shadow gets dimmer
 
@@ -381,248 +372,735 @@ ofColor ofApp::lookup(float u, float v)
 	return texture.getColor((int)fmod(i, texture.getWidth()), (int)fmod(j, texture.getHeight()));
 }
 
-// Ray Tracing algorithm to render an image
-// Invoked with the key 't'
-void ofApp::rayTrace()
-{	
-	
-	//for each pixel
-	for (int i = 0; i < imageW; i++)
+//traces the supersamples for pixel (i, j) and returns their average color
+//j counts up from the bottom of the image, the callers flip it into image rows
+ofColor ofApp::tracePixel(int i, int j)
+{
+	ofColor superColor = ofColor::black;
+	for (int p = 0; p < 4; p++)
 	{
-		int row = imageH - 1;
-		for (int j = 0; j < imageH; j++)
-		{		
-			ofColor superColor = ofColor::black;
-			for (int p = 0; p < 4; p++)
+		for (int q = 0; q < 4; q++)
+		{
+			//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
+			float u = (i + ((p + 0.5) / 4)) / imageW;
+			float v = (j + ((q + 0.5) / 4))  / imageH;
+			Ray r = renderCam.getRay(u, v);
+			rayCount++;
+
+			vector<float> distance;			//vector to hold all the distances in of objects from the renderCam
+			bool hit = false;				//boolean to signal an intersect 
+			int index = 0;					//index to scene vector to know what object was intersected
+			vector<glm::vec3> points;
+			vector<glm::vec3> n;
+			//check if the ray intersects with any object in the scene
+			for (int k = 0; k < scene.size(); k++)
 			{
-				for (int q = 0; q < 4; q++)
+				if (scene[k]->intersect(r, hitpoint, normal))
 				{
-					//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
-					float u = (i + ((p + 0.5) / 4)) / imageW;
-					float v = (j + ((q + 0.5) / 4))  / imageH;
-					Ray r = renderCam.getRay(u, v);
-
-					vector<float> distance;			//vector to hold all the distances in of objects from the renderCam
-					bool hit = false;				//boolean to signal an intersect 
-					int index = 0;					//index to scene vector to know what object was intersected
-					vector<glm::vec3> points;
-					vector<glm::vec3> n;
-					//check if the ray intersects with any object in the scene
-					for (int k = 0; k < scene.size(); k++)
-					{
-						if (scene[k]->intersect(r, hitpoint, normal))
-						{
-							//printf("scene index: %d\n", k);
-							hit = true;
-							float dist = glm::length(scene[k]->position - renderCam.position);
-							distance.push_back(dist);
-							index = k;							//set the index to the index in the scene vector
-							points.push_back(hitpoint);
-							n.push_back(normal);
-						}
-						else
-						{
-							distance.push_back(std::numeric_limits<float>::infinity());			//default big distance if nothing was intersected
-																//ensures that distance elements line up with scene elements 
-																//ex) distance[0] refers to distance from scene[0] to renderCam, etc... 
-							points.push_back(glm::vec3(0, 0, 0));
-							n.push_back(glm::vec3(0, 0, 0));
+					//printf("scene index: %d\n", k);
+					hit = true;
+					float dist = glm::length(scene[k]->position - renderCam.position);
+					distance.push_back(dist);
+					index = k;							//set the index to the index in the scene vector
+					points.push_back(hitpoint);
+					n.push_back(normal);
+				}
+				else
+				{
+					distance.push_back(std::numeric_limits<float>::infinity());			//default big distance if nothing was intersected
+														//ensures that distance elements line up with scene elements 
+														//ex) distance[0] refers to distance from scene[0] to renderCam, etc... 
+					points.push_back(glm::vec3(0, 0, 0));
+					n.push_back(glm::vec3(0, 0, 0));
 
-						}
-					}
+				}
+			}
 
-					//setColor follows (i, row, ofColor) format to flip and mirror the rendered image so that it matches 
-					//what is expected to be seen as viewed from the view plane
-					if (hit)
+			//setColor follows (i, row, ofColor) format to flip and mirror the rendered image so that it matches 
+			//what is expected to be seen as viewed from the view plane
+			if (hit)
+			{
+
+				if (distance.size() == 1)
+				{
+					//first element is the plane so use the texture map
+					if (index == 0)
+					{
+						//get the coordinates of the hitpoint
+						float x = hitpoint.x + (pWidth / 2);
+						float z = hitpoint.z + (pHeight / 2);
+						//convert hitpoint coordinates to uv coordinates
+						float uu = (x + .5) / pWidth;
+						float vv = (z + .5) / pHeight;
+						ofColor fc = allShader(hitpoint, normal, lookup(uu*squares, vv*squares), scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, fc);
+						superColor += fc/4;			//prevents adding too much color since were getting more color samples per pixel
+					}
+					else
 					{
+						ofColor objColor = allShader(hitpoint, normal, scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, objColor);
+						superColor += objColor/4;	//denominator should match the pq loop variant 
+					}
 
-						if (distance.size() == 1)
+				}
+				else
+				{
+					//finds the closest object in the scene to the renderCam
+					float c = std::numeric_limits<float>::infinity();		//the shortest distance to the renderCam
+					for (int a = 0; a < distance.size(); a++)
+					{
+						//sets the closest object to the renderCam
+						if (distance[a] < c)
 						{
-							//first element is the plane so use the texture map
-							if (index == 0)
-							{
-								//get the coordinates of the hitpoint
-								float x = hitpoint.x + (pWidth / 2);
-								float z = hitpoint.z + (pHeight / 2);
-								//convert hitpoint coordinates to uv coordinates
-								float uu = (x + .5) / pWidth;
-								float vv = (z + .5) / pHeight;
-								ofColor fc = allShader(hitpoint, normal, lookup(uu*squares, vv*squares), scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, fc);
-								superColor += fc/4;			//prevents adding too much color since were getting more color samples per pixel
-							}
-							else
-							{
-								ofColor objColor = allShader(hitpoint, normal, scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, objColor);
-								superColor += objColor/4;	//denominator should match the pq loop variant 
-							}
+							//updates the closest distance and the index of that object in the scene vector
+							c = distance[a];
+							index = a;
+							//cout << c << " " << index << endl;
 
 						}
-						else
-						{
-							//finds the closest object in the scene to the renderCam
-							float c = std::numeric_limits<float>::infinity();		//the shortest distance to the renderCam
-							for (int a = 0; a < distance.size(); a++)
-							{
-								//sets the closest object to the renderCam
-								if (distance[a] < c)
-								{
-									//updates the closest distance and the index of that object in the scene vector
-									c = distance[a];
-									index = a;
-									//cout << c << " " << index << endl;
-
-								}
-							}
-
-							//ofColor col = lambert(points[index], n[index], scene[index]->diffuseColor) + //ambient +
-							//	phong(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power);
-							//image.setColor(i, row, putShadow(points[index], col));	//set color of pixel to value computed from hit point
-							//first element is the plane so use the texture map
-							if (index == 0)
-							{
-								//gets the coordinates of the closest object 
-								float x = points[index].x + (pWidth / 2);
-								float z = points[index].z + (pHeight / 2);
-								//convert those coordinates to uv coordinates
-								float uu = (x + .5) / pWidth;
-								float vv = (z + .5) / pHeight;
-								ofColor fc = allShader(points[index], n[index], lookup(uu*squares, v*squares), scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, fc);
-								superColor += fc/4;
-							}
-							else
-							{
-								ofColor objColor = allShader(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, objColor);
-								superColor += objColor/4;
-							}
-
+					}
 
-						}
+					//ofColor col = lambert(points[index], n[index], scene[index]->diffuseColor) + //ambient +
+					//	phong(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power);
+					//image.setColor(i, row, putShadow(points[index], col));	//set color of pixel to value computed from hit point
+					//first element is the plane so use the texture map
+					if (index == 0)
+					{
+						//gets the coordinates of the closest object 
+						float x = points[index].x + (pWidth / 2);
+						float z = points[index].z + (pHeight / 2);
+						//convert those coordinates to uv coordinates
+						float uu = (x + .5) / pWidth;
+						float vv = (z + .5) / pHeight;
+						ofColor fc = allShader(points[index], n[index], lookup(uu*squares, v*squares), scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, fc);
+						superColor += fc/4;
 					}
 					else
 					{
-						//image.setColor(i, row, ofColor::black);			//set the background color to black
-						//image.setColor(i, row, ambient);				//set the background color to the ambient color
-						superColor += ofColor::black;
+						ofColor objColor = allShader(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, objColor);
+						superColor += objColor/4;
 					}
-					//row--;
+
+
 				}
 			}
-			image.setColor(i, row, superColor);	//we are outside the pq loop, so we can now set the image pixel
+			else
+			{
+				//image.setColor(i, row, ofColor::black);			//set the background color to black
+				//image.setColor(i, row, ambient);				//set the background color to the ambient color
+				superColor += ofColor::black;
+			}
+			//row--;
+		}
+	}
+	return superColor;
+}
+
+// Ray Tracing algorithm to render an image
+// Invoked with the key 't'
+void ofApp::rayTrace()
+{	
+	
+	//for each pixel
+	for (int i = 0; i < imageW; i++)
+	{
+		int row = imageH - 1;
+		for (int j = 0; j < imageH; j++)
+		{		
+			image.setColor(i, row, tracePixel(i, j));	//we are outside the pq loop, so we can now set the image pixel
 			row--;
 			
 		}
 		
 	}
 	
-	image.save("traceImage.PNG");	//put result into an image
+	saver.save(image.getPixels(), "traceImage.PNG");	//put result into an image
 }
 
-//returns the normal from a given point for any object using distances
-glm::vec3 ofApp::getNormalRM(const glm::vec3 &p)
+//the normal at p, the gradient of the scene sdf there
+//id is the object closest to p if the caller knows it (the one a ray hit),
+//otherwise it's looked up.  objects that can evaluate their sdf over Duals
+//give the gradient in one pass, for everything else it comes from finite
+//differences eps apart over the whole scene (marchPixel() widens eps with distance)
+glm::vec3 ofApp::getNormalRM(const glm::vec3 &p, float eps, int id)
 {
-	float eps = 0.01;
-	float dp = sceneSDF(p);
-	glm::vec3 n(dp - sceneSDF(glm::vec3(p.x-eps, p.y, p.z)), 
-				dp - sceneSDF(glm::vec3(p.x, p.y-eps, p.z)),
-				dp - sceneSDF(glm::vec3(p.x, p.y, p.z-eps)));
+	if (bDualNormals)
+	{
+		if (id < 0)
+		{
+			SceneHit closest = sceneQuery(p);
+			sdfCount += closest.evals;
+			id = closest.id;
+		}
+		Dual dist;
+		if (id >= 0 && scene[id]->sdfDual(Dual3::point(p), dist) && glm::length(dist.d) > 0)
+		{
+			sdfCount++;
+			return glm::normalize(dist.d);
+		}
+	}
+
+	SceneHit dp = sceneQuery(p);
+	SceneHit dx = sceneQuery(glm::vec3(p.x-eps, p.y, p.z));
+	SceneHit dy = sceneQuery(glm::vec3(p.x, p.y-eps, p.z));
+	SceneHit dz = sceneQuery(glm::vec3(p.x, p.y, p.z-eps));
+	sdfCount += dp.evals + dx.evals + dy.evals + dz.evals;
+	glm::vec3 n(dp.dist - dx.dist, 
+				dp.dist - dy.dist,
+				dp.dist - dz.dist);
 	return glm::normalize(n); 
 }
 
-//returns the closest distance to the scene
-float ofApp::sceneSDF(const glm::vec3 &p)
+//returns the distance to the closest object in the scene and which object it is
+//this only reads the scene, so the render threads can all call it at once
+//
+//the object with the nearest bound is evaluated first, after that any object
+//whose bound is already further than the best distance so far can't win and
+//its full sdf is skipped, so only the objects near p cost anything
+SceneHit ofApp::sceneQuery(const glm::vec3 &p) const
 {
-	float closestDist = std::numeric_limits<float>::infinity();
+	SceneHit closest = { std::numeric_limits<float>::infinity(), -1, 0 };
+	if (scene.empty()) return closest;
+
+	int nearest = 0;
+	float nearestBound = std::numeric_limits<float>::infinity();
+	for (int i = 0; i < scene.size(); i++)
+	{
+		float bound = scene[i]->sdfBound(p);
+		if (bound < nearestBound || i == 0)
+		{
+			nearestBound = bound;
+			nearest = i;
+		}
+	}
+	closest.dist = scene[nearest]->sdf(p);
+	closest.id = nearest;
+	closest.evals = 1;
+
 	for (int i = 0; i < scene.size(); i++)
 	{
+		if (i == nearest || scene[i]->sdfBound(p) >= closest.dist) continue;
+
 		float dist = scene[i]->sdf(p);
+		closest.evals++;
 		//cout << "dist: " << dist << endl;
-		if (dist < closestDist)
+		if (dist < closest.dist)
 		{
-			closestDist = dist;
-			sceneIdx = i;
+			closest.dist = dist;
+			closest.id = i;
 		}
 	}
 
-	return closestDist;
+	return closest;
+}
+
+//returns the closest distance to the scene
+float ofApp::sceneSDF(const glm::vec3 &p) const
+{
+	return sceneQuery(p).dist;
 }
 
 //this utilizes the ray marching algorithm to be used instead of the standard ray intersect method used prior
 //ray marches across the ray to determine if an object is hit or not
-bool ofApp::rayMarch(Ray r, glm::vec3 &p)
+//id is set to the index of the object that was hit, tStart is how far along r
+//the march starts (nothing may be closer than that, see coneMarch())
+//cost, if given, gets the steps and sdf evaluations the march took and how it ended
+//
+//a hit is closer than DIST_THRESHOLD, or for primary rays closer than the
+//ray's share of its pixel at that distance, footprint * t (see pixelFootprint()),
+//whichever is bigger.  far away a pixel covers more than DIST_THRESHOLD and
+//the steps to get any closer than that can't show up in the image
+bool ofApp::rayMarch(const Ray &r, glm::vec3 &p, int &id, float tStart, float footprint, MarchCost *cost)
 {
+	SceneHit closest;
+	int evals = 0, steps;
+	rayCount++;
+
+	//the compiled scene, keeping hold of which object each distance came from
+	bool hit = march([&](const glm::vec3 &q)
+	{
+		closest = program.eval(q);
+		evals += closest.evals;
+		return closest.dist;
+	}, r, p, steps, tStart, footprint);
+
+	if (hit) id = closest.id;
+	sdfCount += evals;		//added once per ray since every thread shares the counter
+	stepCount += steps;
+	if (cost)
+	{
+		cost->steps = steps;
+		cost->evals = evals;
+		cost->end = hit ? MarchCost::HIT : closest.dist > MAX_DISTANCE ? MarchCost::ESCAPED : MarchCost::OUT_OF_STEPS;
+	}
+	return hit;
+}
+
+//the angle (radius) each primary ray covers, so at distance t along the ray
+//it stands for a disc of radius pixelFootprint() * t.  the render camera looks
+//straight down z at the view plane
+float ofApp::pixelFootprint()
+{
+	float focal = fabs(renderCam.view.position.z - renderCam.position.z);
+	float pixel = std::max(renderCam.view.width() / imageW, renderCam.view.height() / imageH);
+	return 0.5f * pixel / focal;
+}
+
+//ray marches pixel (i, j) and returns its color
+//j counts up from the bottom of the image, the callers flip it into image rows
+//the rays start tStart from the camera, and what they cost is added to cost
+ofColor ofApp::marchPixel(int i, int j, float tStart, MarchCost *cost)
+{
+	ofColor superColor = ofColor::black;
+	float footprint = pixelFootprint();
+	
+	//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
+	float u = (i + 0.5) / imageW;
+	float v = (j + 0.5) / imageH;
+	Ray r = renderCam.getRay(u, v);
+
 	bool hit = false;
-	p = r.p;				//r.p == vec3(0, 0, 17) "from"
+	glm::vec3 pointOfIntersect;
+	int id = 0;
+	MarchCost rayCost;
+	hit = rayMarch(r, pointOfIntersect, id, tStart, footprint, &rayCost);
+	if (cost) cost->add(rayCost);
+	if (hit)
+	{
+		superColor += shadeMarch(pointOfIntersect, id, std::max(0.01f, footprint * glm::distance(pointOfIntersect, r.p)));
+	}
+	else
+	{
+		superColor += ofColor::black;
+	}
+	return superColor;
+}
 
-	for (int i = 0; i < MAX_RAY_STEPS; i++)
+//color of a primary ray that hit object id at p, eps goes to getNormalRM()
+ofColor ofApp::shadeMarch(const glm::vec3 &p, int id, float eps)
+{
+	glm::vec3 norm = getNormalRM(p, eps, id);
+	ofColor objColor = allShader(p, norm, scene[id]->diffuseColor, scene[id]->specularColor, power, scene[id]);
+	//ofColor objColor = lambert(p, norm, scene[id]->diffuseColor);
+	return objColor*2;
+}
+
+//builds the distance field graph of the scene, every object repeated through
+//space with the same period (repeatCount times, or without end), and compiles
+//it into the program rayMarch() runs.
+//called before each render so edits to the scene are picked up
+void ofApp::compileScene()
+{
+	SDFGraph graph;
+	int root = -1;
+	for (int i = 0; i < scene.size(); i++)
 	{
-		
-		//cout << "p: " << p << endl;
-		float dist = sceneSDF(p);
-		float dist2 = opRep(p, period, scene[0]);
-		//cout << "distance: " << dist2 << endl;
-		
-		if (dist2 < DIST_THRESHOLD)			//hit falls under the required threshold to quantify as a hit
+		SceneObject *obj = scene[i];
+		int node;
+		if (Plane *plane = dynamic_cast<Plane *>(obj))
+		{
+			node = graph.plane(plane->normal, glm::dot(plane->position, plane->normal), i);
+		}
+		else if (dynamic_cast<Sphere *>(obj))
 		{
-			//cout << "HIT" << endl;
-			hit = true;
-			break;
+			node = graph.translate(graph.sphere(obj->radius, i), obj->position);
 		}
-		else if (dist2 > MAX_DISTANCE)		//hit is too far away from target, so it's considered a miss
+		else if (dynamic_cast<Torus *>(obj))
 		{
-			//cout << "MISS" << endl;
-			break;
+			node = graph.rotate(graph.torus(glm::vec2(obj->t.x, obj->t.y), i), obj->angleRotate, obj->rotation);		//Torus::sdf leaves it at the origin
 		}
 		else
 		{
-			//cout << "marching ";
-			p += r.d*dist2;					//march along the ray
+			continue;
+		}
+		root = root < 0 ? node : graph.unite(root, node);
+	}
+
+	program.compile(graph, graph.repeat(root, period, repeatCount));
+}
+
+//renders the size x size block of pixels at (x0, y0), clipped to the image.
+//with bCones a cone around all of the block's rays is marched first, nothing is
+//inside it up to where it got, so the four quarter blocks (8x8, 4x4, 2x2) and
+//in the end the pixels carry on from there instead of from the camera
+void ofApp::marchBlock(int x0, int y0, int size, float tStart)
+{
+	if (x0 >= imageW || y0 >= imageH) return;
+	if (size == 1)
+	{
+		image.setColor(x0, imageH - 1 - y0, marchPixel(x0, y0, tStart, bHeatmap ? &marchCost.at(x0, imageH - 1 - y0) : nullptr));
+		return;
+	}
+
+	if (bCones) tStart = coneMarch(x0, y0, size, tStart);
+	if (size == 4 && bPackets && relaxation <= 1)
+	{
+		marchPackets(x0, y0, tStart);
+		return;
+	}
+	int half = size / 2;
+	marchBlock(x0, y0, half, tStart);
+	marchBlock(x0 + half, y0, half, tStart);
+	marchBlock(x0, y0 + half, half, tStart);
+	marchBlock(x0 + half, y0 + half, half, tStart);
+}
+
+//renders the 4x4 block of pixels at (x0, y0) as two packets of 8 rays, the
+//left and the right half of the block (see rayPacket.h).  each 2x2 quarter
+//still gets its own cone, the rays of a packet can start at different depths
+//the packets are plain sphere traced, so marchBlock() only comes here
+//without --relax
+void ofApp::marchPackets(int x0, int y0, float tStart)
+{
+	float footprint = pixelFootprint();
+	float start[2][2];
+	for (int bx = 0; bx < 2; bx++)
+	{
+		for (int by = 0; by < 2; by++)
+		{
+			start[bx][by] = tStart;
+			if (bCones && x0 + 2 * bx < imageW && y0 + 2 * by < imageH) start[bx][by] = coneMarch(x0 + 2 * bx, y0 + 2 * by, 2, tStart);
 		}
 	}
 
-	return hit;		
+	for (int h = 0; h < 2; h++)
+	{
+		RayPacket packet;
+		int px[RayPacket::SIZE], py[RayPacket::SIZE];
+		for (int i = x0 + 2 * h; i < x0 + 2 * h + 2 && i < imageW; i++)
+		{
+			for (int j = y0; j < y0 + 4 && j < imageH; j++)
+			{
+				Ray r = renderCam.getRay((i + 0.5) / imageW, (j + 0.5) / imageH);
+				px[packet.count] = i;
+				py[packet.count] = j;
+				packet.add(r.p, r.d, start[h][(j - y0) / 2]);
+			}
+		}
+		if (packet.count == 0) continue;
+
+		int steps = marchPacket(program, packet, MAX_RAY_STEPS, DIST_THRESHOLD, MAX_DISTANCE, footprint);
+		rayCount += packet.count;
+		stepCount += steps;
+		sdfCount += steps * RayPacket::SIZE * program.primitives();		//every lane is evaluated until the last one is done
+
+		for (int k = 0; k < packet.count; k++)
+		{
+			ofColor color = packet.id[k] >= 0 ? shadeMarch(packet.point(k), packet.id[k], std::max(0.01f, footprint * packet.t[k])) : ofColor::black;
+			image.setColor(px[k], imageH - 1 - py[k], color);
+			if (bHeatmap)
+			{
+				MarchCost &cost = marchCost.at(px[k], imageH - 1 - py[k]);
+				cost.steps = packet.steps[k];
+				cost.evals = packet.steps[k] * program.primitives();
+				cost.end = packet.id[k] >= 0 ? MarchCost::HIT : packet.id[k] == -1 ? MarchCost::ESCAPED : MarchCost::OUT_OF_STEPS;
+			}
+		}
+	}
+}
+
+//marches a cone from the camera that holds every ray through the size x size
+//pixel block at (x0, y0), starting tStart along its axis.  returns how far the
+//rays of the block can start, the cone is empty (and further from every surface
+//than a ray's hit threshold, see rayMarch()) up to there
+//
+//t along the axis the cone is a disc of radius t * tan.  everything within dist
+//of the axis point is empty, and the cone between t and t + h lies within
+//h + (t + h) * tan of it, so the axis can move on h = (dist - t * tan) / (1 + tan),
+//less the hit threshold (which grows by footprint per unit of t as well).
+//a ray of the block is never further along the axis than it is along itself,
+//so the first t of every ray is inside what the cone covered
+float ofApp::coneMarch(int x0, int y0, int size, float tStart)
+{
+	int x1 = std::min(x0 + size, imageW);
+	int y1 = std::min(y0 + size, imageH);
+	Ray axis = renderCam.getRay((x0 + x1) * 0.5f / imageW, (y0 + y1) * 0.5f / imageH);
+
+	//the view plane is flat, so the widest ray is through one of the corners
+	float cosMin = 1;
+	for (int c = 0; c < 4; c++)
+	{
+		Ray corner = renderCam.getRay((float)((c & 1) ? x1 : x0) / imageW, (float)((c & 2) ? y1 : y0) / imageH);
+		cosMin = std::min(cosMin, glm::dot(corner.d, axis.d));
+	}
+	float tanA = sqrt(std::max(1 - cosMin * cosMin, 0.0f)) / cosMin;
+	float footprint = pixelFootprint();
+
+	float t = tStart;
+	int evals = 0;
+	int steps = 0;
+	for (int i = 0; i < MAX_RAY_STEPS; i++)
+	{
+		SceneHit closest = program.eval(axis.p + axis.d*t);
+		evals += closest.evals;
+		steps++;
+		float h = (closest.dist - std::max(DIST_THRESHOLD, footprint*t) - t*tanA) / (1 + tanA + footprint);
+		if (h < DIST_THRESHOLD || closest.dist > MAX_DISTANCE) break;		//the cone is about to touch something, or left the scene
+		t += h;
+	}
+
+	sdfCount += evals;
+	stepCount += steps;
+	return t;
 }
 
 //this renders images as an output, based on the rayTrace(), but with some changes to it
 void ofApp::rayMarch()
 {
-	//for each pixel, just like ray tracing
-	for (int i = 0; i < imageW; i++)
+	compileScene();
+	if (bHeatmap) marchCost.allocate(imageW, imageH);
+
+	//for each pixel, just like ray tracing, but split into tiles that are
+	//rendered on every core.  each pixel only reads the scene so the threads
+	//don't need to coordinate beyond handing out the tiles
+	//the tiles are split further into 8x8 blocks for the cone pre-pass, 32 is
+	//a multiple of 8 so no block straddles two tiles
+	parallelTiles(imageW, imageH, 32, numThreads, [this](int x0, int y0, int x1, int y1)
 	{
-		int row = imageH - 1;
-		for (int j = 0; j < imageH; j++)
+		for (int i = x0; i < x1; i += 8)
 		{
-			ofColor superColor = ofColor::black;
-			
-			//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
-			float u = (i + 0.5) / imageW;
-			float v = (j + 0.5) / imageH;
-			Ray r = renderCam.getRay(u, v);
+			for (int j = y0; j < y1; j += 8)
+			{
+				marchBlock(i, j, 8, 0);
+			}
+		}
+	});
 
-			bool hit = false;
-			glm::vec3 pointOfIntersect;
-			hit = rayMarch(r, pointOfIntersect);
-			if (hit)
+	saver.save(image.getPixels(), "InfiniteToruses.PNG");
+	if (bHeatmap) marchCost.save(saver, "march", MAX_RAY_STEPS);
+}
+
+//renders the canonical infinite torus scene from setup() (14 lights) and times the
+//sdf kernels on a fixed set of points, then appends the results to benchmark.json
+//with --check the renders are also compared against the golden images and
+//timings in bin/data/golden/ (see regression.h)
+//started with the --benchmark flag (see main.cpp)
+void ofApp::runBenchmark()
+{
+	Benchmark bench("Midterm");
+
+	//full render of the repeated tori
+	bTrace = false;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double marchTime = bench.stop();
+	bench.add("rayMarch", marchTime, { {"rays", (double)rayCount}, {"sdf_evals", (double)sdfCount}, {"steps", (double)stepCount}, {"omega", relaxation}, {"cones", (double)bCones}, {"pixels", (double)imageW * imageH} });
+	check.image("rayMarch", image.getPixels());
+	check.time("rayMarch", marchTime);
+
+	//the same render over-relaxed, to see how many march steps that saves
+	//(with --relax the first render was already relaxed and this one is plain)
+	uint64_t steps = stepCount;
+	float w = relaxation;
+	relaxation = (w > 1) ? 1 : 1.6;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double relaxedTime = bench.stop();
+	bench.add(w > 1 ? "rayMarch plain" : "rayMarch relaxed", relaxedTime, { {"omega", relaxation}, {"steps", (double)stepCount}, {"steps_saved", (double)steps - (double)stepCount}, {"sdf_evals", (double)sdfCount} });
+	relaxation = w;
+
+	//and without the cone pre-pass (or with it, if --no-cones turned it off)
+	bCones = !bCones;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double conesTime = bench.stop();
+	bench.add(bCones ? "rayMarch cones" : "rayMarch no cones", conesTime, { {"steps", (double)stepCount}, {"sdf_evals", (double)sdfCount} });
+	bCones = !bCones;
+
+	bench.start();
+	compileScene();
+	bench.add("compileScene", bench.stop(), { {"instructions", (double)program.size()}, {"primitives", (double)program.primitives()} });
+
+	//the same primary rays marched through the repeated torus three ways: virtual
+	//Torus::sdf calls through opRep, the compiled program, and the scene built
+	//from templates at compile time
+	SceneObject *repeated = scene[0];
+	auto field = sdf::opRep(sdf::rotate(sdf::Torus{ glm::vec2(repeated->t.x, repeated->t.y) }, repeated->angleRotate, repeated->rotation), period, repeatCount);
+	vector<glm::vec3> uv = Benchmark::samplePoints(16384, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
+	auto marchRays = [&](const string &name, auto f)
+	{
+		int steps, evals = 0, hits = 0;
+		glm::vec3 p;
+		bench.start();
+		for (int i = 0; i < uv.size(); i++)
+		{
+			if (march(f, renderCam.getRay(uv[i].x, uv[i].y), p, steps)) hits++;
+			evals += steps;
+		}
+		bench.add(name, bench.stop(), { {"rays", (double)uv.size()}, {"sdf_evals", (double)evals}, {"hits", (double)hits} });
+	};
+	marchRays("march virtual", [&](const glm::vec3 &p) { return opRep(p, period, repeated, repeatCount); });
+	marchRays("march program", [&](const glm::vec3 &p) { return program.eval(p).dist; });
+	marchRays("march template", field);
+
+	//a 128x128 grid of primary rays, one at a time through the program and
+	//then 8 at a time (4x2 pixel blocks) through the packet marcher
+	vector<Ray> grid;
+	for (int by = 0; by < 128; by += 2)
+	{
+		for (int bx = 0; bx < 128; bx += 4)
+		{
+			for (int i = 0; i < 8; i++)
 			{
-				glm::vec3 norm = getNormalRM(pointOfIntersect);
-				ofColor objColor = allShader(pointOfIntersect, norm, scene[sceneIdx]->diffuseColor, scene[sceneIdx]->specularColor, power, scene[sceneIdx]);
-				//ofColor objColor = lambert(pointOfIntersect, norm, scene[sceneIdx]->diffuseColor);
-				superColor += objColor*2;
+				grid.push_back(renderCam.getRay((bx + i % 4 + 0.5) / 128, (by + i / 4 + 0.5) / 128));
 			}
-			else
+		}
+	}
+	int gridSteps = 0, gridHits = 0;
+	bench.start();
+	for (int i = 0; i < grid.size(); i++)
+	{
+		int steps;
+		glm::vec3 p;
+		if (march([&](const glm::vec3 &q) { return program.eval(q).dist; }, grid[i], p, steps)) gridHits++;
+		gridSteps += steps;
+	}
+	bench.add("march grid scalar", bench.stop(), { {"rays", (double)grid.size()}, {"steps", (double)gridSteps}, {"hits", (double)gridHits} });
+	gridSteps = gridHits = 0;
+	bench.start();
+	for (int i = 0; i < grid.size(); i += RayPacket::SIZE)
+	{
+		RayPacket packet;
+		for (int k = i; k < i + RayPacket::SIZE; k++) packet.add(grid[k].p, grid[k].d, 0);
+		gridSteps += marchPacket(program, packet, MAX_RAY_STEPS, DIST_THRESHOLD, MAX_DISTANCE);
+		for (int k = 0; k < packet.count; k++) gridHits += packet.id[k] >= 0;
+	}
+	bench.add("march grid packet", bench.stop(), { {"rays", (double)grid.size()}, {"packet_steps", (double)gridSteps}, {"hits", (double)gridHits} });
+
+	//kernels, sampled over a few cells of the repetition
+	vector<glm::vec3> points = Benchmark::samplePoints(4096, glm::vec3(-8, -8, -8), glm::vec3(8, 8, 8));
+	SceneObject *torus = scene[0];
+	bench.micro("Torus::sdf", 200000, [&](int i) { return torus->sdf(points[i % points.size()]); });
+	bench.micro("opRep", 200000, [&](int i) { return opRep(points[i % points.size()], period, torus); });
+	bench.micro("SDFProgram::eval", 200000, [&](int i) { return program.eval(points[i % points.size()]).dist; });
+
+	//how many copies of the torus a query looks at, and the same scene as a
+	//limited 100x100x100 grid of a million tori, which should cost the same
+	double cellEvals = 0;
+	bench.start();
+	for (const glm::vec3 &p : points) cellEvals += program.eval(p).evals;
+	double cellTime = bench.stop();
+	glm::ivec3 count = repeatCount;
+	repeatCount = glm::ivec3(100);
+	compileScene();
+	bench.micro("SDFProgram::eval 100^3 copies", 200000, [&](int i) { return program.eval(points[i % points.size()]).dist; });
+	repeatCount = count;
+	compileScene();
+	bench.add("repeat cells", cellTime, { {"evals_per_query", cellEvals / points.size()}, {"instructions", (double)program.size()} });
+
+	//with --check, limited grids of a torus wider than a period against the
+	//nearest of every copy.  eval(), eval8() and the template loop may come
+	//out nearer than that (the bound outside the candidates) but never further
+	if (check.enabled)
+	{
+		sdf::Torus big{ glm::vec2(3, 2) };
+		glm::vec3 cell(3.2);
+		for (int n = 2; n <= 3; n++)
+		{
+			SDFGraph g;
+			SDFProgram limited;
+			limited.compile(g, g.repeat(g.torus(big.t, 0), cell, glm::ivec3(n)));
+			auto field = sdf::opRep(big, cell, glm::ivec3(n));
+			float shift = 0.5f * (n - 1) * cell.x;
+			float reach = shift + big.extent() + 2;
+			vector<glm::vec3> samples = Benchmark::samplePoints(4096, glm::vec3(-reach), glm::vec3(reach));
+
+			double worstEval = -sdf::UNBOUNDED, worstEval8 = -sdf::UNBOUNDED, worstTemplate = -sdf::UNBOUNDED;
+			for (int i = 0; i < samples.size(); i += 8)
 			{
-				superColor += ofColor::black;
+				float x[8], y[8], z[8], dist[8];
+				int id[8];
+				for (int k = 0; k < 8; k++)
+				{
+					x[k] = samples[i + k].x;
+					y[k] = samples[i + k].y;
+					z[k] = samples[i + k].z;
+				}
+				limited.eval8(x, y, z, dist, id);
+				for (int k = 0; k < 8; k++)
+				{
+					const glm::vec3 &p = samples[i + k];
+					float exact = sdf::UNBOUNDED;
+					for (int cz = 0; cz < n; cz++)
+					{
+						for (int cy = 0; cy < n; cy++)
+						{
+							for (int cx = 0; cx < n; cx++)
+							{
+								exact = std::min(exact, big(p + shift - glm::vec3(cx, cy, cz) * cell));
+							}
+						}
+					}
+					worstEval = std::max(worstEval, (double)limited.eval(p).dist - exact);
+					worstEval8 = std::max(worstEval8, (double)dist[k] - exact);
+					worstTemplate = std::max(worstTemplate, (double)field(p) - exact);
+				}
 			}
-
-			image.setColor(i, row, superColor);
-			row--;
+			string name = "repeat " + ofToString(n) + "^3 ";
+			check.error(name + "eval", worstEval, 1e-4);
+			check.error(name + "eval8", worstEval8, 1e-4);
+			check.error(name + "template", worstTemplate, 1e-4);
 		}
+
+		//and the compiled csg nodes against their templates, a sphere moved
+		//off the origin and a box so every node has constants on both sides
+		sdf::Translate<sdf::Sphere> ball{ sdf::Sphere{ 1 }, glm::vec3(-0.6, 0.2, 0) };
+		sdf::Box block{ glm::vec3(0.7, 0.5, 0.9) };
+		vector<glm::vec3> samples = Benchmark::samplePoints(4096, glm::vec3(-3), glm::vec3(3));
+		auto csg = [&](const string &name, int op, auto field)
+		{
+			SDFGraph g;
+			int a = g.translate(g.sphere(ball.a.radius, 0), ball.offset);
+			int b = g.box(block.halfSize, 1);
+			int root = op == SDFGraph::INTERSECT ? g.intersect(a, b) : op == SDFGraph::SUBTRACT ? g.subtract(a, b) : g.smoothUnion(a, b, 0.8);
+			SDFProgram compiled;
+			compiled.compile(g, root);
+
+			double worstEval = 0, worstEval8 = 0;
+			for (int i = 0; i < samples.size(); i += 8)
+			{
+				float x[8], y[8], z[8], dist[8];
+				int id[8];
+				for (int k = 0; k < 8; k++)
+				{
+					x[k] = samples[i + k].x;
+					y[k] = samples[i + k].y;
+					z[k] = samples[i + k].z;
+				}
+				compiled.eval8(x, y, z, dist, id);
+				for (int k = 0; k < 8; k++)
+				{
+					float exact = field(samples[i + k]);
+					worstEval = std::max(worstEval, (double)fabs(compiled.eval(samples[i + k]).dist - exact));
+					worstEval8 = std::max(worstEval8, (double)fabs(dist[k] - exact));
+				}
+			}
+			check.error(name + " eval", worstEval, 1e-4);
+			check.error(name + " eval8", worstEval8, 1e-4);
+		};
+		csg("smooth union", SDFGraph::SMOOTH_UNION, sdf::smoothUnion(ball, block, 0.8));
+		csg("intersect", SDFGraph::INTERSECT, sdf::intersect(ball, block));
+		csg("subtract", SDFGraph::SUBTRACT, sdf::subtract(ball, block));
 	}
+	bench.micro(bDualNormals ? "getNormalRM" : "getNormalRM finite differences", 100000, [&](int i) { return getNormalRM(points[i % points.size()]).x; });
+	bDualNormals = !bDualNormals;
+	bench.micro(bDualNormals ? "getNormalRM" : "getNormalRM finite differences", 100000, [&](int i) { return getNormalRM(points[i % points.size()]).x; });
+	bDualNormals = !bDualNormals;
 
-	image.save("InfiniteToruses.PNG");
+	bench.print();
+	bench.save("benchmark.json");
 }
 
 //--------------------------------------------------------------
@@ -2,6 +2,15 @@
 
 #include "ofMain.h"
 #include "ofxGui.h"
+#include "benchmark.h"
+#include "regression.h"
+#include "imageSaver.h"
+#include "parallel.h"
+#include "marchCost.h"
+#include "dual.h"
+#include "sdfProgram.h"
+#include "sdfTemplates.h"
+#include "rayPacket.h"
 
 //  General Purpose Ray class 
 //
@@ -24,7 +33,24 @@ public:
 	virtual void draw() = 0;    // pure virtual funcs - must be overloaded
 	virtual bool intersect(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) { return false; }
 	virtual bool intersectToMove(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) { return false; }
-	virtual float sdf(const glm::vec3 &p) { return 0.0; }
+	virtual float sdf(const glm::vec3 &p) const { return 0.0; }
+
+	//  a cheap lower bound on sdf(p) so the scene query can skip objects that
+	//  are too far away to be the closest one.  the default can't rule anything
+	//  out, objects with a bounding volume override it
+	//
+	virtual float sdfBound(const glm::vec3 &p) const { return -std::numeric_limits<float>::infinity(); }
+
+	//  radius of a sphere around the origin that holds the whole object, so
+	//  opRep() knows which neighbouring copies can reach into a cell
+	//  (see sdf::Grid).  objects that don't end have no such sphere
+	//
+	virtual float extent() const { return sdf::UNBOUNDED; }
+
+	//  sdf(p) over Duals, the distance and its gradient in one pass.  objects
+	//  that can't return false and their normals come from finite differences
+	//
+	virtual bool sdfDual(const Dual3 &p, Dual &dist) const { return false; }
 
 	// commonly used transformations
 	//
@@ -122,7 +148,7 @@ public:
 		return (glm::intersectRaySphere(glm::vec3(p), d, glm::vec3(0, 0, 0), radius, point, normal));
 	}
 
-	float sdf(const glm::vec3 &p)
+	float sdf(const glm::vec3 &p) const
 	{
 		//cout << "p: " << p << endl;
 		//cout << "position: " << position << endl;
@@ -130,6 +156,16 @@ public:
 		return glm::length(p - position) - radius;			//straight from the slides
 	}
 
+	bool sdfDual(const Dual3 &p, Dual &dist) const
+	{
+		dist = length(p - position) - radius;
+		return true;
+	}
+
+	float sdfBound(const glm::vec3 &p) const { return sdf(p); }		//as cheap as it gets already
+
+	float extent() const { return glm::length(position) + radius; }
+
 	void draw() {
 		//   get the current transformation matrix for this object
 		//
@@ -173,30 +209,37 @@ public:
 		return (glm::intersectRaySphere(glm::vec3(p), d, glm::vec3(0, 0, 0), radius, point, normal));
 	}
 
-	float sdf(const glm::vec3 &p1)
+	float sdf(const glm::vec3 &p1) const
 	{
 		//glm::mat4 m = glm::translate(glm::mat4(1.0), position);
 		glm::mat4 M = glm::rotate(glm::mat4(1.0), glm::radians(angleRotate), rotation);	//m
 		//glm::vec3 p = glm::inverse(M) * glm::vec4(p1, 1);
 		//glm::vec2 q = glm::vec2(glm::length(glm::vec2(p.x, p.z)) - t.x, p.y);	//originally p
 
-		
-		glm::vec3 c = glm::vec3(4, 4, 4);			//make this the same as what period is
-		//cout << "sdf c before: " << c << endl;
-		float x = fmod(p1.x + 0.5*c.x, c.x) - 0.5*c.x;
-		float y = fmod(p1.y + 0.5*c.y, c.y) - 0.5*c.y;
-		float z = fmod(p1.z + 0.5*c.z, c.z) - 0.5*c.z;
-		glm::vec3 p2 = glm::vec3(x, y, z);					//on the other hand, if you use this for the sdf calculations, the rendered image 
-															//becomes more detailed and takes on a more shinny and nicer render
-															//it's really bizzare... 
-		//cout << "sdf c after: " << p2 << endl;
-		
+		//the repetition is opRep()'s job (or the compiled program's), not the torus's
 		glm::vec3 p3 = glm::inverse(M) * glm::vec4(p1, 1);
 
 		glm::vec2 q2 = glm::vec2(glm::length(glm::vec2(p3.x, p3.z)) - t.x, p3.y);
 		return glm::length(q2) - t.y;
 	}
 
+	//the same as sdf(), which only uses p3
+	bool sdfDual(const Dual3 &p1, Dual &dist) const
+	{
+		glm::mat4 M = glm::rotate(glm::mat4(1.0), glm::radians(angleRotate), rotation);
+		Dual3 p = transform(glm::inverse(M), p1);
+		dist = length(length(p.x, p.z) - t.x, p.y) - t.y;
+		return true;
+	}
+
+	//the torus fits in a sphere of radius t.x + t.y, the sdf above keeps it at the origin
+	float sdfBound(const glm::vec3 &p) const
+	{
+		return glm::length(p) - (t.x + t.y);
+	}
+
+	float extent() const { return t.x + t.y; }
+
 	//don't confused this "draw" with what's being "drawn" (rendered) for the output image
 	//this draws in the scene
 	void draw() {
@@ -243,7 +286,7 @@ public:
 	}
 	bool intersect(const Ray &ray, glm::vec3 & point, glm::vec3 & normal);
 
-	float sdf(const glm::vec3 & p)
+	float sdf(const glm::vec3 & p) const
 	{
 		if (normal == glm::vec3(0, 1, 0))
 		{
@@ -259,6 +302,14 @@ public:
 		}
 	}
 
+	bool sdfDual(const Dual3 &p, Dual &dist) const
+	{
+		if (normal == glm::vec3(0, 1, 0)) dist = p.y - position.y;
+		else if (normal == glm::vec3(0, 0, 1)) dist = p.z - position.z;
+		else return false;				//sdf() has no gradient to give
+		return true;
+	}
+
 	glm::vec3 getNormal(const glm::vec3 &p) { return this->normal; }
 	void draw() {
 		plane.setPosition(position);
@@ -428,6 +479,14 @@ public:
 	float coneLength = 3;
 };
 
+//result of a scene distance query, the distance to the closest object and
+//that object's index in the scene vector (-1 for an empty scene)
+struct SceneHit {
+	float dist;
+	int id;
+	int evals;			//exact sdf() calls the query needed, for the benchmark
+};
+
 /*
 	Michael Wong CS 116A Final Project
 */
@@ -438,6 +497,7 @@ class ofApp : public ofBaseApp{
 		void setup();
 		void update();
 		void draw();
+		void exit();
 
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -454,13 +514,20 @@ class ofApp : public ofBaseApp{
 		void drawAxis(glm::vec3 pos);
 		void rayTrace();
 		void rayMarch();
-		bool rayMarch(Ray r, glm::vec3 &p);
-		float sceneSDF(const glm::vec3 &p);
+		ofColor tracePixel(int i, int j);
+		ofColor marchPixel(int i, int j, float tStart = 0, MarchCost *cost = nullptr);
+		ofColor shadeMarch(const glm::vec3 &p, int id, float eps = 0.01);
+		void marchPackets(int x0, int y0, float tStart);
+		void marchBlock(int x0, int y0, int size, float tStart);
+		float coneMarch(int x0, int y0, int size, float tStart);
+		bool rayMarch(const Ray &r, glm::vec3 &p, int &id, float tStart = 0, float footprint = 0, MarchCost *cost = nullptr);
+		SceneHit sceneQuery(const glm::vec3 &p) const;
+		void compileScene();
+		float sceneSDF(const glm::vec3 &p) const;
 		ofColor ofApp::lambert(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse);
 		ofColor ofApp::phong(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse, const ofColor specular, float power);
 		bool isShadow(const Ray &r);
 		bool isSpotlightShadow(const Ray &r, const Light &l);
-		bool isSpotlightShadowRM(const Ray &r, const Light &l);
 		ofColor allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse, const ofColor specular, float power, SceneObject* obj);	
 		ofColor lookup(float u, float v);
 		bool objSelected() { return (selected.size() ? true : false); };
@@ -468,24 +535,58 @@ class ofApp : public ofBaseApp{
 		void printChannel();
 		void deleteObj();
 		bool inSpotLight(const Light &l, const glm::vec3 &p);
-		glm::vec3 getNormalRM(const glm::vec3 &p);
+		glm::vec3 getNormalRM(const glm::vec3 &p, float eps = 0.01, int id = -1);
+		float pixelFootprint();
+		void runBenchmark();
 
 		//the function to produce an infinte number of primitives in the scene
-		float opRep(glm::vec3 p, glm::vec3 c, SceneObject* obj)
+		//copies of obj every c, count of them along each axis (0 for no end to
+		//them), with the neighbouring copies checked where they reach into the
+		//cell.  SDFGraph::repeat() does the same for any part of the compiled scene
+		float opRep(glm::vec3 p, glm::vec3 c, SceneObject* obj, glm::ivec3 count = glm::ivec3(0)) const
 		{
-			//cout << "opRep c before : " << c << endl;
-
-			//glm::vec3 q = modf(p + 0.5*c, c) - 0.5*c;
+			return sdf::Grid{ c, count, obj->extent() }([obj](const glm::vec3 &q) { return obj->sdf(q); }, p);
+		}
 
-			float x = fmod(p.x + 0.5*c.x, c.x) - 0.5*c.x;
-			float y = fmod(p.y + 0.5*c.y, c.y) - 0.5*c.y;
-			float z = fmod(p.z + 0.5*c.z, c.z) - 0.5*c.z;
-			glm::vec3 q2 = glm::vec3(x, y, z);
-			
-			//cout << "opRep c after: " << c << endl;
-			//cout << "opRep q2: " << q2 << endl;
-			return obj->sdf(q2);			//idk why the point being passed into the sdf changes how the render works 
-											//this way makes the render have less detail and appears duller; see Torus sdf for more
+		//sphere traces r through the distance function f(p), either a fixed scene
+		//from sdfTemplates.h or a lambda around a runtime one.  the template lets
+		//the compiler inline f into the loop.  the march starts tStart along r,
+		//p ends up at the hit point and steps is the number of times f was evaluated.
+		//footprint widens the hit threshold with distance, see rayMarch()
+		//
+		//with relaxation above 1 each step is relaxation * dist (over-relaxed
+		//sphere tracing, Keinert et al. 2014).  as long as the empty spheres
+		//around two points in a row overlap nothing was skipped between them,
+		//once they don't the ray backs up to the last safe point and carries on
+		//with plain steps
+		template<typename SDF>
+		bool march(const SDF &f, const Ray &r, glm::vec3 &p, int &steps, float tStart = 0, float footprint = 0) const
+		{
+			float omega = relaxation;
+			float step = 0, prevDist = 0;
+			float t = tStart;
+			p = r.p + r.d*tStart;
+			steps = 0;
+			for (int i = 0; i < MAX_RAY_STEPS; i++)
+			{
+				float dist = f(p);
+				steps++;
+				if (omega > 1 && fabs(dist) + prevDist < step)
+				{
+					p += r.d*(prevDist - step);					//the spheres don't overlap, back up and take the safe step
+					t += prevDist - step;
+					step = prevDist;
+					omega = 1;
+					continue;
+				}
+				if (dist < std::max(DIST_THRESHOLD, footprint*t)) return true;		//hit falls under the required threshold to quantify as a hit
+				if (dist > MAX_DISTANCE) return false;			//hit is too far away from target, so it's considered a miss
+				step = dist*omega;
+				prevDist = dist;
+				p += r.d*step;									//march along the ray
+				t += step;
+			}
+			return false;
 		}
 
 		
@@ -500,6 +601,7 @@ class ofApp : public ofBaseApp{
 		RenderCam renderCam;
 		ofImage image, map;
 		ofImage texture;
+		ImageSaver saver;							//encodes renders on a background thread so the next one can start right away
 
 		Plane plane;
 		ViewPlane vp; 
@@ -507,7 +609,6 @@ class ofApp : public ofBaseApp{
 		vector<SceneObject*> selected;				//vector to hold an object that is selected
 		int imageH = 500, imageW = 750;			//dimensions for the image to render
 		float squares = 10;							//the dimensions for how many tiles you want layed on the plane
-		int sceneIdx = 0;
 
 		glm::vec3 hitpoint, normal;					//vec3s to be used later for intersect
 		Light light;
@@ -516,6 +617,8 @@ class ofApp : public ofBaseApp{
 		glm::vec3 lastPoint;
 		glm::vec3 cursor;							//vec3 that tracks the movement of the mouse cursor
 		const glm::vec3 period = glm::vec3(3.5, 3.5, 3.5);		//period of repetition for the infinite primitives 
+		glm::ivec3 repeatCount = glm::ivec3(0);		//copies of the scene along each axis, 0 repeats it without end (--repeat-count)
+		SDFProgram program;							//the repeated scene compiled for rayMarch(), see compileScene()
 
 		ofxPanel gui;
 		ofxFloatSlider intensity;
@@ -544,4 +647,18 @@ class ofApp : public ofBaseApp{
 		bool bAnimate = false;
 		bool bAngle = false;
 		bool bTValue = false;
+		bool bBenchmark = false;					//set by --benchmark in main(), renders the canonical scene headless and exits
+		RegressionCheck check;						//golden image and timing checks for the benchmark renders (--check)
+
+		int numThreads = 0;							//threads rayMarch() renders with, 0 uses every core (--threads)
+		bool bDualNormals = true;					//normals from sdfDual() where the object has it, see getNormalRM() (--fd-normals turns it off)
+		float relaxation = 1;						//step factor for over-relaxed marching, 1 is plain sphere tracing (--relax)
+		bool bHeatmap = false;						//record what every pixel cost to march, see MarchCostPass (--heatmap)
+		MarchCostPass marchCost;
+		bool bCones = true;							//primary rays start where a cone over their pixel block got to, see marchBlock() (--no-cones)
+		bool bPackets = true;						//march primary rays 8 at a time, see marchPackets() (--no-packets)
+
+		std::atomic<uint64_t> rayCount{ 0 };		//rays cast since the last reset, for the benchmark
+		std::atomic<uint64_t> sdfCount{ 0 };		//object sdf evaluations since the last reset
+		std::atomic<uint64_t> stepCount{ 0 };		//march steps since the last reset
 };
@@ -0,0 +1,124 @@
+#include "rayPacket.h"
+#include "sdfProgram.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+void RayPacket::add(const glm::vec3 &origin, const glm::vec3 &dir, float tStart) {
+	if (count >= SIZE) return;
+	ox[count] = origin.x;
+	oy[count] = origin.y;
+	oz[count] = origin.z;
+	dx[count] = dir.x;
+	dy[count] = dir.y;
+	dz[count] = dir.z;
+	t[count] = tStart;
+	id[count] = -1;
+	steps[count] = 0;
+	count++;
+}
+
+#ifdef __AVX2__
+
+int marchPacket(const SDFProgram &program, RayPacket &packet, int maxSteps, float threshold, float maxDistance, float footprint) {
+	// unused lanes copy lane 0 so they evaluate somewhere sensible, and start
+	// out of the mask
+	for (int i = packet.count; i < RayPacket::SIZE; i++) {
+		packet.ox[i] = packet.ox[0];
+		packet.oy[i] = packet.oy[0];
+		packet.oz[i] = packet.oz[0];
+		packet.dx[i] = packet.dx[0];
+		packet.dy[i] = packet.dy[0];
+		packet.dz[i] = packet.dz[0];
+		packet.t[i] = packet.t[0];
+		packet.id[i] = -1;
+	}
+
+	__m256 ox = _mm256_loadu_ps(packet.ox), oy = _mm256_loadu_ps(packet.oy), oz = _mm256_loadu_ps(packet.oz);
+	__m256 dx = _mm256_loadu_ps(packet.dx), dy = _mm256_loadu_ps(packet.dy), dz = _mm256_loadu_ps(packet.dz);
+	__m256 t = _mm256_loadu_ps(packet.t);
+	__m256 thres = _mm256_set1_ps(threshold);
+	__m256 cone = _mm256_set1_ps(footprint);
+	__m256 far = _mm256_set1_ps(maxDistance);
+	__m256i ids = _mm256_set1_epi32(-1);
+	__m256i laneSteps = _mm256_setzero_si256();
+
+	__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256 active = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(packet.count), lanes));
+
+	alignas(32) float x[8], y[8], z[8], dist[8];
+	alignas(32) int id[8];
+	int steps = 0;
+	while (steps < maxSteps && _mm256_movemask_ps(active)) {
+		_mm256_store_ps(x, _mm256_add_ps(ox, _mm256_mul_ps(dx, t)));
+		_mm256_store_ps(y, _mm256_add_ps(oy, _mm256_mul_ps(dy, t)));
+		_mm256_store_ps(z, _mm256_add_ps(oz, _mm256_mul_ps(dz, t)));
+		program.eval8(x, y, z, dist, id);
+		steps++;
+		laneSteps = _mm256_sub_epi32(laneSteps, _mm256_castps_si256(active));		// active lanes are all ones, -1
+
+		__m256 d = _mm256_load_ps(dist);
+		__m256 hit = _mm256_and_ps(active, _mm256_cmp_ps(d, _mm256_max_ps(thres, _mm256_mul_ps(cone, t)), _CMP_LT_OQ));
+		__m256 miss = _mm256_cmp_ps(d, far, _CMP_GT_OQ);
+		ids = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(ids), _mm256_load_ps((const float *)id), hit));
+
+		// rays that hit or escaped stay where they are
+		active = _mm256_andnot_ps(_mm256_or_ps(hit, miss), active);
+		t = _mm256_add_ps(t, _mm256_and_ps(active, d));
+	}
+
+	// whatever is still marching ran out of steps
+	ids = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(ids), _mm256_castsi256_ps(_mm256_set1_epi32(-2)), active));
+
+	_mm256_storeu_ps(packet.t, t);
+	_mm256_storeu_si256((__m256i *)packet.id, ids);
+	_mm256_storeu_si256((__m256i *)packet.steps, laneSteps);
+	return steps;
+}
+
+#else
+
+// the same lane by lane, for builds without AVX2
+int marchPacket(const SDFProgram &program, RayPacket &packet, int maxSteps, float threshold, float maxDistance, float footprint) {
+	bool active[RayPacket::SIZE];
+	float x[RayPacket::SIZE], y[RayPacket::SIZE], z[RayPacket::SIZE], dist[RayPacket::SIZE];
+	int id[RayPacket::SIZE];
+	for (int i = 0; i < RayPacket::SIZE; i++) {
+		active[i] = i < packet.count;
+		if (!active[i]) x[i] = y[i] = z[i] = 0;
+		packet.id[i] = -1;
+		packet.steps[i] = 0;
+	}
+
+	int steps = 0;
+	bool any = packet.count > 0;
+	while (steps < maxSteps && any) {
+		for (int i = 0; i < packet.count; i++) {
+			x[i] = packet.ox[i] + packet.dx[i] * packet.t[i];
+			y[i] = packet.oy[i] + packet.dy[i] * packet.t[i];
+			z[i] = packet.oz[i] + packet.dz[i] * packet.t[i];
+		}
+		program.eval8(x, y, z, dist, id);
+		steps++;
+
+		any = false;
+		for (int i = 0; i < packet.count; i++) {
+			if (!active[i]) continue;
+			packet.steps[i]++;
+			if (dist[i] < std::max(threshold, footprint * packet.t[i])) {
+				packet.id[i] = id[i];
+				active[i] = false;
+			}
+			else if (dist[i] > maxDistance) active[i] = false;
+			else packet.t[i] += dist[i];
+			any = any || active[i];
+		}
+	}
+	for (int i = 0; i < packet.count; i++) {
+		if (active[i]) packet.id[i] = -2;
+	}
+	return steps;
+}
+
+#endif
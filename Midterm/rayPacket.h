@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ofMain.h"
+
+class SDFProgram;
+
+//  Eight rays marched together through an SDFProgram.
+//
+//  Every step evaluates the program for all eight rays at once with
+//  SDFProgram::eval8() (one ray per AVX2 lane) and moves them along with
+//  vector math.  A mask keeps track of which rays are still marching: a ray
+//  that hits or escapes drops out of the mask and stops moving, and the
+//  packet is done when the mask is empty.  Neighbouring pixels see nearly the
+//  same surfaces, so the lanes tend to finish together and little of the work
+//  is thrown away.
+//
+//  The rays are plain sphere traced, without the over-relaxation of
+//  ofApp::march().
+//
+struct RayPacket {
+	static const int SIZE = 8;
+
+	float ox[SIZE], oy[SIZE], oz[SIZE];		// origins
+	float dx[SIZE], dy[SIZE], dz[SIZE];		// directions, normalized
+	float t[SIZE];							// distance along the ray, where to start going in and the hit coming out
+	int id[SIZE];							// object hit, -1 if the ray escaped, -2 if it ran out of steps
+	int steps[SIZE];						// steps the ray took before it stopped
+	int count = 0;							// lanes in use, the rest are ignored
+
+	void add(const glm::vec3 &origin, const glm::vec3 &dir, float tStart);
+	glm::vec3 point(int lane) const { return glm::vec3(ox[lane], oy[lane], oz[lane]) + glm::vec3(dx[lane], dy[lane], dz[lane]) * t[lane]; }
+};
+
+//  marches the packet until every ray has hit (distance under threshold, or
+//  under footprint * t if that's bigger), escaped (distance over maxDistance)
+//  or used up maxSteps.  returns the number of steps, each one an eval8() of
+//  the whole packet
+//
+int marchPacket(const SDFProgram &program, RayPacket &packet, int maxSteps, float threshold, float maxDistance, float footprint = 0);
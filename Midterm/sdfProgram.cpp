@@ -0,0 +1,848 @@
+#include "sdfProgram.h"
+#include "sdfTemplates.h"
+#include "ofApp.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+int SDFGraph::add(const Node &n) {
+	nodes.push_back(n);
+	return nodes.size() - 1;
+}
+
+int SDFGraph::sphere(float radius, int id) {
+	Node n;
+	n.op = SPHERE;
+	n.f = radius;
+	n.id = id;
+	return add(n);
+}
+
+int SDFGraph::torus(glm::vec2 t, int id) {
+	Node n;
+	n.op = TORUS;
+	n.t = t;
+	n.id = id;
+	return add(n);
+}
+
+int SDFGraph::plane(glm::vec3 normal, float height, int id) {
+	Node n;
+	n.op = PLANE;
+	n.v = normal;
+	n.f = height;
+	n.id = id;
+	return add(n);
+}
+
+int SDFGraph::box(glm::vec3 halfSize, int id) {
+	Node n;
+	n.op = BOX;
+	n.v = halfSize;
+	n.id = id;
+	return add(n);
+}
+
+int SDFGraph::unite(int a, int b) {
+	Node n;
+	n.op = UNION;
+	n.a = a;
+	n.b = b;
+	return add(n);
+}
+
+int SDFGraph::intersect(int a, int b) {
+	Node n;
+	n.op = INTERSECT;
+	n.a = a;
+	n.b = b;
+	return add(n);
+}
+
+int SDFGraph::subtract(int a, int b) {
+	Node n;
+	n.op = SUBTRACT;
+	n.a = a;
+	n.b = b;
+	return add(n);
+}
+
+int SDFGraph::smoothUnion(int a, int b, float k) {
+	Node n;
+	n.op = SMOOTH_UNION;
+	n.a = a;
+	n.b = b;
+	n.f = k;
+	return add(n);
+}
+
+int SDFGraph::translate(int a, glm::vec3 offset) {
+	Node n;
+	n.op = TRANSLATE;
+	n.a = a;
+	n.v = offset;
+	return add(n);
+}
+
+int SDFGraph::rotate(int a, float degrees, glm::vec3 axis) {
+	Node n;
+	n.op = ROTATE;
+	n.a = a;
+	n.f = degrees;
+	n.v = axis;
+	return add(n);
+}
+
+int SDFGraph::scale(int a, float s) {
+	Node n;
+	n.op = SCALE;
+	n.a = a;
+	n.f = s;
+	return add(n);
+}
+
+int SDFGraph::twist(int a, float rate) {
+	Node n;
+	n.op = TWIST;
+	n.a = a;
+	n.f = rate;
+	return add(n);
+}
+
+int SDFGraph::repeat(int a, glm::vec3 period, glm::ivec3 count) {
+	Node n;
+	n.op = REPEAT;
+	n.a = a;
+	n.v = period;
+	n.count = count;
+	return add(n);
+}
+
+// the same as extent() of the sdf:: templates
+float SDFGraph::extent(int node) const {
+	const Node &n = nodes[node];
+	switch (n.op) {
+	case SPHERE: return n.f;
+	case TORUS: return n.t.x + n.t.y;
+	case PLANE: return sdf::UNBOUNDED;
+	case BOX: return glm::length(n.v);
+	case UNION: return std::max(extent(n.a), extent(n.b));
+	case SMOOTH_UNION: return std::max(extent(n.a), extent(n.b)) + 0.25f * n.f;		// the blend adds at most k / 4
+	case INTERSECT: return std::min(extent(n.a), extent(n.b));
+	case SUBTRACT: return extent(n.a);
+	case TRANSLATE: return extent(n.a) + glm::length(n.v);
+	case SCALE: return extent(n.a) * fabs(n.f);
+	case ROTATE:
+	case TWIST: return extent(n.a);				// neither moves a point closer to the origin or further
+	case REPEAT: return sdf::Grid{ n.v, n.count, extent(n.a) }.span();
+	}
+	return sdf::UNBOUNDED;
+}
+
+// copy node (and what's under it) into out, simplified.  returns the new
+// index, or -1 if nothing is left of it
+//
+int SDFProgram::fold(const SDFGraph &in, int node, SDFGraph &out) {
+	if (node < 0 || node >= in.nodes.size()) return -1;
+	SDFGraph::Node n = in.nodes[node];
+	if (!n.enabled) return -1;
+
+	switch (n.op) {
+	case SDFGraph::SPHERE:
+	case SDFGraph::TORUS:
+	case SDFGraph::PLANE:
+	case SDFGraph::BOX:
+		out.nodes.push_back(n);
+		return out.nodes.size() - 1;
+
+	case SDFGraph::UNION:
+	case SDFGraph::SMOOTH_UNION:
+	case SDFGraph::INTERSECT:
+	case SDFGraph::SUBTRACT: {
+		int a = fold(in, n.a, out);
+		int b = fold(in, n.b, out);
+		if (n.op == SDFGraph::INTERSECT && (a < 0 || b < 0)) return -1;
+		if (n.op == SDFGraph::SUBTRACT && a < 0) return -1;
+		if (b < 0) return a;
+		if (a < 0) return b;
+		if (n.op == SDFGraph::SMOOTH_UNION && n.f <= 0) n.op = SDFGraph::UNION;
+		n.a = a;
+		n.b = b;
+		out.nodes.push_back(n);
+		return out.nodes.size() - 1;
+	}
+
+	default: {
+		int a = fold(in, n.a, out);
+		if (a < 0) return -1;
+
+		// transforms that don't do anything
+		if (n.op == SDFGraph::TRANSLATE && n.v == glm::vec3(0)) return a;
+		if (n.op == SDFGraph::ROTATE && (fmod(n.f, 360.0f) == 0 || n.v == glm::vec3(0))) return a;
+		if (n.op == SDFGraph::SCALE && n.f == 1) return a;
+		if (n.op == SDFGraph::TWIST && n.f == 0) return a;
+		if (n.op == SDFGraph::REPEAT && n.v == glm::vec3(0)) return a;
+
+		// two in a row of the same kind
+		SDFGraph::Node &child = out.nodes[a];
+		if (n.op == SDFGraph::TRANSLATE && child.op == SDFGraph::TRANSLATE) {
+			child.v += n.v;
+			return child.v == glm::vec3(0) ? child.a : a;
+		}
+		if (n.op == SDFGraph::SCALE && child.op == SDFGraph::SCALE) {
+			child.f *= n.f;
+			return child.f == 1 ? child.a : a;
+		}
+
+		n.a = a;
+		out.nodes.push_back(n);
+		return out.nodes.size() - 1;
+	}
+	}
+}
+
+int SDFProgram::allocPoint() {
+	if (!freePoints.empty()) {
+		int r = freePoints.back();
+		freePoints.pop_back();
+		return r;
+	}
+	if (pointRegs == MAX_REGISTERS) {
+		bOverflow = true;
+		return 0;
+	}
+	return pointRegs++;
+}
+
+int SDFProgram::allocDist() {
+	if (!freeDists.empty()) {
+		int r = freeDists.back();
+		freeDists.pop_back();
+		return r;
+	}
+	if (distRegs == MAX_REGISTERS) {
+		bOverflow = true;
+		return 0;
+	}
+	return distRegs++;
+}
+
+// emit the instructions for node with the point it sees in pointReg, returns
+// the distance register with its result
+//
+int SDFProgram::emit(const SDFGraph &graph, int node, int pointReg) {
+	const SDFGraph::Node &n = graph.nodes[node];
+	Instr in;
+	in.k = consts.size();
+	in.id = n.id;
+	in.a = pointReg;
+	in.b = 0;
+
+	switch (n.op) {
+	case SDFGraph::SPHERE:
+		in.op = D_SPHERE;
+		consts.push_back(n.f);
+		break;
+	case SDFGraph::TORUS:
+		in.op = D_TORUS;
+		consts.push_back(n.t.x);
+		consts.push_back(n.t.y);
+		break;
+	case SDFGraph::PLANE: {
+		in.op = D_PLANE;
+		glm::vec3 normal = glm::normalize(n.v);
+		consts.push_back(normal.x);
+		consts.push_back(normal.y);
+		consts.push_back(normal.z);
+		consts.push_back(n.f);
+		break;
+	}
+	case SDFGraph::BOX:
+		in.op = D_BOX;
+		consts.push_back(n.v.x);
+		consts.push_back(n.v.y);
+		consts.push_back(n.v.z);
+		break;
+
+	case SDFGraph::UNION:
+	case SDFGraph::INTERSECT:
+	case SDFGraph::SUBTRACT:
+	case SDFGraph::SMOOTH_UNION: {
+		int a = emit(graph, n.a, pointReg);
+		int b = emit(graph, n.b, pointReg);
+		in.op = n.op == SDFGraph::UNION ? D_MIN : n.op == SDFGraph::INTERSECT ? D_MAX : n.op == SDFGraph::SUBTRACT ? D_SUBTRACT : D_SMOOTH_MIN;
+		if (n.op == SDFGraph::SMOOTH_UNION) {
+			in.k = consts.size();				// after the children's constants
+			consts.push_back(n.f);
+		}
+		in.dst = a;
+		in.a = a;
+		in.b = b;
+		code.push_back(in);
+		freeDists.push_back(b);
+		return a;
+	}
+
+	case SDFGraph::REPEAT:
+		return emitRepeat(graph, n, pointReg);
+
+	default: {
+		// domain operations: warp the point into a new register, evaluate the
+		// child there and give the register back
+		int p = allocPoint();
+		in.dst = p;
+		if (n.op == SDFGraph::TRANSLATE) {
+			in.op = P_TRANSLATE;
+			consts.push_back(n.v.x);
+			consts.push_back(n.v.y);
+			consts.push_back(n.v.z);
+		}
+		else if (n.op == SDFGraph::ROTATE) {
+			// the inverse rotation takes the point into the child's frame
+			in.op = P_ROTATE;
+			glm::mat3 m = glm::mat3(glm::inverse(glm::rotate(glm::mat4(1.0), glm::radians(n.f), n.v)));
+			for (int c = 0; c < 3; c++) {
+				for (int r = 0; r < 3; r++) consts.push_back(m[c][r]);
+			}
+		}
+		else if (n.op == SDFGraph::SCALE) {
+			in.op = P_SCALE;
+			consts.push_back(1 / n.f);
+		}
+		else {
+			in.op = P_TWIST;
+			consts.push_back(n.f);
+		}
+		code.push_back(in);
+
+		int d = emit(graph, n.a, p);
+		freePoints.push_back(p);
+
+		// scaling the space scales the distances too
+		if (n.op == SDFGraph::SCALE) {
+			Instr mul;
+			mul.op = D_MUL;
+			mul.dst = d;
+			mul.a = d;
+			mul.b = 0;
+			mul.k = consts.size();
+			mul.id = -1;
+			consts.push_back(n.f);
+			code.push_back(mul);
+		}
+		return d;
+	}
+	}
+
+	// primitives
+	in.dst = allocDist();
+	code.push_back(in);
+	primitiveCount++;
+	return in.dst;
+}
+
+// repetition (see sdf::Grid): the child once in the nearest copy's cell and
+// once more for every other candidate cell, up to Grid::cells() per axis in
+// the order they get further away - the nearest, the next one on the side
+// the point is on, the next on the other side and so on, all of it within
+// the candidates so the edge of a limited grid wastes none.  each of those is
+// behind a P_CELL that jumps past it when no point needs the cell, then
+// D_CELL_BOUND holds the distance down to what's outside the candidates.
+// the consts are the grid, the extent and five per axis (period, shift,
+// first and last copy, reach), then for P_CELL which candidate per axis
+//
+int SDFProgram::emitRepeat(const SDFGraph &graph, const SDFGraph::Node &n, int pointReg) {
+	sdf::Grid grid{ n.v, n.count, graph.extent(n.a) };
+	int gridConsts = consts.size();
+	consts.push_back(grid.extent);
+	for (int a = 0; a < 3; a++) {
+		consts.push_back(grid.period[a]);
+		consts.push_back(grid.shift(a));
+		consts.push_back(grid.first(a));
+		consts.push_back(grid.last(a));
+		consts.push_back(grid.reach(a));
+	}
+
+	int d = -1;
+	int primitives = primitiveCount;
+	for (int z = 0; z < grid.cells(2); z++) {
+		for (int y = 0; y < grid.cells(1); y++) {
+			for (int x = 0; x < grid.cells(0); x++) {
+				Instr in;
+				in.op = P_CELL;
+				in.dst = allocPoint();
+				in.a = pointReg;
+				in.b = d < 0 ? 0 : d;
+				in.k = consts.size();
+				in.id = -1;
+				for (int c = 0; c < 16; c++) {
+					float v = consts[gridConsts + c];
+					consts.push_back(v);
+				}
+				consts.push_back(x);
+				consts.push_back(y);
+				consts.push_back(z);
+				int cell = code.size();
+				code.push_back(in);
+
+				int cd = emit(graph, n.a, in.dst);
+				freePoints.push_back(in.dst);
+				if (d < 0) {
+					d = cd;
+					primitives = primitiveCount;		// primitives() counts one copy
+					continue;
+				}
+				Instr m;
+				m.op = D_MIN;
+				m.dst = d;
+				m.a = d;
+				m.b = cd;
+				m.k = 0;
+				m.id = -1;
+				code.push_back(m);
+				freeDists.push_back(cd);
+				code[cell].skip = code.size();
+			}
+		}
+	}
+	primitiveCount = primitives;
+
+	if (grid.extent != sdf::UNBOUNDED) {
+		Instr bound;
+		bound.op = D_CELL_BOUND;
+		bound.dst = d;
+		bound.a = pointReg;
+		bound.b = 0;
+		bound.k = gridConsts;
+		bound.id = -1;
+		code.push_back(bound);
+	}
+	return d;
+}
+
+bool SDFProgram::compile(const SDFGraph &graph, int root) {
+	code.clear();
+	consts.clear();
+	freePoints.clear();
+	freeDists.clear();
+	result = -1;
+	primitiveCount = 0;
+	pointRegs = 1;					// register 0 is the point being evaluated
+	distRegs = 0;
+	bOverflow = false;
+
+	SDFGraph folded;
+	int top = fold(graph, root, folded);
+	if (top < 0) return false;
+
+	result = emit(folded, top, 0);
+	if (bOverflow) {
+		ofLogError("SDFProgram") << "scene needs more than " << MAX_REGISTERS << " registers";
+		code.clear();
+		result = -1;
+		return false;
+	}
+	return true;
+}
+
+// along one axis of a repetition (g is its period, shift, first, last and
+// reach), the nearest copy to u and the range of candidates, see sdf::Grid::range()
+static inline void cellRange(const float *g, float u, float &n, float &lo, float &hi) {
+	n = floor(u / g[0] + 0.5f);
+	lo = ofClamp(std::min(ceil((u - g[4]) / g[0]), n), g[2], g[3]);
+	hi = ofClamp(std::max(floor((u + g[4]) / g[0]), n), g[2], g[3]);
+}
+
+// P_CELL: p moved into the cell of one of the candidate copies.  false if
+// along some axis that candidate is out of range, or the sphere around the
+// copy is no closer than best
+static inline bool cellPoint(const float *k, const glm::vec3 &p, float best, glm::vec3 &q) {
+	bool need = true;
+	for (int a = 0; a < 3; a++) {
+		const float *g = k + 1 + 5 * a;
+		float i = k[16 + a];
+		q[a] = p[a];
+		if (g[0] == 0) continue;
+		float u = p[a] + g[1];
+		float n, lo, hi;
+		cellRange(g, u, n, lo, hi);
+		float j = ofClamp(n, lo, hi);
+		if (i > 0) {
+			// out from j taking turns between the sides, the point's side
+			// first, and once one side runs out of candidates on along the other
+			float side = u >= n * g[0] ? 1 : -1;
+			float left = j - lo, right = hi - j;
+			float near = side > 0 ? right : left, far = side > 0 ? left : right;
+			float both = std::min(near, far);
+			float step = i <= 2 * both ? floor((i + 1) / 2) * (fmod(i, 2) == 1 ? side : -side) : (i - both) * (near > far ? side : -side);
+			need = need && i <= left + right;
+			j = ofClamp(j + step, lo, hi);
+		}
+		q[a] = u - j * g[0];
+	}
+	return need && glm::length(q) - k[0] < best;
+}
+
+// D_CELL_BOUND: no copy outside the candidates is closer than this, see sdf::Grid::outside()
+static inline float cellBound(const float *k, const glm::vec3 &p) {
+	float bound = std::numeric_limits<float>::infinity();
+	for (int a = 0; a < 3; a++) {
+		const float *g = k + 1 + 5 * a;
+		if (g[0] == 0) continue;
+		float u = p[a] + g[1];
+		float n, lo, hi;
+		cellRange(g, u, n, lo, hi);
+		if (lo - 1 >= g[2]) bound = std::min(bound, u - (lo - 1) * g[0] - k[0]);
+		if (hi + 1 <= g[3]) bound = std::min(bound, (hi + 1) * g[0] - u - k[0]);
+	}
+	return bound;
+}
+
+SceneHit SDFProgram::eval(const glm::vec3 &p) const {
+	glm::vec3 P[MAX_REGISTERS];
+	float D[MAX_REGISTERS];
+	int ID[MAX_REGISTERS];
+	const float *c = consts.data();
+
+	int evals = 0;
+
+	if (result < 0) return { std::numeric_limits<float>::infinity(), -1, 0 };
+
+	P[0] = p;
+	for (int pc = 0; pc < (int)code.size(); pc++) {
+		const Instr &in = code[pc];
+		const float *k = c + in.k;
+		switch (in.op) {
+		case P_TRANSLATE:
+			P[in.dst] = P[in.a] - glm::vec3(k[0], k[1], k[2]);
+			break;
+		case P_ROTATE: {
+			const glm::vec3 &q = P[in.a];
+			P[in.dst] = glm::vec3(k[0] * q.x + k[3] * q.y + k[6] * q.z,
+				k[1] * q.x + k[4] * q.y + k[7] * q.z,
+				k[2] * q.x + k[5] * q.y + k[8] * q.z);
+			break;
+		}
+		case P_SCALE:
+			P[in.dst] = P[in.a] * k[0];
+			break;
+		case P_TWIST: {
+			const glm::vec3 &q = P[in.a];
+			float s = sin(k[0] * q.y), co = cos(k[0] * q.y);
+			P[in.dst] = glm::vec3(co * q.x - s * q.z, q.y, s * q.x + co * q.z);
+			break;
+		}
+		case P_CELL: {
+			float best = in.skip < 0 ? std::numeric_limits<float>::infinity() : D[in.b];
+			if (!cellPoint(k, P[in.a], best, P[in.dst]) && in.skip >= 0) pc = in.skip - 1;
+			break;
+		}
+		case D_SPHERE:
+			D[in.dst] = glm::length(P[in.a]) - k[0];
+			ID[in.dst] = in.id;
+			evals++;
+			break;
+		case D_TORUS: {
+			const glm::vec3 &q = P[in.a];
+			glm::vec2 r = glm::vec2(glm::length(glm::vec2(q.x, q.z)) - k[0], q.y);
+			D[in.dst] = glm::length(r) - k[1];
+			ID[in.dst] = in.id;
+			evals++;
+			break;
+		}
+		case D_PLANE:
+			D[in.dst] = glm::dot(P[in.a], glm::vec3(k[0], k[1], k[2])) - k[3];
+			ID[in.dst] = in.id;
+			evals++;
+			break;
+		case D_BOX: {
+			glm::vec3 q = glm::abs(P[in.a]) - glm::vec3(k[0], k[1], k[2]);
+			D[in.dst] = glm::length(glm::max(q, glm::vec3(0))) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+			ID[in.dst] = in.id;
+			evals++;
+			break;
+		}
+		case D_MIN:
+			if (D[in.b] < D[in.a]) {
+				D[in.dst] = D[in.b];
+				ID[in.dst] = ID[in.b];
+			}
+			break;
+		case D_MAX:
+			if (D[in.b] > D[in.a]) {
+				D[in.dst] = D[in.b];
+				ID[in.dst] = ID[in.b];
+			}
+			break;
+		case D_SUBTRACT:
+			if (-D[in.b] > D[in.a]) {
+				D[in.dst] = -D[in.b];
+				ID[in.dst] = ID[in.b];
+			}
+			break;
+		case D_SMOOTH_MIN: {
+			// polynomial smooth min, the surfaces blend within k of each other
+			float a = D[in.a], b = D[in.b];
+			float h = std::max(k[0] - fabs(a - b), 0.0f) / k[0];
+			if (b < a) ID[in.dst] = ID[in.b];
+			D[in.dst] = std::min(a, b) - h * h * k[0] * 0.25f;
+			break;
+		}
+		case D_MUL:
+			D[in.dst] = D[in.a] * k[0];
+			break;
+		case D_CELL_BOUND:
+			D[in.dst] = std::min(D[in.dst], cellBound(k, P[in.a]));
+			break;
+		}
+	}
+
+	return { D[result], ID[result], evals };
+}
+
+#ifdef __AVX2__
+
+static inline __m256 clamp8(__m256 x, __m256 lo, __m256 hi) {
+	return _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+}
+
+// cellRange() a lane each
+static inline void cellRange8(const float *g, __m256 u, __m256 &n, __m256 &lo, __m256 &hi) {
+	__m256 c = _mm256_set1_ps(g[0]), r = _mm256_set1_ps(g[4]);
+	__m256 first = _mm256_set1_ps(g[2]), last = _mm256_set1_ps(g[3]);
+	n = _mm256_floor_ps(_mm256_add_ps(_mm256_div_ps(u, c), _mm256_set1_ps(0.5f)));
+	lo = clamp8(_mm256_min_ps(_mm256_ceil_ps(_mm256_div_ps(_mm256_sub_ps(u, r), c)), n), first, last);
+	hi = clamp8(_mm256_max_ps(_mm256_floor_ps(_mm256_div_ps(_mm256_add_ps(u, r), c)), n), first, last);
+}
+
+static inline __m256 length8(__m256 x, __m256 y, __m256 z) {
+	return _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)));
+}
+
+// picks b where mask is set, a elsewhere
+static inline __m256i blend8(__m256i a, __m256i b, __m256 mask) {
+	return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), mask));
+}
+
+// the same instructions as eval(), each register holding a value per lane
+void SDFProgram::eval8(const float *x, const float *y, const float *z, float *dist, int *id) const {
+	__m256 PX[MAX_REGISTERS], PY[MAX_REGISTERS], PZ[MAX_REGISTERS];
+	__m256 D[MAX_REGISTERS];
+	__m256i ID[MAX_REGISTERS];
+	const float *c = consts.data();
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+
+	if (result < 0) {
+		for (int i = 0; i < 8; i++) {
+			dist[i] = std::numeric_limits<float>::infinity();
+			id[i] = -1;
+		}
+		return;
+	}
+
+	PX[0] = _mm256_loadu_ps(x);
+	PY[0] = _mm256_loadu_ps(y);
+	PZ[0] = _mm256_loadu_ps(z);
+	for (int pc = 0; pc < (int)code.size(); pc++) {
+		const Instr &in = code[pc];
+		const float *k = c + in.k;
+		switch (in.op) {
+		case P_TRANSLATE:
+			PX[in.dst] = _mm256_sub_ps(PX[in.a], _mm256_set1_ps(k[0]));
+			PY[in.dst] = _mm256_sub_ps(PY[in.a], _mm256_set1_ps(k[1]));
+			PZ[in.dst] = _mm256_sub_ps(PZ[in.a], _mm256_set1_ps(k[2]));
+			break;
+		case P_ROTATE: {
+			__m256 qx = PX[in.a], qy = PY[in.a], qz = PZ[in.a];
+			for (int r = 0; r < 3; r++) {
+				__m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(k[r]), qx),
+					_mm256_mul_ps(_mm256_set1_ps(k[3 + r]), qy)), _mm256_mul_ps(_mm256_set1_ps(k[6 + r]), qz));
+				(r == 0 ? PX : r == 1 ? PY : PZ)[in.dst] = v;
+			}
+			break;
+		}
+		case P_SCALE: {
+			__m256 s = _mm256_set1_ps(k[0]);
+			PX[in.dst] = _mm256_mul_ps(PX[in.a], s);
+			PY[in.dst] = _mm256_mul_ps(PY[in.a], s);
+			PZ[in.dst] = _mm256_mul_ps(PZ[in.a], s);
+			break;
+		}
+		case P_TWIST: {
+			// no vector sin/cos, so a lane at a time
+			alignas(32) float qx[8], qy[8], qz[8];
+			_mm256_store_ps(qx, PX[in.a]);
+			_mm256_store_ps(qy, PY[in.a]);
+			_mm256_store_ps(qz, PZ[in.a]);
+			for (int i = 0; i < 8; i++) {
+				float s = sin(k[0] * qy[i]), co = cos(k[0] * qy[i]);
+				float tx = co * qx[i] - s * qz[i];
+				qz[i] = s * qx[i] + co * qz[i];
+				qx[i] = tx;
+			}
+			PX[in.dst] = _mm256_load_ps(qx);
+			PY[in.dst] = PY[in.a];
+			PZ[in.dst] = _mm256_load_ps(qz);
+			break;
+		}
+		case P_CELL: {
+			// lanes that don't need the cell take one of their candidates in
+			// range instead, a copy they've seen already, and the cell is only
+			// skipped when none of the lanes need it
+			__m256 *axes[3] = { PX, PY, PZ };
+			__m256 need = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			__m256 len2 = zero;
+			for (int a = 0; a < 3; a++) {
+				const float *g = k + 1 + 5 * a;
+				float i = k[16 + a];
+				__m256 q = axes[a][in.a];
+				if (g[0] != 0) {
+					__m256 period = _mm256_set1_ps(g[0]);
+					__m256 u = _mm256_add_ps(q, _mm256_set1_ps(g[1]));
+					__m256 n, lo, hi;
+					cellRange8(g, u, n, lo, hi);
+					__m256 j = clamp8(n, lo, hi);
+					if (i > 0) {
+						// see cellPoint()
+						__m256 above = _mm256_cmp_ps(u, _mm256_mul_ps(n, period), _CMP_GE_OQ);
+						__m256 side = _mm256_blendv_ps(_mm256_set1_ps(-1), _mm256_set1_ps(1), above);
+						__m256 left = _mm256_sub_ps(j, lo), right = _mm256_sub_ps(hi, j);
+						__m256 nearer = _mm256_blendv_ps(left, right, above), further = _mm256_blendv_ps(right, left, above);
+						__m256 both = _mm256_min_ps(nearer, further);
+						__m256 ii = _mm256_set1_ps(i);
+						__m256 turns = _mm256_mul_ps(side, _mm256_set1_ps(floor((i + 1) / 2) * (fmod(i, 2) == 1 ? 1 : -1)));
+						__m256 rest = _mm256_mul_ps(_mm256_sub_ps(ii, both),
+							_mm256_blendv_ps(_mm256_xor_ps(side, sign), side, _mm256_cmp_ps(nearer, further, _CMP_GT_OQ)));
+						__m256 step = _mm256_blendv_ps(rest, turns, _mm256_cmp_ps(ii, _mm256_add_ps(both, both), _CMP_LE_OQ));
+						need = _mm256_and_ps(need, _mm256_cmp_ps(ii, _mm256_add_ps(left, right), _CMP_LE_OQ));
+						j = clamp8(_mm256_add_ps(j, step), lo, hi);
+					}
+					q = _mm256_sub_ps(u, _mm256_mul_ps(j, period));
+				}
+				axes[a][in.dst] = q;
+				len2 = _mm256_add_ps(len2, _mm256_mul_ps(q, q));
+			}
+			if (in.skip >= 0) {
+				need = _mm256_and_ps(need, _mm256_cmp_ps(_mm256_sub_ps(_mm256_sqrt_ps(len2), _mm256_set1_ps(k[0])), D[in.b], _CMP_LT_OQ));
+				if (!_mm256_movemask_ps(need)) pc = in.skip - 1;
+			}
+			break;
+		}
+		case D_SPHERE:
+			D[in.dst] = _mm256_sub_ps(length8(PX[in.a], PY[in.a], PZ[in.a]), _mm256_set1_ps(k[0]));
+			ID[in.dst] = _mm256_set1_epi32(in.id);
+			break;
+		case D_TORUS: {
+			__m256 qx = PX[in.a], qz = PZ[in.a];
+			__m256 rx = _mm256_sub_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qz, qz))), _mm256_set1_ps(k[0]));
+			D[in.dst] = _mm256_sub_ps(length8(rx, PY[in.a], zero), _mm256_set1_ps(k[1]));
+			ID[in.dst] = _mm256_set1_epi32(in.id);
+			break;
+		}
+		case D_PLANE:
+			D[in.dst] = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(PX[in.a], _mm256_set1_ps(k[0])),
+				_mm256_mul_ps(PY[in.a], _mm256_set1_ps(k[1]))), _mm256_mul_ps(PZ[in.a], _mm256_set1_ps(k[2]))), _mm256_set1_ps(k[3]));
+			ID[in.dst] = _mm256_set1_epi32(in.id);
+			break;
+		case D_BOX: {
+			__m256 qx = _mm256_sub_ps(_mm256_andnot_ps(sign, PX[in.a]), _mm256_set1_ps(k[0]));
+			__m256 qy = _mm256_sub_ps(_mm256_andnot_ps(sign, PY[in.a]), _mm256_set1_ps(k[1]));
+			__m256 qz = _mm256_sub_ps(_mm256_andnot_ps(sign, PZ[in.a]), _mm256_set1_ps(k[2]));
+			__m256 outside = length8(_mm256_max_ps(qx, zero), _mm256_max_ps(qy, zero), _mm256_max_ps(qz, zero));
+			__m256 inside = _mm256_min_ps(_mm256_max_ps(qx, _mm256_max_ps(qy, qz)), zero);
+			D[in.dst] = _mm256_add_ps(outside, inside);
+			ID[in.dst] = _mm256_set1_epi32(in.id);
+			break;
+		}
+		case D_MIN: {
+			__m256 m = _mm256_cmp_ps(D[in.b], D[in.a], _CMP_LT_OQ);
+			D[in.dst] = _mm256_blendv_ps(D[in.a], D[in.b], m);
+			ID[in.dst] = blend8(ID[in.a], ID[in.b], m);
+			break;
+		}
+		case D_MAX: {
+			__m256 m = _mm256_cmp_ps(D[in.b], D[in.a], _CMP_GT_OQ);
+			D[in.dst] = _mm256_blendv_ps(D[in.a], D[in.b], m);
+			ID[in.dst] = blend8(ID[in.a], ID[in.b], m);
+			break;
+		}
+		case D_SUBTRACT: {
+			__m256 nb = _mm256_xor_ps(D[in.b], sign);
+			__m256 m = _mm256_cmp_ps(nb, D[in.a], _CMP_GT_OQ);
+			D[in.dst] = _mm256_blendv_ps(D[in.a], nb, m);
+			ID[in.dst] = blend8(ID[in.a], ID[in.b], m);
+			break;
+		}
+		case D_SMOOTH_MIN: {
+			__m256 a = D[in.a], b = D[in.b];
+			__m256 kk = _mm256_set1_ps(k[0]);
+			__m256 h = _mm256_div_ps(_mm256_max_ps(_mm256_sub_ps(kk, _mm256_andnot_ps(sign, _mm256_sub_ps(a, b))), zero), kk);
+			__m256 m = _mm256_cmp_ps(b, a, _CMP_LT_OQ);
+			ID[in.dst] = blend8(ID[in.a], ID[in.b], m);
+			D[in.dst] = _mm256_sub_ps(_mm256_min_ps(a, b), _mm256_mul_ps(_mm256_mul_ps(h, h), _mm256_set1_ps(k[0] * 0.25f)));
+			break;
+		}
+		case D_MUL:
+			D[in.dst] = _mm256_mul_ps(D[in.a], _mm256_set1_ps(k[0]));
+			break;
+		case D_CELL_BOUND: {
+			__m256 *axes[3] = { PX, PY, PZ };
+			__m256 none = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+			__m256 extent = _mm256_set1_ps(k[0]), one = _mm256_set1_ps(1);
+			__m256 bound = none;
+			for (int a = 0; a < 3; a++) {
+				const float *g = k + 1 + 5 * a;
+				if (g[0] == 0) continue;
+				__m256 period = _mm256_set1_ps(g[0]);
+				__m256 u = _mm256_add_ps(axes[a][in.a], _mm256_set1_ps(g[1]));
+				__m256 n, lo, hi;
+				cellRange8(g, u, n, lo, hi);
+				__m256 below = _mm256_sub_ps(lo, one), above = _mm256_add_ps(hi, one);
+				__m256 db = _mm256_sub_ps(_mm256_sub_ps(u, _mm256_mul_ps(below, period)), extent);
+				__m256 da = _mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(above, period), u), extent);
+				bound = _mm256_min_ps(bound, _mm256_blendv_ps(none, db, _mm256_cmp_ps(below, _mm256_set1_ps(g[2]), _CMP_GE_OQ)));
+				bound = _mm256_min_ps(bound, _mm256_blendv_ps(none, da, _mm256_cmp_ps(above, _mm256_set1_ps(g[3]), _CMP_LE_OQ)));
+			}
+			D[in.dst] = _mm256_min_ps(D[in.dst], bound);
+			break;
+		}
+		}
+	}
+
+	_mm256_storeu_ps(dist, D[result]);
+	_mm256_storeu_si256((__m256i *)id, ID[result]);
+}
+
+#else
+
+void SDFProgram::eval8(const float *x, const float *y, const float *z, float *dist, int *id) const {
+	for (int i = 0; i < 8; i++) {
+		SceneHit hit = eval(glm::vec3(x[i], y[i], z[i]));
+		dist[i] = hit.dist;
+		id[i] = hit.id;
+	}
+}
+
+#endif
+
+string SDFProgram::disassemble() const {
+	static const char *names[] = {
+		"translate", "rotate", "scale", "twist", "cell",
+		"sphere", "torus", "plane", "box",
+		"min", "max", "subtract", "smin", "mul", "cellbound"
+	};
+	stringstream ss;
+	for (const Instr &in : code) {
+		bool point = in.op <= P_CELL;
+		bool binary = in.op >= D_MIN && in.op <= D_SMOOTH_MIN;
+		ss << names[in.op] << " " << (point ? "p" : "d") << (int)in.dst << ", ";
+		if (binary) ss << "d" << (int)in.a << ", d" << (int)in.b;
+		else ss << (in.op == D_MUL ? "d" : "p") << (int)in.a;
+		if (in.id >= 0 && !point) ss << "  (object " << in.id << ")";
+		if (in.op == P_CELL && in.skip >= 0) ss << "  (on to " << in.skip << " unless nearer than d" << (int)in.b << ")";
+		ss << "\n";
+	}
+	return ss.str();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "ofMain.h"
+
+struct SceneHit;
+
+//  Distance field expression graph
+//
+//  A scene is described as a tree of nodes: primitives at the leaves, CSG
+//  (union, intersection, subtraction, smooth union) combining them, and domain
+//  operations (translate, rotate, scale, twist, repetition) warping the point
+//  a subtree is evaluated at.  The builder functions return the index of the
+//  new node, e.g. the Midterm scene is
+//
+//		SDFGraph g;
+//		int torus = g.rotate(g.torus(glm::vec2(1, 0.33), 0), 60, glm::vec3(1, 0, 0));
+//		int root = g.repeat(torus, glm::vec3(3.5));
+//
+//  Repetition works on any subtree and checks the neighbouring copies where
+//  they can reach into a cell, so the child may be bigger than half a cell
+//  (see sdf::Grid in sdfTemplates.h for how).
+//
+//  The graph itself is never evaluated, it gets compiled into an SDFProgram.
+//
+class SDFGraph {
+public:
+	enum Op {
+		SPHERE, TORUS, PLANE, BOX,
+		UNION, INTERSECT, SUBTRACT, SMOOTH_UNION,
+		TRANSLATE, ROTATE, SCALE, TWIST, REPEAT
+	};
+
+	struct Node {
+		Op op;
+		int a = -1, b = -1;			// children, b only for CSG
+		glm::vec3 v;				// offset, rotation axis, normal, box size or period
+		glm::vec2 t;				// torus radii
+		glm::ivec3 count = glm::ivec3(0);	// copies per axis for repeat, 0 for no end to them
+		float f = 0;				// radius, angle (degrees), plane height, scale, twist rate or blend radius
+		int id = -1;				// for primitives, the scene object it stands for
+		bool enabled = true;		// disabled nodes are pruned along with everything under them
+	};
+
+	// primitives, centered at the origin.  id is reported back by the program
+	// when the primitive is the closest surface
+	//
+	int sphere(float radius, int id);
+	int torus(glm::vec2 t, int id);
+	int plane(glm::vec3 normal, float height, int id);		// dot(p, normal) - height
+	int box(glm::vec3 halfSize, int id);
+
+	int unite(int a, int b);
+	int intersect(int a, int b);
+	int subtract(int a, int b);			// a with b carved out
+	int smoothUnion(int a, int b, float k);
+
+	int translate(int a, glm::vec3 offset);
+	int rotate(int a, float degrees, glm::vec3 axis);
+	int scale(int a, float s);
+	int twist(int a, float rate);		// radians around y per unit of y
+	int repeat(int a, glm::vec3 period, glm::ivec3 count = glm::ivec3(0));	// 0 period leaves an axis alone
+
+	//  radius of a sphere around the origin holding every surface under node,
+	//  infinity if none does (planes, endless repetition)
+	//
+	float extent(int node) const;
+
+	vector<Node> nodes;
+
+private:
+	int add(const Node &n);
+};
+
+//  A compiled SDFGraph: a flat list of instructions over two small register
+//  files, one of points and one of (distance, id) pairs.  eval() is a single
+//  loop over the instructions with a switch - no virtual calls, no walking a
+//  tree of pointers, and everything it touches sits in two arrays.  The one
+//  jump is P_CELL's, past a neighbouring copy of a repeated subtree that no
+//  point needs.
+//
+//  compile() simplifies the graph first: disabled subtrees are dropped along
+//  with the CSG around them, identity transforms (no offset, no rotation,
+//  scale 1, no twist) disappear, chains of translations or scales collapse
+//  into one, and a smooth union with no blend becomes a plain union.  Compile
+//  again whenever the scene changes, it only takes microseconds.
+//
+class SDFProgram {
+public:
+	static const int MAX_REGISTERS = 16;
+
+	//  false if the graph is empty after pruning, or needs more registers than
+	//  there are; eval() then reports nothing in the scene
+	//
+	bool compile(const SDFGraph &graph, int root);
+
+	SceneHit eval(const glm::vec3 &p) const;
+
+	//  eval() for 8 points at once, one per AVX2 lane.  the points come in as
+	//  arrays of x, y and z and the distances and ids go out the same way.
+	//  built without AVX2 (-mavx2, /arch:AVX2) it calls eval() for each point
+	//
+	void eval8(const float *x, const float *y, const float *z, float *dist, int *id) const;
+
+	int size() const { return code.size(); }
+	int primitives() const { return primitiveCount; }
+	string disassemble() const;
+
+private:
+	enum Opcode : uint8_t {
+		P_TRANSLATE, P_ROTATE, P_SCALE, P_TWIST, P_CELL,
+		D_SPHERE, D_TORUS, D_PLANE, D_BOX,
+		D_MIN, D_MAX, D_SUBTRACT, D_SMOOTH_MIN, D_MUL, D_CELL_BOUND
+	};
+
+	struct Instr {
+		Opcode op;
+		uint8_t dst, a, b;			// registers: P_ ops write points, D_ ops write distances
+		int k;						// first constant in consts
+		int id;						// scene object, for primitives
+		int skip = -1;				// P_CELL: where to carry on when no point needs the cell
+	};
+
+	int fold(const SDFGraph &in, int node, SDFGraph &out);
+	int emit(const SDFGraph &graph, int node, int pointReg);
+	int emitRepeat(const SDFGraph &graph, const SDFGraph::Node &n, int pointReg);
+	int allocPoint();
+	int allocDist();
+
+	vector<Instr> code;
+	vector<float> consts;
+	int result = -1;				// distance register holding the answer
+	int primitiveCount = 0;
+
+	// compile time register bookkeeping
+	vector<int> freePoints, freeDists;
+	int pointRegs = 0, distRegs = 0;
+	bool bOverflow = false;
+};
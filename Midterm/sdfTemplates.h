@@ -0,0 +1,246 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Distance fields composed at compile time
+//
+//  Every node is a small struct with a const operator() giving the distance
+//  at p, and the combinators are templates over their children, so a scene
+//  like
+//
+//		auto field = sdf::opRep(sdf::rotate(sdf::Torus{ glm::vec2(1, 0.33) }, 60, glm::vec3(1, 0, 0)), glm::vec3(3.5));
+//
+//  is a single type whose operator() the compiler can inline all the way
+//  down - no virtual calls, no interpreter, nothing to look up at run time.
+//  The price is that the scene is fixed when the code is compiled; for
+//  scenes that change use SDFProgram (sdfProgram.h) instead.
+//
+//  Pass a field to ofApp::march() to ray march it.
+//
+//  extent() is the radius of a sphere around the origin that holds every
+//  surface of the node, infinity when nothing does.  Repeat needs it to know
+//  which neighbouring copies can reach into a cell.
+//
+namespace sdf {
+
+	const float UNBOUNDED = std::numeric_limits<float>::infinity();
+
+	// primitives, centered at the origin
+
+	struct Sphere {
+		float radius;
+		float operator()(const glm::vec3 &p) const { return glm::length(p) - radius; }
+		float extent() const { return radius; }
+	};
+
+	struct Torus {
+		glm::vec2 t;
+		float operator()(const glm::vec3 &p) const {
+			glm::vec2 q = glm::vec2(glm::length(glm::vec2(p.x, p.z)) - t.x, p.y);
+			return glm::length(q) - t.y;
+		}
+		float extent() const { return t.x + t.y; }
+	};
+
+	struct Plane {
+		glm::vec3 normal;			// normalized
+		float height;
+		float operator()(const glm::vec3 &p) const { return glm::dot(p, normal) - height; }
+		float extent() const { return UNBOUNDED; }
+	};
+
+	struct Box {
+		glm::vec3 halfSize;
+		float operator()(const glm::vec3 &p) const {
+			glm::vec3 q = glm::abs(p) - halfSize;
+			return glm::length(glm::max(q, glm::vec3(0))) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+		}
+		float extent() const { return glm::length(halfSize); }
+	};
+
+	// csg
+
+	template<typename A, typename B>
+	struct Union {
+		A a;
+		B b;
+		float operator()(const glm::vec3 &p) const { return std::min(a(p), b(p)); }
+		float extent() const { return std::max(a.extent(), b.extent()); }
+	};
+
+	template<typename A, typename B>
+	struct Intersection {
+		A a;
+		B b;
+		float operator()(const glm::vec3 &p) const { return std::max(a(p), b(p)); }
+		float extent() const { return std::min(a.extent(), b.extent()); }
+	};
+
+	template<typename A, typename B>
+	struct Subtraction {
+		A a;
+		B b;
+		float operator()(const glm::vec3 &p) const { return std::max(a(p), -b(p)); }
+		float extent() const { return a.extent(); }
+	};
+
+	// polynomial smooth min, the surfaces blend within k of each other
+	template<typename A, typename B>
+	struct SmoothUnion {
+		A a;
+		B b;
+		float k;
+		float operator()(const glm::vec3 &p) const {
+			float da = a(p), db = b(p);
+			float h = std::max(k - fabs(da - db), 0.0f) / k;
+			return std::min(da, db) - h * h * k * 0.25f;
+		}
+		float extent() const { return std::max(a.extent(), b.extent()) + k * 0.25f; }		// the blend adds at most k / 4
+	};
+
+	// domain operations, they move the point into the child's space
+
+	template<typename A>
+	struct Translate {
+		A a;
+		glm::vec3 offset;
+		float operator()(const glm::vec3 &p) const { return a(p - offset); }
+		float extent() const { return a.extent() + glm::length(offset); }
+	};
+
+	template<typename A>
+	struct Rotate {
+		A a;
+		glm::mat3 inverse;
+		float operator()(const glm::vec3 &p) const { return a(inverse * p); }
+		float extent() const { return a.extent(); }
+	};
+
+	//  Copies of a child every period along each axis, count of them centered
+	//  on the origin or without end.  Copy j of an axis sits at j * period once
+	//  the point is shifted by shift(), so the nearest one is round(u / period).
+	//
+	//  Folding the point into the nearest cell is only right while the child
+	//  stays well inside its cell.  Instead every copy within reach() of the
+	//  point along each axis is a candidate, cells() of them at most.  The
+	//  nearest is evaluated first, the others only if the sphere around them
+	//  is closer than the best distance so far.  Copies outside that range
+	//  are more than a quarter period away from every point of the cell,
+	//  outside() gives how far, and the distance is never more than that.
+	//  So steps near a cell wall stay safe without getting shorter than that
+	//  quarter period, and outside a limited grid they run straight to it.
+	//
+	//  A child without an extent (a plane, an endless repeat) can't bound its
+	//  neighbours, it only gets the nearest copy the way a plain fold does.
+	//
+	struct Grid {
+		glm::vec3 period;			// 0 leaves an axis alone
+		glm::ivec3 count;			// copies along each axis, 0 for no end to them
+		float extent;				// of the child, see above
+
+		float shift(int a) const { return count[a] > 0 ? 0.5f * (count[a] - 1) * period[a] : 0; }
+		float first(int a) const { return count[a] > 0 ? 0 : -UNBOUNDED; }
+		float last(int a) const { return count[a] > 0 ? count[a] - 1 : UNBOUNDED; }
+		float reach(int a) const { return extent + 0.25f * period[a]; }
+
+		// the most candidates along axis a, the whole numbers within reach of any u
+		int cells(int a) const {
+			if (period[a] == 0 || extent == UNBOUNDED) return 1;
+			int n = (int)floor(2 * reach(a) / period[a]) + 1;
+			return count[a] > 0 ? std::min(n, count[a]) : n;
+		}
+
+		// the nearest copy and the range of candidates along axis a for u (the point shifted)
+		void range(float u, int a, float &nearest, float &lo, float &hi) const {
+			float c = period[a];
+			if (c == 0) {
+				nearest = lo = hi = 0;
+				return;
+			}
+			float n = floor(u / c + 0.5f);
+			nearest = ofClamp(n, first(a), last(a));
+			lo = hi = nearest;
+			if (extent == UNBOUNDED) return;
+			lo = ofClamp(std::min(ceil((u - reach(a)) / c), n), first(a), last(a));
+			hi = ofClamp(std::max(floor((u + reach(a)) / c), n), first(a), last(a));
+		}
+
+		// no copy outside [lo, hi] on every axis is closer than this
+		float outside(const glm::vec3 &u, const glm::vec3 &lo, const glm::vec3 &hi) const {
+			float bound = UNBOUNDED;
+			if (extent == UNBOUNDED) return bound;
+			for (int a = 0; a < 3; a++) {
+				float c = period[a];
+				if (c == 0) continue;
+				if (lo[a] - 1 >= first(a)) bound = std::min(bound, u[a] - (lo[a] - 1) * c - extent);
+				if (hi[a] + 1 <= last(a)) bound = std::min(bound, (hi[a] + 1) * c - u[a] - extent);
+			}
+			return bound;
+		}
+
+		// the extent of all the copies together
+		float span() const {
+			if (extent == UNBOUNDED) return UNBOUNDED;
+			glm::vec3 half(0);
+			for (int a = 0; a < 3; a++) {
+				if (period[a] != 0 && count[a] <= 0) return UNBOUNDED;
+				half[a] = shift(a);
+			}
+			return glm::length(half) + extent;
+		}
+
+		template<typename F>
+		float operator()(const F &f, const glm::vec3 &p) const {
+			glm::vec3 u, nearest, lo, hi;
+			for (int a = 0; a < 3; a++) {
+				u[a] = p[a] + shift(a);
+				range(u[a], a, nearest[a], lo[a], hi[a]);
+			}
+			float dist = f(u - nearest * period);
+			for (float z = lo.z; z <= hi.z; z++) {
+				for (float y = lo.y; y <= hi.y; y++) {
+					for (float x = lo.x; x <= hi.x; x++) {
+						glm::vec3 j(x, y, z);
+						if (j == nearest) continue;
+						glm::vec3 q = u - j * period;
+						if (glm::length(q) - extent < dist) dist = std::min(dist, f(q));
+					}
+				}
+			}
+			return std::min(dist, outside(u, lo, hi));
+		}
+	};
+
+	template<typename A>
+	struct Repeat {
+		A a;
+		Grid grid;
+		float operator()(const glm::vec3 &p) const { return grid(a, p); }
+		float extent() const { return grid.span(); }
+	};
+
+	template<typename A, typename B>
+	Union<A, B> unite(const A &a, const B &b) { return { a, b }; }
+
+	template<typename A, typename B>
+	Intersection<A, B> intersect(const A &a, const B &b) { return { a, b }; }
+
+	template<typename A, typename B>
+	Subtraction<A, B> subtract(const A &a, const B &b) { return { a, b }; }
+
+	template<typename A, typename B>
+	SmoothUnion<A, B> smoothUnion(const A &a, const B &b, float k) { return { a, b, k }; }
+
+	template<typename A>
+	Translate<A> translate(const A &a, glm::vec3 offset) { return { a, offset }; }
+
+	// same convention as Torus::sdf, degrees around axis
+	template<typename A>
+	Rotate<A> rotate(const A &a, float degrees, glm::vec3 axis) {
+		return { a, glm::mat3(glm::inverse(glm::rotate(glm::mat4(1.0), glm::radians(degrees), axis))) };
+	}
+
+	// count copies along each axis, 0 for endless ones
+	template<typename A>
+	Repeat<A> opRep(const A &a, glm::vec3 period, glm::ivec3 count = glm::ivec3(0)) { return { a, Grid{ period, count, a.extent() } }; }
+}
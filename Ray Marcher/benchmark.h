@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ofMain.h"
+#include <chrono>
+#include <random>
+
+//  Timing harness for the render kernels.
+//
+//  Each result is a named measurement with its wall time and the counters
+//  (rays, sdf evals, pixels, ...) collected while it ran.  Rates per second
+//  are derived from the counters when the results are written.  save() appends
+//  the whole run as one line of JSON so runs can be compared over time.
+//
+class Benchmark {
+public:
+	struct Result {
+		string name;
+		double seconds = 0;
+		vector<pair<string, double>> counters;
+	};
+
+	Benchmark(const string &app) { this->app = app; }
+
+	void start() { begin = std::chrono::high_resolution_clock::now(); }
+
+	// seconds since the last start()
+	//
+	double stop() {
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+		return elapsed.count();
+	}
+
+	void add(const string &name, double seconds, const vector<pair<string, double>> &counters) {
+		Result r;
+		r.name = name;
+		r.seconds = seconds;
+		r.counters = counters;
+		results.push_back(r);
+	}
+
+	//  Microbenchmark - calls fn(i) for i in [0, iterations) and records the
+	//  time per call.  fn returns a float that is summed into a sink so the
+	//  compiler can't throw the work away.
+	//
+	template<typename F>
+	void micro(const string &name, int iterations, F fn) {
+		volatile float sink = 0;
+		for (int i = 0; i < iterations / 10; i++) sink = sink + fn(i);		// warm up caches
+
+		start();
+		float sum = 0;
+		for (int i = 0; i < iterations; i++) sum += fn(i);
+		double seconds = stop();
+		sink = sink + sum;
+
+		add(name, seconds, { { "calls", (double)iterations }, { "ns_per_call", seconds * 1e9 / iterations } });
+	}
+
+	//  Fixed set of points in the box (lo, hi).  minstd_rand is fully specified
+	//  by the standard, so every platform and every run gets the same points.
+	//
+	static vector<glm::vec3> samplePoints(int n, glm::vec3 lo, glm::vec3 hi, unsigned seed = 116) {
+		std::minstd_rand rng(seed);
+		auto unit = [&rng]() { return (float)(rng() - rng.min()) / (float)(rng.max() - rng.min()); };
+
+		vector<glm::vec3> points;
+		for (int i = 0; i < n; i++) {
+			float x = unit(), y = unit(), z = unit();
+			points.push_back(lo + glm::vec3(x, y, z) * (hi - lo));
+		}
+		return points;
+	}
+
+	void print() {
+		for (const Result &r : results) {
+			cout << r.name << ": " << r.seconds << " s";
+			for (const auto &c : r.counters) {
+				if (isRate(c.first)) cout << ", " << c.first << " " << c.second;
+				else cout << ", " << c.first << " " << c.second << " (" << c.second / r.seconds << "/s)";
+			}
+			cout << endl;
+		}
+	}
+
+	//  append the run to filename (in the data folder) as a single line of JSON
+	//
+	bool save(const string &filename) {
+		ofstream out(ofToDataPath(filename), ios::app);
+		if (!out.is_open()) {
+			ofLogError("Benchmark") << "couldn't open " << filename;
+			return false;
+		}
+		out << toJSON() << endl;
+		return true;
+	}
+
+	string toJSON() {
+		stringstream ss;
+		ss.precision(9);
+		ss << "{\"app\":\"" << app << "\",\"timestamp\":\"" << ofGetTimestampString("%Y-%m-%dT%H:%M:%S")
+			<< "\",\"threads\":" << std::thread::hardware_concurrency() << ",\"results\":[";
+		for (int i = 0; i < results.size(); i++) {
+			const Result &r = results[i];
+			if (i > 0) ss << ",";
+			ss << "{\"name\":\"" << r.name << "\",\"wall_s\":" << r.seconds;
+			for (const auto &c : r.counters) {
+				ss << ",\"" << c.first << "\":" << c.second;
+				if (!isRate(c.first) && r.seconds > 0) ss << ",\"" << c.first << "_per_s\":" << c.second / r.seconds;
+			}
+			ss << "}";
+		}
+		ss << "]}";
+		return ss.str();
+	}
+
+	string app;
+	vector<Result> results;
+
+private:
+	// counters that are already a per-call figure don't get a rate
+	static bool isRate(const string &counter) { return counter.find("_per_") != string::npos; }
+
+	std::chrono::high_resolution_clock::time_point begin;
+};
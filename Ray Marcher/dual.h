@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Dual numbers for sdf gradients
+//
+//  A Dual is a value together with its gradient with respect to the point an
+//  sdf is evaluated at.  Written over Duals instead of floats, an sdf gives
+//  the distance and its gradient - the surface normal - in one pass, where
+//  finite differences need four evaluations of it.  Start from
+//  Dual3::point(p) and the arithmetic below carries out the chain rule.
+//
+struct Dual {
+	float v;			// value
+	glm::vec3 d;		// gradient
+
+	Dual(float v = 0, const glm::vec3 &d = glm::vec3(0)) : v(v), d(d) {}
+};
+
+inline Dual operator+(const Dual &a, const Dual &b) { return Dual(a.v + b.v, a.d + b.d); }
+inline Dual operator-(const Dual &a, const Dual &b) { return Dual(a.v - b.v, a.d - b.d); }
+inline Dual operator*(const Dual &a, const Dual &b) { return Dual(a.v * b.v, a.d * b.v + b.d * a.v); }
+inline Dual operator-(const Dual &a) { return Dual(-a.v, -a.d); }
+
+inline Dual operator+(const Dual &a, float b) { return Dual(a.v + b, a.d); }
+inline Dual operator+(float a, const Dual &b) { return Dual(a + b.v, b.d); }
+inline Dual operator-(const Dual &a, float b) { return Dual(a.v - b, a.d); }
+inline Dual operator-(float a, const Dual &b) { return Dual(a - b.v, -b.d); }
+inline Dual operator*(const Dual &a, float b) { return Dual(a.v * b, a.d * b); }
+inline Dual operator*(float a, const Dual &b) { return Dual(a * b.v, a * b.d); }
+
+//  the gradient of sqrt is undefined at 0, it's left at 0 there
+inline Dual sqrt(const Dual &a) {
+	float s = std::sqrt(a.v);
+	return Dual(s, s > 0 ? a.d * (0.5f / s) : glm::vec3(0));
+}
+
+//  a point whose coordinates are Duals
+struct Dual3 {
+	Dual x, y, z;
+
+	//  p itself, the variable everything is differentiated against
+	static Dual3 point(const glm::vec3 &p) {
+		return { Dual(p.x, glm::vec3(1, 0, 0)), Dual(p.y, glm::vec3(0, 1, 0)), Dual(p.z, glm::vec3(0, 0, 1)) };
+	}
+
+	glm::vec3 value() const { return glm::vec3(x.v, y.v, z.v); }
+};
+
+inline Dual3 operator-(const Dual3 &a, const glm::vec3 &b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline Dual3 operator*(const Dual3 &a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+
+inline Dual length(const Dual &x, const Dual &y) { return sqrt(x * x + y * y); }
+inline Dual length(const Dual3 &a) { return sqrt(a.x * a.x + a.y * a.y + a.z * a.z); }
+
+//  m * (p, 1), an affine transform of the point
+inline Dual3 transform(const glm::mat4 &m, const Dual3 &p) {
+	return {
+		p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+		p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+		p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2]
+	};
+}
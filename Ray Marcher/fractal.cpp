@@ -0,0 +1,150 @@
+#include "fractal.h"
+
+float FractalDE::distance(const glm::vec3 &p, int iterations, glm::vec4 *trap) const {
+	// half a radius out from the bounding sphere the distance to it will do
+	float r = glm::length(p);
+	float b = bound();
+	glm::vec4 t;
+	if (r > b * 1.5f) {
+		if (trap) *trap = glm::vec4(glm::abs(p), r * r);
+		return r - b;
+	}
+
+	float d;
+	switch (kind) {
+	case MENGER: d = menger(p, iterations, t); break;
+	case JULIA: d = julia(p, iterations, t); break;
+	default: d = mandelbulb(p, iterations, t); break;
+	}
+	if (trap) *trap = t;
+	return d;
+}
+
+// z -> z^power + p with z in spherical coordinates around y.  dr is the
+// derivative of |z| as it goes, power * r^(power - 1) * dr + 1
+float FractalDE::mandelbulb(const glm::vec3 &p, int iterations, glm::vec4 &trap) const {
+	glm::vec3 w = p;
+	float m = glm::dot(w, w);
+	float dr = 1;
+	trap = glm::vec4(glm::abs(w), m);
+
+	for (int i = 0; i < iterations; i++) {
+		float x = w.x, y = w.y, z = w.z;
+		float x2 = x * x, y2 = y * y, z2 = z * z;
+		if (power == 8 && x2 + z2 > 1e-4f) {
+			// the same as the trig below multiplied out for power 8 (Quilez).
+			// (x^2 + z^2)^-3.5 goes past what a float holds near the y axis,
+			// so there it's left to the trig
+			dr = 8 * pow(m, 3.5f) * dr + 1;
+			float x4 = x2 * x2, y4 = y2 * y2, z4 = z2 * z2;
+			float k3 = x2 + z2;
+			float k2 = 1 / sqrt(k3 * k3 * k3 * k3 * k3 * k3 * k3);
+			float k1 = x4 + y4 + z4 - 6 * y2 * z2 - 6 * x2 * y2 + 2 * z2 * x2;
+			float k4 = x2 - y2 + z2;
+			w.x = p.x + 64 * x * y * z * (x2 - z2) * k4 * (x4 - 6 * x2 * z2 + z4) * k1 * k2;
+			w.y = p.y - 16 * y2 * k3 * k4 * k4 + k1 * k1;
+			w.z = p.z - 8 * y * k4 * (x4 * x4 - 28 * x4 * x2 * z2 + 70 * x4 * z4 - 28 * x2 * z2 * z4 + z4 * z4) * k1 * k2;
+		}
+		else {
+			float r = sqrt(m);
+			dr = power * pow(r, power - 1) * dr + 1;
+			if (r > 0) {
+				float theta = power * acos(ofClamp(y / r, -1.0f, 1.0f));
+				float phi = power * atan2(x, z);
+				w = p + pow(r, power) * glm::vec3(sin(theta) * sin(phi), cos(theta), sin(theta) * cos(phi));
+			}
+			else w = p;
+		}
+
+		m = glm::dot(w, w);
+		trap = glm::min(trap, glm::vec4(glm::abs(w), m));
+		if (m > 256) break;
+	}
+
+	// 0.5 * log(r) * r / dr, with log(r) = 0.5 * log(m).  the origin is the
+	// one point that never moves, and it's inside
+	if (m == 0) return 0;
+	return 0.25f * log(m) * sqrt(m) / dr;
+}
+
+// the cube, and at every level the cross through the middle of each of the
+// cells it is cut into (Quilez).  each cross is an exact distance at its
+// scale, so the largest of them is the distance to what is left
+float FractalDE::menger(const glm::vec3 &p, int iterations, glm::vec4 &trap) const {
+	glm::vec3 q = glm::abs(p) - 1.0f;
+	float d = glm::length(glm::max(q, 0.0f)) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+	trap = glm::vec4(1, 1, 1, 0);
+
+	float s = 1;
+	for (int i = 0; i < iterations; i++) {
+		glm::vec3 a = p * s;
+		a = a - 2.0f * glm::floor(a * 0.5f) - 1.0f;			// into the cell, -1 to 1
+		s *= 3;
+		glm::vec3 r = glm::abs(1.0f - 3.0f * glm::abs(a));
+		float da = std::max(r.x, r.y), db = std::max(r.y, r.z), dc = std::max(r.z, r.x);
+		float cross = (std::min(da, std::min(db, dc)) - 1) / s;
+		if (cross > d) {
+			d = cross;
+			trap.w = (i + 1.0f) / iterations;
+		}
+		trap = glm::vec4(glm::min(glm::vec3(trap), glm::abs(a)), trap.w);
+	}
+	return d;
+}
+
+// q -> q^2 + c, with |dq| carried along as its square md2 (d(q^2) = 2 q dq)
+float FractalDE::julia(const glm::vec3 &p, int iterations, glm::vec4 &trap) const {
+	glm::vec4 z(p, 0);
+	float mz2 = glm::dot(z, z);
+	float md2 = 1;
+	trap = glm::vec4(glm::abs(p), mz2);
+
+	for (int i = 0; i < iterations; i++) {
+		md2 *= 4 * mz2;
+		z = glm::vec4(z.x * z.x - z.y * z.y - z.z * z.z - z.w * z.w, 2 * z.x * z.y, 2 * z.x * z.z, 2 * z.x * z.w) + c;
+		mz2 = glm::dot(z, z);
+		trap = glm::min(trap, glm::vec4(glm::abs(glm::vec3(z)), mz2));
+		if (mz2 > 16) break;
+	}
+
+	// 0.5 * |q| * log|q| / |dq|
+	return 0.25f * sqrt(mz2 / md2) * log(mz2);
+}
+
+// a point further out than this gets further out every iteration: for the
+// bulb when r^(power - 1) > 2, for the Julia set when r^2 - r > |c|
+float FractalDE::bound() const {
+	switch (kind) {
+	case MENGER: return sqrt(3.0f);
+	case JULIA: return (1 + sqrt(1 + 4 * glm::length(c))) / 2;
+	default: return pow(2.0f, 1 / (std::max(power, 2.0f) - 1));
+	}
+}
+
+float FractalDE::shrink() const {
+	switch (kind) {
+	case MENGER: return 3;
+	case JULIA: return 2;
+	default: return std::max(power, 2.0f);
+	}
+}
+
+int FractalDE::iterationsFor(float detail) const {
+	if (detail <= 0) return iterations;
+	int n = ceil(log(bound() / detail) / log(shrink())) + 1;
+	return ofClamp(n, 2, iterations);
+}
+
+string FractalDE::kindName(Kind kind) {
+	switch (kind) {
+	case MENGER: return "menger";
+	case JULIA: return "julia";
+	default: return "mandelbulb";
+	}
+}
+
+FractalDE::Kind FractalDE::kindFromName(const string &name) {
+	if (name == "menger") return MENGER;
+	if (name == "julia") return JULIA;
+	return MANDELBULB;
+}
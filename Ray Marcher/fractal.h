@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Distance estimators for three 3D fractals, the 3D cousins of the
+//  Mandelbrot app's set.
+//
+//		MANDELBULB		z -> z^power + p in spherical coordinates, with the
+//						distance from the running derivative (0.5 log r r / dr)
+//		MENGER			a cube with the cross of holes cut out again at every
+//						third of the scale
+//		JULIA			q -> q^2 + c over quaternions, the 3D slice w = 0
+//
+//  All of them work in the fractal's own units, where it fits inside a
+//  sphere of bound() around the origin.  Half that radius out from the
+//  sphere, distance() returns the distance to the sphere without iterating.
+//  That distance is a lower bound.
+//
+//  The estimate is only as detailed as its iterations.  Every iteration adds
+//  detail about shrink() times smaller than the last, so iterationsFor()
+//  stops once the detail is finer than what a pixel can show.  Stopping
+//  early drops that detail, which leaves a bigger shape around the full
+//  one.  For the Menger sponge that holds exactly.  For the other two the
+//  shallower estimate comes out a little further in a few percent of
+//  points, by about the size of the detail left out.
+//
+//  trap gets the orbit trap of the point for shading: the smallest |x|, |y|
+//  and |z| the orbit came to, and in w the smallest squared radius (for
+//  the Menger sponge, how deep the hole it is on was cut, 0 to 1).
+//
+class FractalDE {
+public:
+	enum Kind { MANDELBULB, MENGER, JULIA };
+
+	Kind kind = MANDELBULB;
+	float power = 8;							// of the Mandelbulb, 8 has a trig free fast path
+	int iterations = 10;						// the most distance() is asked for
+	glm::vec4 c = glm::vec4(-0.291, -0.399, 0.339, 0.437);	// of the Julia set
+
+	float distance(const glm::vec3 &p, int iterations, glm::vec4 *trap = nullptr) const;
+	float bound() const;
+	float shrink() const;
+
+	//  iterations to show detail down to size detail (in the fractal's units)
+	//
+	int iterationsFor(float detail) const;
+
+	static string kindName(Kind kind);
+	static Kind kindFromName(const string &name);
+
+private:
+	float mandelbulb(const glm::vec3 &p, int iterations, glm::vec4 &trap) const;
+	float menger(const glm::vec3 &p, int iterations, glm::vec4 &trap) const;
+	float julia(const glm::vec3 &p, int iterations, glm::vec4 &trap) const;
+};
@@ -1,13 +1,75 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "ofAppNoWindow.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char *argv[]){
+	ofApp *app = new ofApp();
+
+	// --benchmark renders the canonical scene without a window, appends the
+	// timings to bin/data/benchmark.json and exits
+	// --check also compares the renders against bin/data/golden/ and exits
+	// with 1 on a regression, --bless rewrites the references
+	// --psnr <dB> and --slowdown <fraction> set the tolerances
+	// --jpeg-quality <best|high|medium|low|worst> sets how much JPG renders are compressed (best)
+	// --threads <n> renders with n threads instead of one per core
+	// --fd-normals takes every normal from finite differences, even where the object has sdfDual()
+	// --shadow-k <k> sets how soft the ray marched shadows are, bigger is harder (default 8)
+	// --relax <w> ray marches with over-relaxed steps of w * dist (1.2 - 1.9)
+	// --no-cones marches every primary ray from the camera, without the cone pre-pass
+	// --fractal <mandelbulb|menger|julia> puts that fractal over the plane instead of
+	// the sphere and torus, --power <n> (8) and --iterations <n> (10) set its estimator
+	// --no-lod iterates fractals as deep as --iterations everywhere, not just up close
+	// --heatmap also writes the march steps of every pixel to marchHeatmap.PNG,
+	// how each one ended to marchEnd.PNG and a histogram to marchHistogram.txt
+	// --coordinator <port> ray marches the scene on worker processes and exits
+	// --worker <host:port> renders tiles for a coordinator and exits when it's done
+	// --server <port> keeps running and renders requests from clients (see renderServer.h)
+	//
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--benchmark") app->bBenchmark = true;
+		else if (arg == "--check") app->check.enabled = true;
+		else if (arg == "--bless") app->check.enabled = app->check.bless = true;
+		else if (arg == "--psnr" && i + 1 < argc) app->check.minPSNR = ofToFloat(argv[++i]);
+		else if (arg == "--slowdown" && i + 1 < argc) app->check.maxSlowdown = ofToFloat(argv[++i]);
+		else if (arg == "--jpeg-quality" && i + 1 < argc) app->saver.setQuality(ImageSaver::qualityFromName(argv[++i]));
+		else if (arg == "--threads" && i + 1 < argc) app->numThreads = ofToInt(argv[++i]);
+		else if (arg == "--fd-normals") app->bDualNormals = false;
+		else if (arg == "--shadow-k" && i + 1 < argc) app->shadowK = ofToFloat(argv[++i]);
+		else if (arg == "--relax" && i + 1 < argc) app->relaxation = ofToFloat(argv[++i]);
+		else if (arg == "--no-cones") app->bCones = false;
+		else if (arg == "--fractal" && i + 1 < argc) {
+			app->bFractalScene = true;
+			app->fractalKind = FractalDE::kindFromName(argv[++i]);
+		}
+		else if (arg == "--power" && i + 1 < argc) app->fractalPower = ofToFloat(argv[++i]);
+		else if (arg == "--iterations" && i + 1 < argc) app->fractalIterations = ofToInt(argv[++i]);
+		else if (arg == "--no-lod") app->bFractalLOD = false;
+		else if (arg == "--heatmap") app->bHeatmap = true;
+		else if (arg == "--coordinator") {
+			app->bCoordinator = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') app->coordinatorPort = ofToInt(argv[++i]);
+		}
+		else if (arg == "--worker" && i + 1 < argc) app->workerAddress = argv[++i];
+		else if (arg == "--server") {
+			app->bServer = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') app->serverPort = ofToInt(argv[++i]);
+		}
+	}
+	if (app->check.enabled) app->bBenchmark = true;
+
+	if (app->bBenchmark || app->bCoordinator || !app->workerAddress.empty() || app->bServer) {
+		ofAppNoWindow window;
+		ofSetupOpenGL(&window, 1024, 768, OF_WINDOW);
+		return ofRunApp(app);
+	}
+
 	ofSetupOpenGL(1024,768,OF_WINDOW);			// <-------- setup the GL context
 
 	// this kicks off the running of my app
 	// can be OF_WINDOW or OF_FULLSCREEN
 	// pass in width and height too:
-	ofRunApp(new ofApp());
+	ofRunApp(app);
 
 }
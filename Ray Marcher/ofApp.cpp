@@ -72,8 +72,15 @@ void ofApp::setup() {
 	scene.push_back(new Plane(glm::vec3(0, -2, 0), glm::vec3(0, 1, 0), ofColor::whiteSmoke));
 	
 	//scene.push_back(new Sphere(glm::vec3(-4, 1, 0), 1.25, ofColor::red));
-	scene.push_back(new Sphere(glm::vec3(-0.2, 0.1, 1), 2, ofColor::blue));			//0 0 4
-	scene.push_back(new Torus(glm::vec3(-2, 2.5, -1), glm::vec2(2, 0.75), ofColor::yellow));
+	if (bFractalScene)
+	{
+		scene.push_back(makeFractal(glm::vec3(0, 1, 0), 2.5));
+	}
+	else
+	{
+		scene.push_back(new Sphere(glm::vec3(-0.2, 0.1, 1), 2, ofColor::blue));			//0 0 4
+		scene.push_back(new Torus(glm::vec3(-2, 2.5, -1), glm::vec2(2, 0.75), ofColor::yellow));
+	}
 	//scene.push_back(new Sphere(glm::vec3(4.5, 2.2, -1.5), 2, ofColor::yellow));
 	
 	//add lights to the scene
@@ -84,6 +91,14 @@ void ofApp::setup() {
 	lights.push_back(new Light(50, glm::vec3(4, 6, 14), false));			//3 4 5   
 	//lights.push_back(new Light(100, glm::vec3(-7, 2, 7)));
 
+	//there is no GL context to back the textures when running headless
+	if (bBenchmark || bCoordinator || !workerAddress.empty() || bServer)
+	{
+		image.setUseTexture(false);
+		map.setUseTexture(false);
+		texture.setUseTexture(false);
+	}
+
 	image.allocate(imageW, imageH, ofImageType::OF_IMAGE_COLOR);		//allocates an image with desired dimensions
 	map.allocate(imageW, imageH, ofImageType::OF_IMAGE_COLOR);
 	
@@ -100,6 +115,25 @@ void ofApp::setup() {
 	gui.add(tValue.setup("t", ofVec2f(2, 0.75), ofVec2f(0, 0), ofVec2f(10, 10)));
 	bHide = false;
 
+	if (bBenchmark)
+	{
+		runBenchmark();
+		ofExit(check.passed() ? 0 : 1);
+	}
+	else if (!workerAddress.empty())
+	{
+		runWorker();
+		ofExit();
+	}
+	else if (bCoordinator)
+	{
+		renderDistributed('m');
+		ofExit();
+	}
+	else if (bServer)
+	{
+		startServer();
+	}
 }
 
 void ofApp::printChannel()
@@ -117,6 +151,12 @@ void ofApp::printChannel()
 
 //--------------------------------------------------------------
 void ofApp::update(){
+
+	if (bServer)
+	{
+		renderServer.update();
+		return;
+	}
 	
 	//update the object with values in the sliders only when a certain key is pressed
 	//this way the slider's values won't always override what the current object's parameters
@@ -151,6 +191,11 @@ void ofApp::update(){
 
 }
 
+//--------------------------------------------------------------
+void ofApp::exit(){
+	saver.flush();		//make sure the last render is on disk before we quit
+}
+
 // draws a three plane coordinate axis for reference
 void ofApp::drawAxis(glm::vec3 pos)
 {
@@ -171,6 +216,7 @@ bool ofApp::isShadow(const Ray &r)
 {
 	glm::vec3 hp;
 	glm::vec3 nor;
+	rayCount++;
 
 	//loop through all the scene objects and see if any of them block a ray to a light source
 	for (int i = 0; i < scene.size(); i++)
@@ -190,6 +236,7 @@ bool ofApp::isSpotlightShadow(const Ray &r, const Light &l)
 {
 	glm::vec3 hp; 
 	glm::vec3 norm;
+	rayCount++;
 
 	for (int i = 0; i < scene.size(); i++)
 	{
@@ -205,18 +252,42 @@ bool ofApp::isSpotlightShadow(const Ray &r, const Light &l)
 	return false;
 }
 
-bool ofApp::isSpotlightShadowRM(const Ray &r, const Light &l)
+//marches a shadow ray from r.p toward a light maxT away and returns how much
+//of the light gets through, 0 in full shadow up to 1 fully lit
+//the march stops at the light instead of going on to MAX_DISTANCE, so
+//nothing behind the light can shadow it.  a ray that passes within h of a
+//surface t along is partly blocked, the smallest shadowK * h / t on the way
+//gives the penumbra (Quilez), and once that is too dark to show the rest of
+//the march is skipped
+float ofApp::shadowMarch(const Ray &r, float maxT)
 {
-	glm::vec3 hp;
-	if (rayMarch(r, hp))
+	float light = 1;
+	float t = 0;
+	int evals = 0, steps = 0;
+	rayCount++;
+
+	while (steps < MAX_RAY_STEPS && t < maxT)
 	{
-		if (inSpotLight(l, hp))
+		SceneHit closest = sceneQuery(r.p + r.d*t);
+		evals += closest.evals;
+		steps++;
+		if (closest.dist < DIST_THRESHOLD)
 		{
-			return true;
+			light = 0;
+			break;
 		}
+		if (t > 0) light = std::min(light, shadowK * closest.dist / t);
+		if (light < 1 / 255.0f)
+		{
+			light = 0;
+			break;
+		}
+		t += closest.dist;
 	}
 
-	return false;
+	sdfCount += evals;
+	stepCount += steps;
+	return light;
 }
 
 //function that checks to see if a point is within the scope of a spotlight
@@ -314,10 +385,7 @@ ofColor ofApp::allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColo
 			}
 			else
 			{
-				if (isSpotlightShadowRM(r2, *lights[i]))
-				{
-					tempColor = ofColor::black;			//if your in a shadow, then no light is reaching resulting in no color
-				}
+				tempColor *= shadowMarch(r2, glm::distance(r2.p, lights[i]->position));		//only the light that gets past the objects in the way
 			}
 
 		}
@@ -332,11 +400,7 @@ ofColor ofApp::allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColo
 			}
 			else
 			{
-				glm::vec3 hp;
-				if (rayMarch(r2, hp))
-				{
-					tempColor = ofColor::black;			//if your in a shadow, then no light is reaching resulting in no color
-				}
+				tempColor *= shadowMarch(r2, glm::distance(r2.p, lights[i]->position));		//only the light that gets past the objects in the way
 			}
 
 		}		//but of course if a scene has multiple lights and 1 >= more reaches that point, it'll start to show color and the shadow gets dimmer
@@ -359,264 +423,829 @@ ofColor ofApp::lookup(float u, float v)
 	return texture.getColor((int)fmod(i, texture.getWidth()), (int)fmod(j, texture.getHeight()));
 }
 
-// Ray Tracing algorithm to render an image
-// Invoked with the key 't'
-void ofApp::rayTrace()
-{	
-	
-	//for each pixel
-	for (int i = 0; i < imageW; i++)
+//traces the supersamples for pixel (i, j) and returns their average color
+//j counts up from the bottom of the image, the callers flip it into image rows
+ofColor ofApp::tracePixel(int i, int j)
+{
+	ofColor superColor = ofColor::black;
+	for (int p = 0; p < 4; p++)
 	{
-		int row = imageH - 1;
-		for (int j = 0; j < imageH; j++)
-		{		
-			ofColor superColor = ofColor::black;
-			for (int p = 0; p < 4; p++)
+		for (int q = 0; q < 4; q++)
+		{
+			//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
+			float u = (i + ((p + 0.5) / 4)) / imageW;
+			float v = (j + ((q + 0.5) / 4))  / imageH;
+			Ray r = renderCam.getRay(u, v);
+			rayCount++;
+
+			vector<float> distance;			//vector to hold all the distances in of objects from the renderCam
+			bool hit = false;				//boolean to signal an intersect 
+			int index = 0;					//index to scene vector to know what object was intersected
+			vector<glm::vec3> points;
+			vector<glm::vec3> n;
+			//check if the ray intersects with any object in the scene
+			for (int k = 0; k < scene.size(); k++)
 			{
-				for (int q = 0; q < 4; q++)
+				if (scene[k]->intersect(r, hitpoint, normal))
 				{
-					//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
-					float u = (i + ((p + 0.5) / 4)) / imageW;
-					float v = (j + ((q + 0.5) / 4))  / imageH;
-					Ray r = renderCam.getRay(u, v);
-
-					vector<float> distance;			//vector to hold all the distances in of objects from the renderCam
-					bool hit = false;				//boolean to signal an intersect 
-					int index = 0;					//index to scene vector to know what object was intersected
-					vector<glm::vec3> points;
-					vector<glm::vec3> n;
-					//check if the ray intersects with any object in the scene
-					for (int k = 0; k < scene.size(); k++)
-					{
-						if (scene[k]->intersect(r, hitpoint, normal))
-						{
-							//printf("scene index: %d\n", k);
-							hit = true;
-							float dist = glm::length(scene[k]->position - renderCam.position);
-							distance.push_back(dist);
-							index = k;							//set the index to the index in the scene vector
-							points.push_back(hitpoint);
-							n.push_back(normal);
-						}
-						else
-						{
-							distance.push_back(std::numeric_limits<float>::infinity());			//default big distance if nothing was intersected
-																//ensures that distance elements line up with scene elements 
-																//ex) distance[0] refers to distance from scene[0] to renderCam, etc... 
-							points.push_back(glm::vec3(0, 0, 0));
-							n.push_back(glm::vec3(0, 0, 0));
+					//printf("scene index: %d\n", k);
+					hit = true;
+					float dist = glm::length(scene[k]->position - renderCam.position);
+					distance.push_back(dist);
+					index = k;							//set the index to the index in the scene vector
+					points.push_back(hitpoint);
+					n.push_back(normal);
+				}
+				else
+				{
+					distance.push_back(std::numeric_limits<float>::infinity());			//default big distance if nothing was intersected
+														//ensures that distance elements line up with scene elements 
+														//ex) distance[0] refers to distance from scene[0] to renderCam, etc... 
+					points.push_back(glm::vec3(0, 0, 0));
+					n.push_back(glm::vec3(0, 0, 0));
 
-						}
-					}
+				}
+			}
+
+			//setColor follows (i, row, ofColor) format to flip and mirror the rendered image so that it matches 
+			//what is expected to be seen as viewed from the view plane
+			if (hit)
+			{
 
-					//setColor follows (i, row, ofColor) format to flip and mirror the rendered image so that it matches 
-					//what is expected to be seen as viewed from the view plane
-					if (hit)
+				if (distance.size() == 1)
+				{
+					//first element is the plane so use the texture map
+					if (index == 0)
+					{
+						//get the coordinates of the hitpoint
+						float x = hitpoint.x + (pWidth / 2);
+						float z = hitpoint.z + (pHeight / 2);
+						//convert hitpoint coordinates to uv coordinates
+						float uu = (x + .5) / pWidth;
+						float vv = (z + .5) / pHeight;
+						ofColor fc = allShader(hitpoint, normal, lookup(uu*squares, vv*squares), scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, fc);
+						superColor += fc/4;			//prevents adding too much color since were getting more color samples per pixel
+					}
+					else
 					{
+						ofColor objColor = allShader(hitpoint, normal, scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, objColor);
+						superColor += objColor/4;	//denominator should match the pq loop variant 
+					}
 
-						if (distance.size() == 1)
+				}
+				else
+				{
+					//finds the closest object in the scene to the renderCam
+					float c = std::numeric_limits<float>::infinity();		//the shortest distance to the renderCam
+					for (int a = 0; a < distance.size(); a++)
+					{
+						//sets the closest object to the renderCam
+						if (distance[a] < c)
 						{
-							//first element is the plane so use the texture map
-							if (index == 0)
-							{
-								//get the coordinates of the hitpoint
-								float x = hitpoint.x + (pWidth / 2);
-								float z = hitpoint.z + (pHeight / 2);
-								//convert hitpoint coordinates to uv coordinates
-								float uu = (x + .5) / pWidth;
-								float vv = (z + .5) / pHeight;
-								ofColor fc = allShader(hitpoint, normal, lookup(uu*squares, vv*squares), scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, fc);
-								superColor += fc/4;			//prevents adding too much color since were getting more color samples per pixel
-							}
-							else
-							{
-								ofColor objColor = allShader(hitpoint, normal, scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, objColor);
-								superColor += objColor/4;	//denominator should match the pq loop variant 
-							}
+							//updates the closest distance and the index of that object in the scene vector
+							c = distance[a];
+							index = a;
+							//cout << c << " " << index << endl;
 
 						}
-						else
-						{
-							//finds the closest object in the scene to the renderCam
-							float c = std::numeric_limits<float>::infinity();		//the shortest distance to the renderCam
-							for (int a = 0; a < distance.size(); a++)
-							{
-								//sets the closest object to the renderCam
-								if (distance[a] < c)
-								{
-									//updates the closest distance and the index of that object in the scene vector
-									c = distance[a];
-									index = a;
-									//cout << c << " " << index << endl;
-
-								}
-							}
-
-							//ofColor col = lambert(points[index], n[index], scene[index]->diffuseColor) + //ambient +
-							//	phong(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power);
-							//image.setColor(i, row, putShadow(points[index], col));	//set color of pixel to value computed from hit point
-							//first element is the plane so use the texture map
-							if (index == 0)
-							{
-								//gets the coordinates of the closest object 
-								float x = points[index].x + (pWidth / 2);
-								float z = points[index].z + (pHeight / 2);
-								//convert those coordinates to uv coordinates
-								float uu = (x + .5) / pWidth;
-								float vv = (z + .5) / pHeight;
-								ofColor fc = allShader(points[index], n[index], lookup(uu*squares, v*squares), scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, fc);
-								superColor += fc/4;
-							}
-							else
-							{
-								ofColor objColor = allShader(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, objColor);
-								superColor += objColor/4;
-							}
-
+					}
 
-						}
+					//ofColor col = lambert(points[index], n[index], scene[index]->diffuseColor) + //ambient +
+					//	phong(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power);
+					//image.setColor(i, row, putShadow(points[index], col));	//set color of pixel to value computed from hit point
+					//first element is the plane so use the texture map
+					if (index == 0)
+					{
+						//gets the coordinates of the closest object 
+						float x = points[index].x + (pWidth / 2);
+						float z = points[index].z + (pHeight / 2);
+						//convert those coordinates to uv coordinates
+						float uu = (x + .5) / pWidth;
+						float vv = (z + .5) / pHeight;
+						ofColor fc = allShader(points[index], n[index], lookup(uu*squares, v*squares), scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, fc);
+						superColor += fc/4;
 					}
 					else
 					{
-						//image.setColor(i, row, ofColor::black);			//set the background color to black
-						//image.setColor(i, row, ambient);				//set the background color to the ambient color
-						superColor += ofColor::black;
+						ofColor objColor = allShader(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, objColor);
+						superColor += objColor/4;
 					}
-					//row--;
+
+
 				}
 			}
-			image.setColor(i, row, superColor);	//we are outside the pq loop, so we can now set the image pixel
+			else
+			{
+				//image.setColor(i, row, ofColor::black);			//set the background color to black
+				//image.setColor(i, row, ambient);				//set the background color to the ambient color
+				superColor += ofColor::black;
+			}
+			//row--;
+		}
+	}
+	return superColor;
+}
+
+// Ray Tracing algorithm to render an image
+// Invoked with the key 't'
+void ofApp::rayTrace()
+{	
+	
+	//for each pixel
+	for (int i = 0; i < imageW; i++)
+	{
+		int row = imageH - 1;
+		for (int j = 0; j < imageH; j++)
+		{		
+			image.setColor(i, row, tracePixel(i, j));
 			row--;
 			
 		}
 		
 	}
 	
-	image.save("traceImage.PNG");	//put result into an image
+	saver.save(image.getPixels(), "traceImage.PNG");	//put result into an image
 }
 
-//returns the normal from a given point for any object using distances
-glm::vec3 ofApp::getNormalRM(const glm::vec3 &p)
+//the normal at p, the gradient of the scene sdf there
+//id is the object closest to p if the caller knows it (the one a ray hit),
+//otherwise it's looked up.  objects that can evaluate their sdf over Duals
+//give the gradient in one pass, for everything else it comes from finite
+//differences eps apart over the whole scene (marchPixel() widens eps with distance)
+glm::vec3 ofApp::getNormalRM(const glm::vec3 &p, float eps, int id)
 {
-	float eps = 0.01;
-	float dp = sceneSDF(p);
-	glm::vec3 n(dp - sceneSDF(glm::vec3(p.x-eps, p.y, p.z)), 
-				dp - sceneSDF(glm::vec3(p.x, p.y-eps, p.z)),
-				dp - sceneSDF(glm::vec3(p.x, p.y, p.z-eps)));
+	if (bDualNormals)
+	{
+		if (id < 0)
+		{
+			SceneHit closest = sceneQuery(p);
+			sdfCount += closest.evals;
+			id = closest.id;
+		}
+		Dual dist;
+		if (id >= 0 && scene[id]->sdfDual(Dual3::point(p), dist) && glm::length(dist.d) > 0)
+		{
+			sdfCount++;
+			return glm::normalize(dist.d);
+		}
+	}
+
+	SceneHit dp = sceneQuery(p);
+	SceneHit dx = sceneQuery(glm::vec3(p.x-eps, p.y, p.z));
+	SceneHit dy = sceneQuery(glm::vec3(p.x, p.y-eps, p.z));
+	SceneHit dz = sceneQuery(glm::vec3(p.x, p.y, p.z-eps));
+	sdfCount += dp.evals + dx.evals + dy.evals + dz.evals;
+	glm::vec3 n(dp.dist - dx.dist, 
+				dp.dist - dy.dist,
+				dp.dist - dz.dist);
 	return glm::normalize(n); 
 }
 
-//returns the closest distance to the scene
-float ofApp::sceneSDF(const glm::vec3 &p)
+//returns the distance to the closest object in the scene and which object it is
+//this only reads the scene, so the render threads can all call it at once
+//
+//goes through the bvh when it matches the scene, otherwise every object is
+//checked (still skipping the ones whose bounds are too far away)
+SceneHit ofApp::sceneQuery(const glm::vec3 &p) const
+{
+	if (bvh.size() == scene.size()) return bvh.query(p);
+	return SDFBVH::scan(scene, p);
+}
+
+//sorts the scene into the bvh, called before rendering since any edit to the
+//scene leaves the tree out of date.  the objects are told where the camera is
+//too, for their level of detail
+void ofApp::buildBVH()
 {
-	float closestDist = std::numeric_limits<float>::infinity();
+	bvh.build(scene);
+	float footprint = bFractalLOD ? pixelFootprint() : 0;
 	for (int i = 0; i < scene.size(); i++)
 	{
-		float dist = scene[i]->sdf(p);
-		//cout << "dist: " << dist << endl;
-		if (dist < closestDist)
-		{
-			closestDist = dist;
-			sceneIdx = i;
-		}
+		scene[i]->setView(renderCam.position, footprint);
 	}
+}
 
-	return closestDist;
+//a fractal of fractalKind, fractalPower and fractalIterations at p, size
+//across its fractal units
+Fractal *ofApp::makeFractal(const glm::vec3 &p, float size)
+{
+	Fractal *fractal = new Fractal(p, size, fractalKind, ofColor::lightGoldenRodYellow);
+	fractal->de.power = fractalPower;
+	fractal->de.iterations = fractalIterations;
+	return fractal;
+}
+
+//returns the closest distance to the scene
+float ofApp::sceneSDF(const glm::vec3 &p) const
+{
+	return sceneQuery(p).dist;
 }
 
 //this utilizes the ray marching algorithm to be used instead of the standard ray intersect method used prior
 //ray marches across the ray to determine if an object is hit or not
-bool ofApp::rayMarch(Ray r, glm::vec3 &p)
+//id is set to the index of the object that was hit, tStart is how far along r
+//the march starts (nothing may be closer than that, see coneMarch())
+//cost, if given, gets the steps and sdf evaluations the march took and how it ended
+//
+//a hit is closer than DIST_THRESHOLD, or for primary rays closer than the
+//ray's share of its pixel at that distance, footprint * t (see pixelFootprint()),
+//whichever is bigger.  far away a pixel covers more than DIST_THRESHOLD and
+//the steps to get any closer than that can't show up in the image
+//
+//with relaxation above 1 each step is relaxation * dist (over-relaxed sphere
+//tracing, Keinert et al. 2014).  the sphere of radius dist around a point is
+//empty, so as long as the spheres around two points in a row overlap nothing
+//was skipped between them.  when they stop overlapping the step went too far:
+//the ray goes back to the last safe point, takes the plain step from there and
+//stays with plain steps for the rest of the ray
+bool ofApp::rayMarch(const Ray &r, glm::vec3 &p, int &id, float tStart, float footprint, MarchCost *cost)
 {
 	bool hit = false;
-	p = r.p;
+	bool escaped = false;
+	int evals = 0;
+	int steps = 0;
+	float omega = relaxation;
+	float step = 0;					//length of the last step taken
+	float prevDist = 0;				//distance at the point the last step started from
+	float t = tStart;
+	rayCount++;
+	p = r.p + r.d*tStart;
 	for (int i = 0; i < MAX_RAY_STEPS; i++)
 	{
 		//cout << "p: " << p << endl;
-		float dist = sceneSDF(p);
+		SceneHit closest = sceneQuery(p);
+		float dist = closest.dist;
+		evals += closest.evals;
+		steps++;
+		if (omega > 1 && fabs(dist) + prevDist < step)
+		{
+			//the spheres don't overlap, back up and take the safe step
+			p += r.d*(prevDist - step);
+			t += prevDist - step;
+			step = prevDist;
+			omega = 1;
+			continue;
+		}
 		//cout << "distance: " << dist << endl;
-		if (dist < DIST_THRESHOLD)			//hit falls under the required threshold to quantify as a hit
+		if (dist < std::max(DIST_THRESHOLD, footprint*t))			//hit falls under the required threshold to quantify as a hit
 		{
 			//cout << "hit" << endl;
 			hit = true;
+			id = closest.id;
 			break;
 		}
 		else if (dist > MAX_DISTANCE)		//hit is too far away from target, so it's considered a miss
 		{
 			//cout << "off target" << endl;
+			escaped = true;
 			break;
 		}
 		else
 		{
 			//cout << "marching" << endl;
-			p += r.d*dist;					//march along the ray
+			step = dist*omega;
+			prevDist = dist;
+			p += r.d*step;					//march along the ray
+			t += step;
 		}
 	}
 
+	sdfCount += evals;		//added once per ray since every thread shares the counter
+	stepCount += steps;
+	if (cost)
+	{
+		cost->steps = steps;
+		cost->evals = evals;
+		cost->end = hit ? MarchCost::HIT : escaped ? MarchCost::ESCAPED : MarchCost::OUT_OF_STEPS;
+	}
 	return hit;		
 }
 
+//the angle (radius) each primary ray covers, so at distance t along the ray
+//it stands for a disc of radius pixelFootprint() * t.  the render camera looks
+//straight down z at the view plane, and marchPixel() sends 4x4 rays through each pixel
+float ofApp::pixelFootprint()
+{
+	float focal = fabs(renderCam.view.position.z - renderCam.position.z);
+	float pixel = std::max(renderCam.view.width() / imageW, renderCam.view.height() / imageH);
+	return 0.5f * pixel / focal / 4;
+}
+
+//ray marches pixel (i, j) and returns its color
+//j counts up from the bottom of the image, the callers flip it into image rows
+//the rays start tStart from the camera, and what they cost is added to cost
+ofColor ofApp::marchPixel(int i, int j, float tStart, MarchCost *cost)
+{
+	ofColor superColor = ofColor::black;
+	float footprint = pixelFootprint();
+	//anti-aliasing by oversampling 
+	for (int p = 0; p < 4; p++)
+	{
+		for (int q = 0; q < 4; q++)
+		{
+			//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
+			float u = (i + ((p + 0.5) / 4)) / imageW;
+			float v = (j + ((q + 0.5) / 4)) / imageH;
+			Ray r = renderCam.getRay(u, v);
+
+			bool hit = false;
+			glm::vec3 pointOfIntersect;
+			int id = 0;
+			MarchCost rayCost;
+			hit = rayMarch(r, pointOfIntersect, id, tStart, footprint, &rayCost);
+			if (cost) cost->add(rayCost);
+			if (hit)
+			{
+				if (id == 0)
+				{
+					//gets the coordinates of the closest object 
+					float x = pointOfIntersect.x + (pWidth / 2);
+					float z = pointOfIntersect.z + (pHeight / 2);
+					//convert those coordinates to uv coordinates
+					float uu = (x + .5) / pWidth;
+					float vv = (z + .5) / pHeight;
+					glm::vec3 norm = getNormalRM(pointOfIntersect, std::max(0.01f, footprint * glm::distance(pointOfIntersect, r.p)), id);
+					ofColor planeColor = allShader(pointOfIntersect, norm, lookup(uu*squares, v*squares), scene[id]->specularColor, power, scene[id]);
+					superColor += planeColor / 4;
+				}
+				else
+				{
+					glm::vec3 norm = getNormalRM(pointOfIntersect, std::max(0.01f, footprint * glm::distance(pointOfIntersect, r.p)), id);
+					ofColor objColor = allShader(pointOfIntersect, norm, scene[id]->colorAt(pointOfIntersect), scene[id]->specularColor, power, scene[id]);
+					superColor += objColor / 4;
+				}
+			}
+			else
+			{
+				superColor += ofColor::black;
+			}
+
+		}
+	}
+	return superColor;
+}
+
+//renders the size x size block of pixels at (x0, y0), clipped to the image.
+//with bCones a cone around all of the block's rays is marched first, nothing is
+//inside it up to where it got, so the four quarter blocks (8x8, 4x4, 2x2) and
+//in the end the pixels carry on from there instead of from the camera
+void ofApp::marchBlock(int x0, int y0, int size, float tStart)
+{
+	if (x0 >= imageW || y0 >= imageH) return;
+	if (size == 1)
+	{
+		image.setColor(x0, imageH - 1 - y0, marchPixel(x0, y0, tStart, bHeatmap ? &marchCost.at(x0, imageH - 1 - y0) : nullptr));
+		return;
+	}
+
+	if (bCones) tStart = coneMarch(x0, y0, size, tStart);
+	int half = size / 2;
+	marchBlock(x0, y0, half, tStart);
+	marchBlock(x0 + half, y0, half, tStart);
+	marchBlock(x0, y0 + half, half, tStart);
+	marchBlock(x0 + half, y0 + half, half, tStart);
+}
+
+//marches a cone from the camera that holds every ray through the size x size
+//pixel block at (x0, y0), starting tStart along its axis.  returns how far the
+//rays of the block can start, the cone is empty (and further from every surface
+//than a ray's hit threshold, see rayMarch()) up to there
+//
+//t along the axis the cone is a disc of radius t * tan.  everything within dist
+//of the axis point is empty, and the cone between t and t + h lies within
+//h + (t + h) * tan of it, so the axis can move on h = (dist - t * tan) / (1 + tan),
+//less the hit threshold (which grows by footprint per unit of t as well).
+//a ray of the block is never further along the axis than it is along itself,
+//so the first t of every ray is inside what the cone covered
+float ofApp::coneMarch(int x0, int y0, int size, float tStart)
+{
+	int x1 = std::min(x0 + size, imageW);
+	int y1 = std::min(y0 + size, imageH);
+	Ray axis = renderCam.getRay((x0 + x1) * 0.5f / imageW, (y0 + y1) * 0.5f / imageH);
+
+	//the view plane is flat, so the widest ray is through one of the corners
+	float cosMin = 1;
+	for (int c = 0; c < 4; c++)
+	{
+		Ray corner = renderCam.getRay((float)((c & 1) ? x1 : x0) / imageW, (float)((c & 2) ? y1 : y0) / imageH);
+		cosMin = std::min(cosMin, glm::dot(corner.d, axis.d));
+	}
+	float tanA = sqrt(std::max(1 - cosMin * cosMin, 0.0f)) / cosMin;
+	float footprint = pixelFootprint();
+
+	float t = tStart;
+	int evals = 0;
+	int steps = 0;
+	for (int i = 0; i < MAX_RAY_STEPS; i++)
+	{
+		SceneHit closest = sceneQuery(axis.p + axis.d*t);
+		evals += closest.evals;
+		steps++;
+		float h = (closest.dist - std::max(DIST_THRESHOLD, footprint*t) - t*tanA) / (1 + tanA + footprint);
+		if (h < DIST_THRESHOLD || closest.dist > MAX_DISTANCE) break;		//the cone is about to touch something, or left the scene
+		t += h;
+	}
+
+	sdfCount += evals;
+	stepCount += steps;
+	return t;
+}
+
 //this renders images as an output, based on the rayTrace(), but with some changes to it
 void ofApp::rayMarch()
 {
-	//for each pixel, just like ray tracing
-	for (int i = 0; i < imageW; i++)
+	buildBVH();
+	if (bHeatmap) marchCost.allocate(imageW, imageH);
+
+	//for each pixel, just like ray tracing, but split into tiles that are
+	//rendered on every core.  each pixel only reads the scene so the threads
+	//don't need to coordinate beyond handing out the tiles
+	//the tiles are split further into 8x8 blocks for the cone pre-pass, 32 is
+	//a multiple of 8 so no block straddles two tiles
+	parallelTiles(imageW, imageH, 32, numThreads, [this](int x0, int y0, int x1, int y1)
 	{
-		int row = imageH - 1;
-		for (int j = 0; j < imageH; j++)
+		for (int i = x0; i < x1; i += 8)
 		{
-			ofColor superColor = ofColor::black;
-			//anti-aliasing by oversampling 
-			for (int p = 0; p < 4; p++)
+			for (int j = y0; j < y1; j += 8)
 			{
-				for (int q = 0; q < 4; q++)
-				{
-					//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
-					float u = (i + ((p + 0.5) / 4)) / imageW;
-					float v = (j + ((q + 0.5) / 4)) / imageH;
-					Ray r = renderCam.getRay(u, v);
-
-					bool hit = false;
-					glm::vec3 pointOfIntersect;
-					hit = rayMarch(r, pointOfIntersect);
-					if (hit)
-					{
-						if (sceneIdx == 0)
-						{
-							//gets the coordinates of the closest object 
-							float x = pointOfIntersect.x + (pWidth / 2);
-							float z = pointOfIntersect.z + (pHeight / 2);
-							//convert those coordinates to uv coordinates
-							float uu = (x + .5) / pWidth;
-							float vv = (z + .5) / pHeight;
-							glm::vec3 norm = getNormalRM(pointOfIntersect);
-							ofColor planeColor = allShader(pointOfIntersect, norm, lookup(uu*squares, v*squares), scene[sceneIdx]->specularColor, power, scene[sceneIdx]);
-							superColor += planeColor / 4;
-						}
-						else
-						{
-							glm::vec3 norm = getNormalRM(pointOfIntersect);
-							ofColor objColor = allShader(pointOfIntersect, norm, scene[sceneIdx]->diffuseColor, scene[sceneIdx]->specularColor, power, scene[sceneIdx]);
-							superColor += objColor / 4;
-						}
-					}
-					else
-					{
-						superColor += ofColor::black;
-					}
+				marchBlock(i, j, 8, 0);
+			}
+		}
+	});
 
-				}
+	saver.save(image.getPixels(), "marchImage.PNG");
+	if (bHeatmap) marchCost.save(saver, "march", MAX_RAY_STEPS * 16);
+}
+
+//renders the image on worker processes, the scene is sent to each worker as it
+//connects and the tiles come back into image (see tileRender.h)
+//mode is 't' for ray tracing or 'm' for ray marching
+void ofApp::renderDistributed(char mode)
+{
+	TileCoordinator coordinator;
+	coordinator.port = coordinatorPort;
+	buildBVH();
+
+	bool ok = coordinator.render(image.getPixels(), imageW, imageH, sceneToString(), mode, [this](char m, int i, int j) {
+		bTrace = (m == 't');
+		return bTrace ? tracePixel(i, j) : marchPixel(i, j);
+	});
+
+	if (ok)
+	{
+		saver.save(image.getPixels(), mode == 't' ? "traceImage.PNG" : "marchImage.PNG");
+	}
+}
+
+//renders tiles for the coordinator at workerAddress until it is done (--worker)
+void ofApp::runWorker()
+{
+	vector<string> address = ofSplitString(workerAddress, ":");
+	string host = address[0];
+	int port = address.size() > 1 ? ofToInt(address[1]) : coordinatorPort;
+
+	TileWorker worker;
+	worker.run(host, port, [this](const string &text) { sceneFromString(text); }, [this](char m, int i, int j) {
+		bTrace = (m == 't');
+		return bTrace ? tracePixel(i, j) : marchPixel(i, j);
+	});
+}
+
+//serves render requests from clients on serverPort with resident scenes (--server),
+//see renderServer.h for the protocol
+void ofApp::startServer()
+{
+	//a request's view lines only override its own render, so every request starts
+	//from the view of its scene, and a scene without one from the app's
+	string defaultView = viewToString();
+	bool ok = renderServer.setup(serverPort,
+		[this, defaultView](const string &text) { sceneFromString(defaultView + text); serverView = viewToString(); },
+		[this](const string &view) { sceneFromString(serverView + view, false); },
+		[this](char m, int i, int j) {
+			bTrace = (m == 't');
+			return bTrace ? tracePixel(i, j) : marchPixel(i, j);
+		});
+	if (!ok) ofExit(1);
+}
+
+//writes out everything a worker needs to render the same image, one item per line
+//
+//image w h
+//camera x y z minx miny maxx maxy viewz
+//power p
+//plane x y z nx ny nz r g b width height
+//sphere x y z radius r g b
+//torus x y z t.x t.y angle rotx roty rotz r g b
+//fractal kind x y z size power iterations c.x c.y c.z c.w r g b
+//light intensity x y z spotlight btarget target coneAngle pointAt.x pointAt.y pointAt.z
+string ofApp::sceneToString()
+{
+	//max_digits10, so the floats read back exactly and workers render the same scene
+	stringstream ss;
+	ss << setprecision(9);
+	ss << "image " << imageW << " " << imageH << "\n";
+	ss << viewToString();
+
+	for (int i = 0; i < scene.size(); i++)
+	{
+		SceneObject *obj = scene[i];
+		glm::vec3 pos = obj->position;
+		ofColor c = obj->diffuseColor;
+		if (Plane *plane = dynamic_cast<Plane *>(obj))
+		{
+			ss << "plane " << pos.x << " " << pos.y << " " << pos.z << " " << plane->normal.x << " " << plane->normal.y << " " << plane->normal.z << " "
+				<< (int)c.r << " " << (int)c.g << " " << (int)c.b << " " << plane->width << " " << plane->height << "\n";
+		}
+		else if (dynamic_cast<Sphere *>(obj))
+		{
+			ss << "sphere " << pos.x << " " << pos.y << " " << pos.z << " " << obj->radius << " "
+				<< (int)c.r << " " << (int)c.g << " " << (int)c.b << "\n";
+		}
+		else if (dynamic_cast<Torus *>(obj))
+		{
+			ss << "torus " << pos.x << " " << pos.y << " " << pos.z << " " << obj->t.x << " " << obj->t.y << " " << obj->angleRotate << " "
+				<< obj->rotation.x << " " << obj->rotation.y << " " << obj->rotation.z << " "
+				<< (int)c.r << " " << (int)c.g << " " << (int)c.b << "\n";
+		}
+		else if (Fractal *fractal = dynamic_cast<Fractal *>(obj))
+		{
+			const FractalDE &de = fractal->de;
+			ss << "fractal " << FractalDE::kindName(de.kind) << " " << pos.x << " " << pos.y << " " << pos.z << " " << obj->radius << " "
+				<< de.power << " " << de.iterations << " " << de.c.x << " " << de.c.y << " " << de.c.z << " " << de.c.w << " "
+				<< (int)c.r << " " << (int)c.g << " " << (int)c.b << "\n";
+		}
+	}
+
+	for (int i = 0; i < lights.size(); i++)
+	{
+		Light *l = lights[i];
+		int target = -1;
+		for (int k = 0; k < lights.size(); k++)
+		{
+			if (l->target == lights[k]) target = k;
+		}
+		ss << "light " << l->intensity << " " << l->position.x << " " << l->position.y << " " << l->position.z << " "
+			<< l->spotlight << " " << l->btarget << " " << target << " " << l->coneAngle << " "
+			<< l->pointAt.x << " " << l->pointAt.y << " " << l->pointAt.z << "\n";
+	}
+
+	return ss.str();
+}
+
+//the camera and power lines of sceneToString(), what a render server request can override
+string ofApp::viewToString()
+{
+	stringstream ss;
+	ss << setprecision(9);
+	ss << "camera " << renderCam.position.x << " " << renderCam.position.y << " " << renderCam.position.z << " "
+		<< renderCam.view.min.x << " " << renderCam.view.min.y << " " << renderCam.view.max.x << " " << renderCam.view.max.y << " "
+		<< renderCam.view.position.z << "\n";
+	ss << "power " << (float)power << "\n";
+	return ss.str();
+}
+
+//replaces the scene, camera and lights with the ones described by sceneToString()
+//with replace false the lines are applied on top of the current scene instead,
+//the render server uses this for the camera and image size of each request
+void ofApp::sceneFromString(const string &text, bool replace)
+{
+	if (replace)
+	{
+		for (SceneObject *obj : scene) delete obj;
+		for (Light *l : lights) delete l;
+		scene.clear();
+		lights.clear();
+		selected.clear();
+	}
+	vector<int> targets;
+
+	stringstream lines(text);
+	string line;
+	while (getline(lines, line))
+	{
+		stringstream ss(line);
+		string type;
+		ss >> type;
+		glm::vec3 pos;
+		int r, g, b;
+		if (type == "image")
+		{
+			int w, h;
+			ss >> w >> h;
+			if (w != imageW || h != imageH || !image.isAllocated())
+			{
+				imageW = w;
+				imageH = h;
+				image.allocate(imageW, imageH, ofImageType::OF_IMAGE_COLOR);
 			}
-			image.setColor(i, row, superColor);
-			row--;
 		}
+		else if (type == "camera")
+		{
+			ss >> renderCam.position.x >> renderCam.position.y >> renderCam.position.z
+				>> renderCam.view.min.x >> renderCam.view.min.y >> renderCam.view.max.x >> renderCam.view.max.y
+				>> renderCam.view.position.z;
+		}
+		else if (type == "power")
+		{
+			float p;
+			ss >> p;
+			power = p;
+		}
+		else if (type == "plane")
+		{
+			glm::vec3 n;
+			float w, h;
+			ss >> pos.x >> pos.y >> pos.z >> n.x >> n.y >> n.z >> r >> g >> b >> w >> h;
+			scene.push_back(new Plane(pos, n, ofColor(r, g, b), w, h));
+		}
+		else if (type == "sphere")
+		{
+			float radius;
+			ss >> pos.x >> pos.y >> pos.z >> radius >> r >> g >> b;
+			scene.push_back(new Sphere(pos, radius, ofColor(r, g, b)));
+		}
+		else if (type == "torus")
+		{
+			glm::vec2 t;
+			Torus *torus = new Torus();
+			ss >> pos.x >> pos.y >> pos.z >> t.x >> t.y >> torus->angleRotate
+				>> torus->rotation.x >> torus->rotation.y >> torus->rotation.z >> r >> g >> b;
+			torus->position = pos;
+			torus->t = t;
+			torus->diffuseColor = ofColor(r, g, b);
+			scene.push_back(torus);
+		}
+		else if (type == "fractal")
+		{
+			string kind;
+			float size;
+			Fractal *fractal = new Fractal();
+			FractalDE &de = fractal->de;
+			ss >> kind >> pos.x >> pos.y >> pos.z >> size >> de.power >> de.iterations >> de.c.x >> de.c.y >> de.c.z >> de.c.w >> r >> g >> b;
+			de.kind = FractalDE::kindFromName(kind);
+			fractal->position = pos;
+			fractal->radius = size;
+			fractal->diffuseColor = ofColor(r, g, b);
+			scene.push_back(fractal);
+		}
+		else if (type == "light")
+		{
+			Light *l = new Light();
+			int target;
+			ss >> l->intensity >> l->position.x >> l->position.y >> l->position.z
+				>> l->spotlight >> l->btarget >> target >> l->coneAngle
+				>> l->pointAt.x >> l->pointAt.y >> l->pointAt.z;
+			lights.push_back(l);
+			targets.push_back(target);
+		}
+	}
+
+	for (int i = 0; i < targets.size(); i++)
+	{
+		if (targets[i] >= 0 && targets[i] < lights.size()) lights[i]->target = lights[targets[i]];
+	}
+
+	buildBVH();
+}
+
+//renders the canonical plane + sphere + torus scene from setup() with both the
+//tracer and the marcher and times the kernels on a fixed set of inputs, then
+//appends the results to benchmark.json
+//with --check the renders are also compared against the golden images and
+//timings in bin/data/golden/ (see regression.h)
+//started with the --benchmark flag (see main.cpp)
+void ofApp::runBenchmark()
+{
+	Benchmark bench("Ray Marcher");
+	double pixels = (double)imageW * imageH;
+
+	bTrace = true;
+	rayCount = 0;
+	sdfCount = 0;
+	bench.start();
+	rayTrace();
+	double traceTime = bench.stop();
+	bench.add("rayTrace", traceTime, { {"rays", (double)rayCount}, {"pixels", pixels} });
+	check.image("rayTrace", image.getPixels());
+	check.time("rayTrace", traceTime);
+
+	bTrace = false;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double marchTime = bench.stop();
+	bench.add("rayMarch", marchTime, { {"rays", (double)rayCount}, {"sdf_evals", (double)sdfCount}, {"steps", (double)stepCount}, {"omega", relaxation}, {"cones", (double)bCones}, {"pixels", pixels} });
+	check.image("rayMarch", image.getPixels());
+	check.time("rayMarch", marchTime);
+
+	//the same render over-relaxed, to see how many march steps that saves
+	//(with --relax the first render was already relaxed and this one is plain)
+	uint64_t steps = stepCount;
+	float w = relaxation;
+	relaxation = (w > 1) ? 1 : 1.6;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double relaxedTime = bench.stop();
+	bench.add(w > 1 ? "rayMarch plain" : "rayMarch relaxed", relaxedTime, { {"omega", relaxation}, {"steps", (double)stepCount}, {"steps_saved", (double)steps - (double)stepCount}, {"sdf_evals", (double)sdfCount} });
+	relaxation = w;
+
+	//and without the cone pre-pass (or with it, if --no-cones turned it off)
+	bCones = !bCones;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double conesTime = bench.stop();
+	bench.add(bCones ? "rayMarch cones" : "rayMarch no cones", conesTime, { {"steps", (double)stepCount}, {"sdf_evals", (double)sdfCount} });
+	bCones = !bCones;
+
+	//primary rays through a fixed spread of view plane positions
+	vector<glm::vec3> uv = Benchmark::samplePoints(4096, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
+	vector<Ray> rays;
+	for (int i = 0; i < uv.size(); i++)
+	{
+		rays.push_back(renderCam.getRay(uv[i].x, uv[i].y));
+	}
+	SceneObject *sphere = scene[1];
+	bench.micro("Sphere::intersect", 1000000, [&](int i) {
+		glm::vec3 point, norm;
+		return sphere->intersect(rays[i % rays.size()], point, norm) ? point.z : 0.0f;
+	});
+
+	//sdf kernels, sampled in a box around the objects
+	vector<glm::vec3> points = Benchmark::samplePoints(4096, glm::vec3(-6, -2, -4), glm::vec3(6, 6, 4));
+	SceneObject *torus = scene[2];
+	bench.micro("Torus::sdf", 200000, [&](int i) { return torus->sdf(points[i % points.size()]); });
+	bench.micro(bDualNormals ? "getNormalRM" : "getNormalRM finite differences", 100000, [&](int i) { return getNormalRM(points[i % points.size()]).x; });
+	bDualNormals = !bDualNormals;
+	bench.micro(bDualNormals ? "getNormalRM" : "getNormalRM finite differences", 100000, [&](int i) { return getNormalRM(points[i % points.size()]).x; });
+	bDualNormals = !bDualNormals;
+
+	//scene queries in a field of 10k spheres and tori, with and without the bvh
+	vector<glm::vec3> centers = Benchmark::samplePoints(10000, glm::vec3(-50, -2, -50), glm::vec3(50, 8, 50), 7);
+	vector<SceneObject *> field;
+	field.push_back(scene[0]);
+	for (int i = 0; i < centers.size(); i++)
+	{
+		if (i % 2) field.push_back(new Sphere(centers[i], 0.5));
+		else field.push_back(new Torus(centers[i], glm::vec2(0.5, 0.2)));
+	}
+	SDFBVH fieldBVH;
+	bench.start();
+	fieldBVH.build(field);
+	bench.add("bvh build 10k", bench.stop(), { {"nodes", (double)fieldBVH.nodeCount()} });
+	vector<glm::vec3> fieldPoints = Benchmark::samplePoints(4096, glm::vec3(-50, -2, -50), glm::vec3(50, 8, 50));
+	bench.micro("sceneQuery 10k scan", 2000, [&](int i) { return SDFBVH::scan(field, fieldPoints[i % fieldPoints.size()]).dist; });
+	bench.micro("sceneQuery 10k bvh", 200000, [&](int i) { return fieldBVH.query(fieldPoints[i % fieldPoints.size()]).dist; });
+	for (int i = 1; i < field.size(); i++) delete field[i];
+
+	//a Mandelbulb over the plane, marched with and without the level of
+	//detail, and what that comes to for a 1080p frame
+	vector<SceneObject *> kept = scene;
+	bool lod = bFractalLOD;
+	FractalDE::Kind kind = fractalKind;
+	fractalKind = FractalDE::MANDELBULB;
+	Fractal *bulb = makeFractal(glm::vec3(0, 1, 0), 2.5);
+	scene = { kept[0], bulb };
+	for (int pass = 0; pass < 2; pass++)
+	{
+		bFractalLOD = (pass == 0) ? lod : !lod;
+		rayCount = 0;
+		sdfCount = 0;
+		stepCount = 0;
+		bench.start();
+		rayMarch();
+		double bulbTime = bench.stop();
+		bench.add(bFractalLOD ? "rayMarch mandelbulb" : "rayMarch mandelbulb no lod", bulbTime, { {"rays", (double)rayCount}, {"sdf_evals", (double)sdfCount}, {"steps", (double)stepCount},
+			{"iterations", (double)bulb->de.iterations}, {"seconds_1080p", bulbTime * 1920 * 1080 / pixels} });
+	}
+	bFractalLOD = lod;
+
+	//the estimators, sampled in a box around the fractal at full depth
+	vector<glm::vec3> bulbPoints = Benchmark::samplePoints(4096, glm::vec3(-3, -2, -3), glm::vec3(3, 4, 3));
+	bulb->setView(renderCam.position, 0);
+	for (int k = 0; k < 3; k++)
+	{
+		bulb->de.kind = (FractalDE::Kind)k;
+		bench.micro("Fractal::sdf " + FractalDE::kindName(bulb->de.kind), 50000, [&](int i) { return bulb->sdf(bulbPoints[i % bulbPoints.size()]); });
 	}
+	scene = kept;
+	delete bulb;
+	fractalKind = kind;
+	buildBVH();			//the last one was over the bulb, and can be the same size as the scene
 
-	image.save("marchImage.PNG");
+	bench.print();
+	bench.save("benchmark.json");
 }
 
 //--------------------------------------------------------------
@@ -725,6 +1354,16 @@ void ofApp::keyPressed(int key){
 		rayMarch();
 		printf("ray march complete\n");
 		break;
+	case 'n':
+		printf("distributed ray marching on port %d...\n", coordinatorPort);
+		renderDistributed('m');
+		printf("distributed ray march complete\n");
+		break;
+	case 'N':
+		printf("distributed ray tracing on port %d...\n", coordinatorPort);
+		renderDistributed('t');
+		printf("distributed ray trace complete\n");
+		break;
 	case OF_KEY_F1:
 		theCam = &easyCam;
 		break;
@@ -759,6 +1398,18 @@ void ofApp::keyPressed(int key){
 	case 'o':
 		scene.push_back(new Torus(cursor, glm::vec2(3, 2), ofColor::orange));
 		break;
+	case 'b':
+		scene.push_back(makeFractal(cursor, 2));
+		break;
+	case 'k':
+		//the next kind of fractal, for the selected one or the ones b adds
+		fractalKind = (FractalDE::Kind)((fractalKind + 1) % 3);
+		if (objSelected())
+		{
+			if (Fractal *fractal = dynamic_cast<Fractal *>(selected[0])) fractal->de.kind = fractalKind;
+		}
+		printf("fractal: %s\n", FractalDE::kindName(fractalKind).c_str());
+		break;
 	case 'j':
 		lights.push_back(new Light(50, cursor, true));
 		lights.push_back(new Light(0, glm::normalize(lights[lights.size() - 1]->position), false));
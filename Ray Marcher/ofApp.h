@@ -2,6 +2,16 @@
 
 #include "ofMain.h"
 #include "ofxGui.h"
+#include "benchmark.h"
+#include "regression.h"
+#include "imageSaver.h"
+#include "parallel.h"
+#include "marchCost.h"
+#include "dual.h"
+#include "sdfBVH.h"
+#include "fractal.h"
+#include "tileRender.h"
+#include "renderServer.h"
 
 //  General Purpose Ray class 
 //
@@ -21,10 +31,38 @@ public:
 //
 class SceneObject {
 public:
+	virtual ~SceneObject() {}
 	virtual void draw() = 0;    // pure virtual funcs - must be overloaded
 	virtual bool intersect(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) { return false; }
 	virtual bool intersectToMove(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) { return false; }
-	virtual float sdf(const glm::vec3 & p) { return 0.0; }
+	virtual float sdf(const glm::vec3 & p) const { return 0.0; }
+
+	//  a cheap lower bound on sdf(p) so the scene query can skip objects that
+	//  are too far away to be the closest one.  the default can't rule anything
+	//  out, objects with a bounding volume override it
+	//
+	virtual float sdfBound(const glm::vec3 &p) const { return -std::numeric_limits<float>::infinity(); }
+
+	//  sdf(p) over Duals, the distance and its gradient in one pass.  objects
+	//  that can't return false and their normals come from finite differences
+	//
+	virtual bool sdfDual(const Dual3 &p, Dual &dist) const { return false; }
+
+	//  box the object's surface fits in, for the SDFBVH.  unbounded objects
+	//  (planes) return false and are checked on every query instead
+	//
+	virtual bool sdfBox(glm::vec3 &min, glm::vec3 &max) const { return false; }
+
+	//  where the render camera is and the angle one of its rays covers (see
+	//  ofApp::pixelFootprint()), set before each render.  objects with a
+	//  level of detail override it
+	//
+	virtual void setView(const glm::vec3 &eye, float footprint) {}
+
+	//  the diffuse color at p on the surface, objects that aren't one color
+	//  all over override it
+	//
+	virtual ofColor colorAt(const glm::vec3 &p) const { return diffuseColor; }
 
 	// commonly used transformations
 	//
@@ -122,7 +160,7 @@ public:
 		return (glm::intersectRaySphere(glm::vec3(p), d, glm::vec3(0, 0, 0), radius, point, normal));
 	}
 
-	float sdf(const glm::vec3 &p)
+	float sdf(const glm::vec3 &p) const
 	{
 		//cout << "p: " << p << endl;
 		//cout << "position: " << position << endl;
@@ -130,6 +168,21 @@ public:
 		return glm::length(p - position) - radius;			//straight from the slides
 	}
 
+	bool sdfDual(const Dual3 &p, Dual &dist) const
+	{
+		dist = length(p - position) - radius;
+		return true;
+	}
+
+	float sdfBound(const glm::vec3 &p) const { return sdf(p); }		//as cheap as it gets already
+
+	bool sdfBox(glm::vec3 &min, glm::vec3 &max) const
+	{
+		min = position - glm::vec3(radius);
+		max = position + glm::vec3(radius);
+		return true;
+	}
+
 	void draw() {
 		//   get the current transformation matrix for this object
 		//
@@ -173,7 +226,7 @@ public:
 		return (glm::intersectRaySphere(glm::vec3(p), d, glm::vec3(0, 0, 0), radius, point, normal));
 	}
 
-	float sdf(const glm::vec3 &p1)
+	float sdf(const glm::vec3 &p1) const
 	{
 		glm::mat4 m = glm::translate(glm::mat4(1.0), position);
 		glm::mat4 M = glm::rotate(m, glm::radians(angleRotate), rotation);
@@ -182,6 +235,29 @@ public:
 		return glm::length(q) - t.y;
 	}
 
+	bool sdfDual(const Dual3 &p1, Dual &dist) const
+	{
+		glm::mat4 m = glm::translate(glm::mat4(1.0), position);
+		glm::mat4 M = glm::rotate(m, glm::radians(angleRotate), rotation);
+		Dual3 p = transform(glm::inverse(M), p1);
+		dist = length(length(p.x, p.z) - t.x, p.y) - t.y;
+		return true;
+	}
+
+	//the torus fits in a sphere of radius t.x + t.y around its center
+	float sdfBound(const glm::vec3 &p) const
+	{
+		return glm::length(p - position) - (t.x + t.y);
+	}
+
+	//the bounding sphere's box, whichever way the torus is rotated
+	bool sdfBox(glm::vec3 &min, glm::vec3 &max) const
+	{
+		min = position - glm::vec3(t.x + t.y);
+		max = position + glm::vec3(t.x + t.y);
+		return true;
+	}
+
 	//don't confused this "draw" with what's being "drawn" (rendered) for the output image
 	//this draws in the scene
 	void draw() {
@@ -202,6 +278,77 @@ public:
 	
 };
 
+//  3D fractal (Mandelbulb, Menger sponge or quaternion Julia set) from its
+//  distance estimator, see fractal.h.  radius scales it from the fractal's
+//  own units, so it fits in a sphere of de.bound() * radius
+//
+class Fractal : public SceneObject
+{
+public:
+	Fractal(glm::vec3 p, float size, FractalDE::Kind kind = FractalDE::MANDELBULB, ofColor diffuse = ofColor::lightGray) {
+		position = p;
+		radius = size;
+		de.kind = kind;
+		diffuseColor = diffuse;
+	}
+	Fractal() {}
+
+	//iterates only as deep as the detail a pixel at p can show, footprint *
+	//its distance from the camera on either side (see setView())
+	float sdf(const glm::vec3 &p) const
+	{
+		float detail = 2 * footprint * glm::distance(p, eye) / radius;
+		return de.distance((p - position) / radius, de.iterationsFor(detail)) * radius;
+	}
+
+	float sdfBound(const glm::vec3 &p) const
+	{
+		return glm::length(p - position) - de.bound() * radius;
+	}
+
+	bool sdfBox(glm::vec3 &min, glm::vec3 &max) const
+	{
+		min = position - glm::vec3(de.bound() * radius);
+		max = position + glm::vec3(de.bound() * radius);
+		return true;
+	}
+
+	void setView(const glm::vec3 &eye, float footprint)
+	{
+		this->eye = eye;
+		this->footprint = footprint;
+	}
+
+	//the orbit trap tints diffuseColor: the parts that came close to the
+	//y = 0 and z = 0 planes go blue, the ones that stayed far out keep it
+	ofColor colorAt(const glm::vec3 &p) const
+	{
+		glm::vec4 trap;
+		float detail = 2 * footprint * glm::distance(p, eye) / radius;
+		de.distance((p - position) / radius, de.iterationsFor(detail), &trap);
+		ofFloatColor color = diffuseColor;
+		color.lerp(ofFloatColor(0.10, 0.20, 0.30), ofClamp(trap.y, 0, 1));
+		color.lerp(ofFloatColor(0.02, 0.10, 0.30), ofClamp(trap.z * trap.z, 0, 1));
+		color.lerp(ofFloatColor(diffuseColor), ofClamp(pow(trap.w, 6.0f), 0, 1));
+		return ofColor(color);
+	}
+
+	//there is no way to draw the fractal itself in the viewport, so its bounding sphere stands in
+	void draw() {
+		ofNoFill();
+		ofPushMatrix();
+		ofMultMatrix(getMatrix());
+		ofDrawSphere(de.bound() * radius);
+		ofPopMatrix();
+	}
+
+	FractalDE de;
+
+private:
+	glm::vec3 eye;
+	float footprint = 0;				//0 iterates as deep as de.iterations every time
+};
+
 //  Mesh class (will complete later- this will be a refinement of Mesh from Project 1)
 //
 class Mesh : public SceneObject {
@@ -228,7 +375,7 @@ public:
 	}
 	bool intersect(const Ray &ray, glm::vec3 & point, glm::vec3 & normal);
 
-	float sdf(const glm::vec3 & p)
+	float sdf(const glm::vec3 & p) const
 	{
 		if (normal == glm::vec3(0, 1, 0))
 		{
@@ -244,6 +391,14 @@ public:
 		}
 	}
 
+	bool sdfDual(const Dual3 &p, Dual &dist) const
+	{
+		if (normal == glm::vec3(0, 1, 0)) dist = p.y - position.y;
+		else if (normal == glm::vec3(0, 0, 1)) dist = p.z - position.z;
+		else return false;				//sdf() has no gradient to give
+		return true;
+	}
+
 	glm::vec3 getNormal(const glm::vec3 &p) { return this->normal; }
 	void draw() {
 		plane.setPosition(position);
@@ -413,6 +568,14 @@ public:
 	float coneLength = 3;
 };
 
+//result of a scene distance query, the distance to the closest object and
+//that object's index in the scene vector (-1 for an empty scene)
+struct SceneHit {
+	float dist;
+	int id;
+	int evals;			//exact sdf() calls the query needed, for the benchmark
+};
+
 /*
 	Michael Wong CS 116A Final Project
 */
@@ -423,6 +586,7 @@ class ofApp : public ofBaseApp{
 		void setup();
 		void update();
 		void draw();
+		void exit();
 
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -439,13 +603,20 @@ class ofApp : public ofBaseApp{
 		void drawAxis(glm::vec3 pos);
 		void rayTrace();
 		void rayMarch();
-		bool rayMarch(Ray r, glm::vec3 &p);
-		float sceneSDF(const glm::vec3 &p);
+		ofColor tracePixel(int i, int j);
+		ofColor marchPixel(int i, int j, float tStart = 0, MarchCost *cost = nullptr);
+		void marchBlock(int x0, int y0, int size, float tStart);
+		float coneMarch(int x0, int y0, int size, float tStart);
+		bool rayMarch(const Ray &r, glm::vec3 &p, int &id, float tStart = 0, float footprint = 0, MarchCost *cost = nullptr);
+		SceneHit sceneQuery(const glm::vec3 &p) const;
+		float sceneSDF(const glm::vec3 &p) const;
+		void buildBVH();
+		Fractal *makeFractal(const glm::vec3 &p, float size);
 		ofColor ofApp::lambert(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse);
 		ofColor ofApp::phong(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse, const ofColor specular, float power);
 		bool isShadow(const Ray &r);
 		bool isSpotlightShadow(const Ray &r, const Light &l);
-		bool isSpotlightShadowRM(const Ray &r, const Light &l);
+		float shadowMarch(const Ray &r, float maxT);
 		ofColor allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse, const ofColor specular, float power, SceneObject* obj);	
 		ofColor lookup(float u, float v);
 		bool objSelected() { return (selected.size() ? true : false); };
@@ -453,7 +624,15 @@ class ofApp : public ofBaseApp{
 		void printChannel();
 		void deleteObj();
 		bool inSpotLight(const Light &l, const glm::vec3 &p);
-		glm::vec3 getNormalRM(const glm::vec3 &p);
+		glm::vec3 getNormalRM(const glm::vec3 &p, float eps = 0.01, int id = -1);
+		float pixelFootprint();
+		void runBenchmark();
+		void renderDistributed(char mode);
+		void runWorker();
+		string sceneToString();
+		string viewToString();
+		void sceneFromString(const string &text, bool replace = true);
+		void startServer();
 
 		bool bMouse = true;
 		bool bHide;
@@ -466,14 +645,15 @@ class ofApp : public ofBaseApp{
 		RenderCam renderCam;
 		ofImage image, map;
 		ofImage texture;
+		ImageSaver saver;							//encodes renders on a background thread so the next one can start right away
 
 		Plane plane;
 		ViewPlane vp; 
 		vector<SceneObject *> scene;				//vector to hold all the objects in the scene
+		SDFBVH bvh;									//tree over the scene for sceneQuery(), rebuilt before each render
 		vector<SceneObject*> selected;				//vector to hold an object that is selected
 		int imageH = 800, imageW = 1200;			//dimensions for the image to render
 		float squares = 10;							//the dimensions for how many tiles you want layed on the plane
-		int sceneIdx = 0;
 
 		glm::vec3 hitpoint, normal;					//vec3s to be used later for intersect
 		Light light;
@@ -509,4 +689,30 @@ class ofApp : public ofBaseApp{
 		bool bAnimate = false;
 		bool bAngle = false;
 		bool bTValue = false;
+		bool bBenchmark = false;					//set by --benchmark in main(), renders the canonical scene headless and exits
+		RegressionCheck check;						//golden image and timing checks for the benchmark renders (--check)
+		bool bCoordinator = false;					//set by --coordinator in main(), renders through the workers headless and exits
+		int coordinatorPort = 11999;				//port the coordinator listens on for workers
+		string workerAddress;						//host:port of the coordinator, set by --worker in main()
+		bool bServer = false;						//set by --server in main(), renders requests from clients until killed
+		int serverPort = 12000;						//port the render server listens on
+		RenderServer renderServer;
+		string serverView;							//camera and power of the resident scene, requests' view lines go on top
+
+		int numThreads = 0;							//threads rayMarch() renders with, 0 uses every core (--threads)
+		bool bDualNormals = true;					//normals from sdfDual() where the object has it, see getNormalRM() (--fd-normals turns it off)
+		float shadowK = 8;							//penumbra sharpness of the ray marched shadows, bigger is harder, see shadowMarch() (--shadow-k)
+		float relaxation = 1;						//step factor for over-relaxed marching, 1 is plain sphere tracing (--relax)
+		bool bHeatmap = false;						//record what every pixel cost to march, see MarchCostPass (--heatmap)
+		MarchCostPass marchCost;
+		bool bCones = true;							//primary rays start where a cone over their pixel block got to, see marchBlock() (--no-cones)
+		bool bFractalLOD = true;					//fractals iterate only as deep as a pixel can show, see Fractal::sdf() (--no-lod)
+		FractalDE::Kind fractalKind = FractalDE::MANDELBULB;	//what b adds (k cycles it) and --fractal <kind> renders
+		float fractalPower = 8;						//power of the Mandelbulbs b adds (--power)
+		int fractalIterations = 10;					//and their deepest iteration (--iterations)
+		bool bFractalScene = false;					//set by --fractal, the scene is the plane and one fractal
+
+		std::atomic<uint64_t> rayCount{ 0 };		//rays cast since the last reset, for the benchmark
+		std::atomic<uint64_t> sdfCount{ 0 };		//object sdf evaluations since the last reset
+		std::atomic<uint64_t> stepCount{ 0 };		//march steps since the last reset
 };
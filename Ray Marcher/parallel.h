@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ofMain.h"
+#include <atomic>
+
+//  Runs fn(x0, y0, x1, y1) over every tileSize x tileSize tile of a w x h
+//  image, spread across threads (0 uses every core).  Tiles are handed out
+//  from a shared counter rather than split up front, so a thread that gets
+//  cheap tiles (empty sky) just takes more of them.  fn is called from several
+//  threads at once and must only write to the pixels inside its tile.
+//
+inline void parallelTiles(int w, int h, int tileSize, int threads, std::function<void(int x0, int y0, int x1, int y1)> fn) {
+	int across = (w + tileSize - 1) / tileSize;
+	int down = (h + tileSize - 1) / tileSize;
+	int tiles = across * down;
+
+	if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, tiles);
+
+	std::atomic<int> next(0);
+	auto work = [&]() {
+		int t;
+		while ((t = next++) < tiles) {
+			int x0 = (t % across) * tileSize;
+			int y0 = (t / across) * tileSize;
+			fn(x0, y0, std::min(x0 + tileSize, w), std::min(y0 + tileSize, h));
+		}
+	};
+
+	vector<std::thread> pool;
+	for (int i = 1; i < threads; i++) pool.emplace_back(work);
+	work();						// this thread helps out too
+	for (std::thread &t : pool) t.join();
+}
@@ -0,0 +1,216 @@
+#include "renderServer.h"
+
+bool RenderServer::setup(int port, std::function<void(const string &)> loadScene, std::function<void(const string &)> setView, PixelFunc pixel) {
+	this->loadScene = loadScene;
+	this->setView = setView;
+	this->pixel = pixel;
+
+	if (!server.setup(port, false)) {
+		ofLogError("RenderServer") << "couldn't listen on port " << port;
+		return false;
+	}
+	ofLogNotice("RenderServer") << "listening on port " << port;
+	return true;
+}
+
+void RenderServer::send(int client, const string &payload) {
+	string msg = FrameReader::frame(payload);
+	server.sendRawBytes(client, msg.data(), msg.size());
+}
+
+// request ids are the client's own, so they are only looked up together with it
+//
+void RenderServer::finish(int client, const string &id, const string &status) {
+	for (int i = 0; i < requests.size(); i++) {
+		if (requests[i].client == client && requests[i].id == id) {
+			send(client, "DONE " + id + " " + status);
+			requests.erase(requests.begin() + i);
+			return;
+		}
+	}
+}
+
+void RenderServer::update() {
+	vector<char> buf(1 << 16);
+
+	for (int id = 0; id < server.getLastID(); id++) {
+		if (!server.isClientConnected(id)) {
+			// nobody to send the results to, drop its requests
+			if (readers.count(id)) {
+				readers.erase(id);
+				requests.erase(std::remove_if(requests.begin(), requests.end(), [id](const Request &r) { return r.client == id; }), requests.end());
+			}
+			continue;
+		}
+
+		int n;
+		while ((n = server.receiveRawBytes(id, buf.data(), buf.size())) > 0) {
+			readers[id].append(buf.data(), n);
+		}
+		string frame;
+		while (readers[id].next(frame)) handle(id, frame);
+	}
+
+	// don't spin when there's nothing to do, the headless loop calls us back right away
+	if (requests.empty()) {
+		ofSleepMillis(1);
+		return;
+	}
+
+	uint64_t start = ofGetElapsedTimeMillis();
+	while (ofGetElapsedTimeMillis() - start < budgetMs) {
+		Request *req = next();
+		if (!req) break;
+		if (req->deadline && ofGetElapsedTimeMillis() > req->deadline) {
+			finish(req->client, req->id, "deadline");
+			continue;
+		}
+		renderStep(*req);
+	}
+}
+
+void RenderServer::handle(int client, const string &frame) {
+	size_t eol = frame.find('\n');
+	string header = frame.substr(0, eol);
+	string body = eol == string::npos ? "" : frame.substr(eol + 1);
+
+	stringstream ss(header);
+	string type;
+	ss >> type;
+
+	if (type == "SCENE") {
+		string sceneId;
+		ss >> sceneId;
+		scenes[sceneId] = ofSplitString(body, "\n", true);
+		versions[sceneId]++;
+	}
+	else if (type == "DIFF") {
+		string sceneId;
+		ss >> sceneId;
+		applyDiff(sceneId, body);
+	}
+	else if (type == "RENDER") {
+		Request r;
+		r.w = r.h = 0;
+		r.mode = 0;
+		r.priority = 0;
+		uint64_t deadlineMs = 0;
+		r.client = client;
+		ss >> r.id >> r.sceneId >> r.w >> r.h >> r.mode >> r.priority >> deadlineMs;
+		r.deadline = deadlineMs ? ofGetElapsedTimeMillis() + deadlineMs : 0;
+		r.view = body;
+		r.seq = seq++;
+		if (!scenes.count(r.sceneId)) {
+			send(client, "DONE " + r.id + " unknown scene " + r.sceneId);
+		}
+		else if (r.w <= 0 || r.h <= 0 || r.w > maxImageSize || r.h > maxImageSize || (r.mode != 't' && r.mode != 'm')) {
+			send(client, "DONE " + r.id + " bad request");
+		}
+		else {
+			requests.push_back(r);
+		}
+	}
+	else if (type == "CANCEL") {
+		string id;
+		ss >> id;
+		finish(client, id, "cancelled");
+	}
+}
+
+void RenderServer::applyDiff(const string &sceneId, const string &edits) {
+	vector<string> &items = scenes[sceneId];
+	for (const string &edit : ofSplitString(edits, "\n", true)) {
+		if (edit[0] == '+') {
+			items.push_back(edit.substr(1));
+		}
+		else if (edit[0] == '-') {
+			int n = ofToInt(edit.substr(1));
+			if (n >= 0 && n < items.size()) items.erase(items.begin() + n);
+		}
+		else if (edit[0] == '=') {
+			size_t space = edit.find(' ');
+			int n = ofToInt(edit.substr(1, space - 1));
+			if (n >= 0 && n < items.size() && space != string::npos) items[n] = edit.substr(space + 1);
+		}
+	}
+	versions[sceneId]++;
+}
+
+// highest priority, then earliest deadline, then first come
+//
+RenderServer::Request *RenderServer::next() {
+	Request *best = nullptr;
+	for (Request &r : requests) {
+		if (!best) {
+			best = &r;
+			continue;
+		}
+		uint64_t rd = r.deadline ? r.deadline : UINT64_MAX;
+		uint64_t bd = best->deadline ? best->deadline : UINT64_MAX;
+		if (r.priority != best->priority) {
+			if (r.priority > best->priority) best = &r;
+		}
+		else if (rd != bd) {
+			if (rd < bd) best = &r;
+		}
+		else if (r.seq < best->seq) {
+			best = &r;
+		}
+	}
+	return best;
+}
+
+// render the next piece of a request, the preview first and then one tile
+//
+void RenderServer::renderStep(Request &req) {
+	// scenes stay loaded until a request needs a different one.  the view is
+	// cheap and applied every time since interleaved requests can differ
+	//
+	if (activeScene != req.sceneId || activeVersion != versions[req.sceneId]) {
+		loadScene(ofJoinString(scenes[req.sceneId], "\n"));
+		activeScene = req.sceneId;
+		activeVersion = versions[req.sceneId];
+	}
+	setView("image " + ofToString(req.w) + " " + ofToString(req.h) + "\n" + req.view);
+
+	if (req.nextTile < 0) {
+		int pw = (req.w + previewScale - 1) / previewScale;
+		int ph = (req.h + previewScale - 1) / previewScale;
+		string out = "PREVIEW " + req.id + " " + ofToString(pw) + " " + ofToString(ph) + "\n";
+		for (int row = 0; row < ph; row++) {
+			for (int col = 0; col < pw; col++) {
+				int x = min(col * previewScale + previewScale / 2, req.w - 1);
+				int y = min(row * previewScale + previewScale / 2, req.h - 1);
+				ofColor c = pixel(req.mode, x, req.h - 1 - y);
+				out += (char)c.r;
+				out += (char)c.g;
+				out += (char)c.b;
+			}
+		}
+		send(req.client, out);
+		req.nextTile = 0;
+		return;
+	}
+
+	int across = (req.w + tileSize - 1) / tileSize;
+	int down = (req.h + tileSize - 1) / tileSize;
+	int x = (req.nextTile % across) * tileSize;
+	int y = (req.nextTile / across) * tileSize;
+	int w = min(tileSize, req.w - x);
+	int h = min(tileSize, req.h - y);
+
+	string out = "TILE " + req.id + " " + ofToString(x) + " " + ofToString(y) + " " + ofToString(w) + " " + ofToString(h) + "\n";
+	out.reserve(out.size() + w * h * 3);
+	for (int row = y; row < y + h; row++) {
+		for (int col = x; col < x + w; col++) {
+			ofColor c = pixel(req.mode, col, req.h - 1 - row);
+			out += (char)c.r;
+			out += (char)c.g;
+			out += (char)c.b;
+		}
+	}
+	send(req.client, out);
+
+	req.nextTile++;
+	if (req.nextTile == across * down) finish(req.client, req.id, "ok");
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxNetwork.h"
+#include "tileRender.h"
+
+/*
+	Render server
+
+	A long running renderer that keeps scenes loaded between requests.  Start
+	the app with --server <port> (default 12000) and talk to it over TCP with
+	the same length prefixed messages as the tile coordinator (see
+	FrameReader).  Scenes use the text format of ofApp::sceneToString().
+
+	client -> server
+		SCENE <sceneId>\n<scene text>		upload or replace a scene
+		DIFF <sceneId>\n<edits>				edit a resident scene, one edit per line:
+												+<line>			append an item
+												-<n>			remove item n
+												=<n> <line>		replace item n
+		RENDER <reqId> <sceneId> <w> <h> <mode> <priority> <deadlineMs>\n<view lines>
+											mode is 't' or 'm', higher priority goes first,
+											deadline is ms from now (0 for none), the optional
+											view lines (camera, power) override the scene's
+		CANCEL <reqId>
+
+	server -> client
+		PREVIEW <reqId> <w> <h>\n<rgb>		1/8 resolution preview, sent first
+		TILE <reqId> <x> <y> <w> <h>\n<rgb>	full resolution tiles as they finish
+		DONE <reqId> <status>				ok, deadline, cancelled or an error
+
+	Requests are rendered a tile at a time, highest priority (then earliest
+	deadline) first, so a more urgent request overtakes the current one at the
+	next tile.  A request past its deadline is stopped and reported with what
+	it has sent so far.  The scene is only reloaded when a request needs a
+	different scene, or a newer version of the same one.
+*/
+
+class RenderServer {
+public:
+	int tileSize = 32;
+	int previewScale = 8;
+	int maxImageSize = 8192;		// widest or tallest image a request can ask for
+	uint64_t budgetMs = 15;			// time to spend rendering per update() so the network stays responsive
+
+	//  loadScene replaces the app's scene with a full scene description,
+	//  setView applies the view lines of a single request on top of it
+	//
+	bool setup(int port, std::function<void(const string &)> loadScene, std::function<void(const string &)> setView, PixelFunc pixel);
+
+	// poll the network and render for up to budgetMs, call this from update()
+	//
+	void update();
+
+private:
+	struct Request {
+		int client;
+		string id;
+		string sceneId;
+		int w, h;
+		char mode;
+		int priority;
+		uint64_t deadline;		// 0 for none
+		string view;
+		int nextTile = -1;		// -1 until the preview has been sent
+		uint64_t seq;
+	};
+
+	void handle(int client, const string &frame);
+	void applyDiff(const string &sceneId, const string &edits);
+	Request *next();
+	void renderStep(Request &req);
+	void finish(int client, const string &id, const string &status);
+	void send(int client, const string &payload);
+
+	ofxTCPServer server;
+	map<int, FrameReader> readers;
+	map<string, vector<string>> scenes;		// resident scenes, one item per line
+	map<string, int> versions;				// bumped on every SCENE or DIFF
+	string activeScene;
+	int activeVersion = -1;
+	vector<Request> requests;
+	uint64_t seq = 0;
+
+	std::function<void(const string &)> loadScene, setView;
+	PixelFunc pixel;
+};
@@ -0,0 +1,168 @@
+#include "sdfBVH.h"
+#include "ofApp.h"
+
+void SDFBVH::clear() {
+	objects.clear();
+	nodes.clear();
+	order.clear();
+	unbounded.clear();
+	boxMin.clear();
+	boxMax.clear();
+}
+
+void SDFBVH::build(const vector<SceneObject *> &objects) {
+	clear();
+	this->objects = objects;
+	boxMin.resize(objects.size());
+	boxMax.resize(objects.size());
+
+	for (int i = 0; i < objects.size(); i++) {
+		if (objects[i]->sdfBox(boxMin[i], boxMax[i])) order.push_back(i);
+		else unbounded.push_back(i);
+	}
+
+	nodes.reserve(2 * order.size() / leafSize + 1);
+	if (!order.empty()) buildNode(0, order.size());
+}
+
+// top down build, splitting the objects at the median of their centers along
+// the longest axis of the node
+//
+int SDFBVH::buildNode(int first, int count) {
+	int index = nodes.size();
+	nodes.push_back(Node());
+
+	Node node;
+	node.min = glm::vec3(std::numeric_limits<float>::infinity());
+	node.max = -node.min;
+	glm::vec3 cmin = node.min, cmax = node.max;
+	for (int i = first; i < first + count; i++) {
+		int o = order[i];
+		node.min = glm::min(node.min, boxMin[o]);
+		node.max = glm::max(node.max, boxMax[o]);
+		glm::vec3 c = (boxMin[o] + boxMax[o]) * 0.5f;
+		cmin = glm::min(cmin, c);
+		cmax = glm::max(cmax, c);
+	}
+
+	if (count <= leafSize) {
+		node.first = first;
+		node.count = count;
+		nodes[index] = node;
+		return index;
+	}
+
+	glm::vec3 extent = cmax - cmin;
+	int axis = 0;
+	if (extent.y > extent.x) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+
+	int half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count, [&](int a, int b) {
+		return boxMin[a][axis] + boxMax[a][axis] < boxMin[b][axis] + boxMax[b][axis];
+	});
+
+	int left = buildNode(first, half);
+	int right = buildNode(first + half, count - half);
+	node.left = left;
+	node.right = right;
+	nodes[index] = node;
+	return index;
+}
+
+// distance from p to the box, a lower bound on the sdf of anything inside it.
+// inside the box the objects could be at any depth so nothing is ruled out
+//
+float SDFBVH::boxDistance(const Node &node, const glm::vec3 &p) {
+	glm::vec3 d = glm::max(glm::max(node.min - p, p - node.max), glm::vec3(0));
+	if (d.x == 0 && d.y == 0 && d.z == 0) return -std::numeric_limits<float>::infinity();
+	return glm::length(d);
+}
+
+SceneHit SDFBVH::query(const glm::vec3 &p) const {
+	SceneHit closest = { std::numeric_limits<float>::infinity(), -1, 0 };
+
+	for (int i : unbounded) {
+		float dist = objects[i]->sdf(p);
+		closest.evals++;
+		if (dist < closest.dist) {
+			closest.dist = dist;
+			closest.id = i;
+		}
+	}
+	if (nodes.empty()) return closest;
+
+	// depth first, nearer child first.  each entry remembers its box distance
+	// so it can be dropped without another look if the best has improved since
+	//
+	struct Entry {
+		int node;
+		float dist;
+	};
+	Entry stack[64];
+	int top = 0;
+	stack[top++] = { 0, boxDistance(nodes[0], p) };
+
+	while (top > 0) {
+		Entry e = stack[--top];
+		if (e.dist >= closest.dist) continue;
+		const Node &node = nodes[e.node];
+
+		if (node.left < 0) {
+			for (int k = node.first; k < node.first + node.count; k++) {
+				int i = order[k];
+				if (objects[i]->sdfBound(p) >= closest.dist) continue;
+				float dist = objects[i]->sdf(p);
+				closest.evals++;
+				if (dist < closest.dist) {
+					closest.dist = dist;
+					closest.id = i;
+				}
+			}
+			continue;
+		}
+
+		Entry a = { node.left, boxDistance(nodes[node.left], p) };
+		Entry b = { node.right, boxDistance(nodes[node.right], p) };
+		if (a.dist < b.dist) std::swap(a, b);
+		if (a.dist < closest.dist) stack[top++] = a;		// further one goes underneath
+		if (b.dist < closest.dist) stack[top++] = b;
+	}
+
+	return closest;
+}
+
+// the object with the nearest bound is evaluated first, after that any object
+// whose bound is already further than the best distance so far can't win and
+// its full sdf is skipped
+//
+SceneHit SDFBVH::scan(const vector<SceneObject *> &objects, const glm::vec3 &p) {
+	SceneHit closest = { std::numeric_limits<float>::infinity(), -1, 0 };
+	if (objects.empty()) return closest;
+
+	int nearest = 0;
+	float nearestBound = std::numeric_limits<float>::infinity();
+	for (int i = 0; i < objects.size(); i++) {
+		float bound = objects[i]->sdfBound(p);
+		if (bound < nearestBound || i == 0) {
+			nearestBound = bound;
+			nearest = i;
+		}
+	}
+	closest.dist = objects[nearest]->sdf(p);
+	closest.id = nearest;
+	closest.evals = 1;
+
+	for (int i = 0; i < objects.size(); i++) {
+		if (i == nearest || objects[i]->sdfBound(p) >= closest.dist) continue;
+
+		float dist = objects[i]->sdf(p);
+		closest.evals++;
+		if (dist < closest.dist) {
+			closest.dist = dist;
+			closest.id = i;
+		}
+	}
+
+	return closest;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+
+class SceneObject;
+struct SceneHit;
+
+//  Bounding volume hierarchy over the distance field objects of a scene.
+//
+//  The scene query wants the smallest sdf over all objects, which a linear
+//  scan pays for once per object at every march step.  Here the objects are
+//  sorted into a tree of boxes (SceneObject::sdfBox).  The distance to a box
+//  is a lower bound on the sdf of everything inside it, so the query visits
+//  the nearer child first and skips any box that is already further away than
+//  the best distance found so far.  Near the surface of one object that leaves
+//  a handful of boxes and sdf() calls out of thousands.
+//
+//  Objects without a box (planes) can't be placed in the tree and are always
+//  evaluated.  The tree holds pointers into the scene, so it has to be rebuilt
+//  whenever objects are added, removed or moved.
+//
+class SDFBVH {
+public:
+	int leafSize = 4;			// objects per leaf
+
+	void build(const vector<SceneObject *> &objects);
+	void clear();
+
+	//  closest object to p and its index in the vector the tree was built from
+	//
+	SceneHit query(const glm::vec3 &p) const;
+
+	//  the same answer without the tree, a bounds gated scan of every object
+	//
+	static SceneHit scan(const vector<SceneObject *> &objects, const glm::vec3 &p);
+
+	int size() const { return objects.size(); }		// objects the tree was built over
+	int nodeCount() const { return nodes.size(); }
+
+private:
+	struct Node {
+		glm::vec3 min, max;
+		int left = -1, right = -1;		// children, -1 for a leaf
+		int first = 0, count = 0;		// leaf objects are order[first, first + count)
+	};
+
+	int buildNode(int first, int count);
+	static float boxDistance(const Node &node, const glm::vec3 &p);
+
+	vector<SceneObject *> objects;
+	vector<Node> nodes;
+	vector<int> order;					// object indices, grouped by leaf
+	vector<int> unbounded;				// objects without a box, checked on every query
+	vector<glm::vec3> boxMin, boxMax;	// per object
+};
@@ -0,0 +1,232 @@
+#include "tileRender.h"
+
+// pull the next complete message out of the buffer, if there is one
+//
+bool FrameReader::next(string &frame) {
+	if (buffer.size() < 4) return false;
+	const unsigned char *b = (const unsigned char *)buffer.data();
+	uint32_t length = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+	if (buffer.size() < 4 + length) return false;
+	frame = buffer.substr(4, length);
+	buffer.erase(0, 4 + length);
+	return true;
+}
+
+string FrameReader::frame(const string &payload) {
+	uint32_t length = payload.size();
+	string out(4, '\0');
+	out[0] = length & 0xff;
+	out[1] = (length >> 8) & 0xff;
+	out[2] = (length >> 16) & 0xff;
+	out[3] = (length >> 24) & 0xff;
+	return out + payload;
+}
+
+// render a tile on this process, used when no workers are around
+//
+void TileCoordinator::renderTile(ofPixels &pixels, const Tile &tile, int h, char mode, PixelFunc pixel) {
+	for (int y = tile.y; y < tile.y + tile.h; y++) {
+		for (int x = tile.x; x < tile.x + tile.w; x++) {
+			pixels.setColor(x, y, pixel(mode, x, h - 1 - y));
+		}
+	}
+}
+
+// copy a PIXELS message from a worker into the image.  results for tiles that
+// are already done (from a worker we gave up on) are dropped, and so is
+// anything that isn't exactly the rectangle the tile was handed out with
+//
+bool TileCoordinator::paste(ofPixels &pixels, const string &frame, const vector<Tile> &tiles, vector<bool> &done) {
+	size_t eol = frame.find('\n');
+	if (eol == string::npos) return false;
+	stringstream header(frame.substr(0, eol));
+	string type;
+	int id = -1, x = -1, y = -1, w = -1, h = -1;
+	header >> type >> id >> x >> y >> w >> h;
+	if (type != "PIXELS" || id < 0 || id >= (int)tiles.size()) return false;
+	if (w <= 0 || h <= 0 || w > tileSize || h > tileSize) return false;
+	const Tile &t = tiles[id];
+	if (x != t.x || y != t.y || w != t.w || h != t.h) return false;
+	if (frame.size() != eol + 1 + (size_t)w * h * 3) return false;
+	if (done[id]) return false;
+
+	const unsigned char *rgb = (const unsigned char *)frame.data() + eol + 1;
+	for (int row = 0; row < h; row++) {
+		for (int col = 0; col < w; col++) {
+			const unsigned char *c = rgb + (row * w + col) * 3;
+			pixels.setColor(x + col, y + row, ofColor(c[0], c[1], c[2]));
+		}
+	}
+	done[id] = true;
+	return true;
+}
+
+bool TileCoordinator::render(ofPixels &pixels, int w, int h, const string &scene, char mode, PixelFunc pixel) {
+	if (!server.setup(port, false)) {
+		ofLogError("TileCoordinator") << "couldn't listen on port " << port;
+		return false;
+	}
+	ofLogNotice("TileCoordinator") << "waiting for workers on port " << port;
+
+	// cut the image into tiles, the ones on the right and bottom edges can be smaller
+	//
+	deque<Tile> todo;
+	for (int y = 0; y < h; y += tileSize) {
+		for (int x = 0; x < w; x += tileSize) {
+			Tile t;
+			t.id = todo.size();
+			t.x = x;
+			t.y = y;
+			t.w = min(tileSize, w - x);
+			t.h = min(tileSize, h - y);
+			todo.push_back(t);
+		}
+	}
+	vector<Tile> tiles(todo.begin(), todo.end());		// by id, to check what comes back against
+	int total = todo.size();
+	int finished = 0;
+	vector<bool> done(total, false);
+
+	map<int, Assignment> busy;			// client id -> tile it is working on
+	map<int, FrameReader> readers;
+	set<int> greeted;					// clients that have been sent the scene
+	uint64_t lastWorkerSeen = ofGetElapsedTimeMillis();
+	vector<char> buf(1 << 16);
+
+	while (finished < total) {
+		int workers = 0;
+		uint64_t now = ofGetElapsedTimeMillis();
+
+		for (int id = 0; id < server.getLastID(); id++) {
+			if (!server.isClientConnected(id)) {
+				// worker died, put its tile back
+				if (busy.count(id)) {
+					ofLogWarning("TileCoordinator") << "lost worker " << id << ", requeueing tile " << busy[id].tile.id;
+					todo.push_front(busy[id].tile);
+					busy.erase(id);
+				}
+				readers.erase(id);
+				greeted.erase(id);
+				continue;
+			}
+			workers++;
+
+			if (!greeted.count(id)) {
+				string msg = FrameReader::frame("SCENE\n" + scene);
+				server.sendRawBytes(id, msg.data(), msg.size());
+				greeted.insert(id);
+			}
+
+			int n;
+			while ((n = server.receiveRawBytes(id, buf.data(), buf.size())) > 0) {
+				readers[id].append(buf.data(), n);
+			}
+			string frame;
+			while (readers[id].next(frame)) {
+				if (paste(pixels, frame, tiles, done)) finished++;
+				else if (busy.count(id) && !done[busy[id].tile.id]) {
+					ofLogWarning("TileCoordinator") << "bad reply from worker " << id << ", requeueing tile " << busy[id].tile.id;
+					todo.push_front(busy[id].tile);
+				}
+				busy.erase(id);
+			}
+
+			// worker is hung, give its tile to someone else
+			if (busy.count(id) && now - busy[id].started > tileTimeoutMs) {
+				ofLogWarning("TileCoordinator") << "worker " << id << " timed out, requeueing tile " << busy[id].tile.id;
+				todo.push_front(busy[id].tile);
+				busy.erase(id);
+				server.disconnectClient(id);
+				continue;
+			}
+
+			// skip tiles that a slow worker finished in the meantime
+			while (!todo.empty() && done[todo.front().id]) todo.pop_front();
+
+			if (!busy.count(id) && !todo.empty()) {
+				Tile t = todo.front();
+				todo.pop_front();
+				string msg = FrameReader::frame("TILE " + ofToString(t.id) + " " + ofToString(t.x) + " " + ofToString(t.y) + " " +
+					ofToString(t.w) + " " + ofToString(t.h) + " " + ofToString(h) + " " + mode);
+				server.sendRawBytes(id, msg.data(), msg.size());
+				busy[id] = Assignment{ t, now };
+			}
+		}
+
+		if (workers > 0) lastWorkerSeen = now;
+
+		while (!todo.empty() && done[todo.front().id]) todo.pop_front();
+		if (workers == 0 && !todo.empty() && now - lastWorkerSeen > noWorkerTimeoutMs) {
+			Tile t = todo.front();
+			todo.pop_front();
+			renderTile(pixels, t, h, mode, pixel);
+			done[t.id] = true;
+			finished++;
+		}
+		else {
+			ofSleepMillis(1);
+		}
+	}
+
+	string bye = FrameReader::frame("DONE");
+	for (int id = 0; id < server.getLastID(); id++) {
+		if (server.isClientConnected(id)) server.sendRawBytes(id, bye.data(), bye.size());
+	}
+	server.close();
+	return true;
+}
+
+bool TileWorker::run(const string &host, int port, std::function<void(const string &)> loadScene, PixelFunc pixel) {
+	if (!client.setup(host, port, false)) {
+		ofLogError("TileWorker") << "couldn't connect to " << host << ":" << port;
+		return false;
+	}
+
+	FrameReader reader;
+	vector<char> buf(1 << 16);
+	string frame;
+
+	while (client.isConnected()) {
+		int n;
+		while ((n = client.receiveRawBytes(buf.data(), buf.size())) > 0) {
+			reader.append(buf.data(), n);
+		}
+
+		while (reader.next(frame)) {
+			if (frame == "DONE") {
+				client.close();
+				return true;
+			}
+			if (frame.compare(0, 6, "SCENE\n") == 0) {
+				loadScene(frame.substr(6));
+				continue;
+			}
+
+			stringstream msg(frame);
+			string type;
+			int id, x, y, w, h, imageH;
+			char mode;
+			msg >> type >> id >> x >> y >> w >> h >> imageH >> mode;
+			if (type != "TILE") continue;
+
+			// pixels go back top row first, same layout as ofPixels
+			string out = "PIXELS " + ofToString(id) + " " + ofToString(x) + " " + ofToString(y) + " " +
+				ofToString(w) + " " + ofToString(h) + "\n";
+			out.reserve(out.size() + w * h * 3);
+			for (int row = y; row < y + h; row++) {
+				for (int col = x; col < x + w; col++) {
+					ofColor c = pixel(mode, col, imageH - 1 - row);
+					out += (char)c.r;
+					out += (char)c.g;
+					out += (char)c.b;
+				}
+			}
+			string reply = FrameReader::frame(out);
+			client.sendRawBytes(reply.data(), reply.size());
+		}
+		ofSleepMillis(1);
+	}
+
+	ofLogError("TileWorker") << "lost connection to the coordinator";
+	return false;
+}
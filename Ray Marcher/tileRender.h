@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxNetwork.h"
+#include <deque>
+#include <set>
+
+/*
+	Distributed tile rendering
+
+	A coordinator splits the image into tiles and hands them out to worker
+	processes over TCP.  Workers are the same app started with
+	--worker host:port; they receive the scene from the coordinator, render
+	whatever tiles they are given and send the pixels back.  A worker that
+	disconnects or sits on a tile for longer than tileTimeoutMs loses the tile
+	and it goes back in the queue, so a crashed worker only costs the tile it
+	was working on.  If no worker shows up the coordinator renders the tiles
+	itself.
+
+	On one machine:
+		RayMarcher --coordinator 11999     (or press 'n' / 'N' in the app)
+		RayMarcher --worker localhost:11999   (as many as you have cores)
+*/
+
+//  pixel callback: mode ('t' trace, 'm' march) and pixel (i, j) with j
+//  counting up from the bottom of the image, same as tracePixel/marchPixel
+//
+typedef std::function<ofColor(char mode, int i, int j)> PixelFunc;
+
+//  ofxTCP's send()/receive() split messages on a text delimiter which raw
+//  pixel data can contain, so messages are sent with a 4 byte length in front
+//  instead.  FrameReader collects the bytes as they arrive and hands back
+//  whole messages.
+//
+class FrameReader {
+public:
+	void append(const char *bytes, int n) { buffer.append(bytes, n); }
+	bool next(string &frame);
+
+	static string frame(const string &payload);
+
+private:
+	string buffer;
+};
+
+struct Tile {
+	int id;
+	int x, y, w, h;			// in image rows, y = 0 is the top of the image
+};
+
+class TileCoordinator {
+public:
+	int port = 11999;
+	int tileSize = 32;
+	uint64_t tileTimeoutMs = 30000;		// a worker that takes longer than this on a tile loses it
+	uint64_t noWorkerTimeoutMs = 5000;	// start rendering locally if nobody has connected by then
+
+	//  render a w x h image into pixels.  scene is sent to every worker as it
+	//  connects, pixel renders tiles locally when there are no workers
+	//
+	bool render(ofPixels &pixels, int w, int h, const string &scene, char mode, PixelFunc pixel);
+
+private:
+	struct Assignment {
+		Tile tile;
+		uint64_t started;
+	};
+
+	void renderTile(ofPixels &pixels, const Tile &tile, int h, char mode, PixelFunc pixel);
+	bool paste(ofPixels &pixels, const string &frame, const vector<Tile> &tiles, vector<bool> &done);
+
+	ofxTCPServer server;
+};
+
+class TileWorker {
+public:
+	//  connect to the coordinator and render tiles until it says DONE.
+	//  loadScene is called with the scene text before the first tile.
+	//  returns false if the connection was lost.
+	//
+	bool run(const string &host, int port, std::function<void(const string &)> loadScene, PixelFunc pixel);
+
+private:
+	ofxTCPClient client;
+};
@@ -0,0 +1,93 @@
+#include "depthReprojection.h"
+#include "ofApp.h"
+
+void DepthReprojection::clear() {
+	width = height = 0;
+	current.clear();
+	previous.clear();
+	objects.clear();
+	starts.clear();
+	reused = 0;
+	motion = 0;
+	seconds = 0;
+}
+
+void DepthReprojection::beginFrame(int w, int h) {
+	width = w;
+	height = h;
+	current.assign(w * h, { glm::vec3(0), nullptr });
+}
+
+void DepthReprojection::endFrame(RenderCam &cam, float footprint, const vector<SceneObject *> &scene) {
+	previous.swap(current);
+	current.clear();
+	camera = cam.position;
+	cameraFootprint = footprint;
+	objects.clear();
+	for (const SceneObject *obj : scene) objects.push_back({ obj, obj->position, obj->rotation, obj->radius, obj->t });
+}
+
+bool DepthReprojection::reproject(RenderCam &cam, float footprint, const vector<SceneObject *> &scene) {
+	auto begin = std::chrono::high_resolution_clock::now();
+	starts.clear();
+	reused = 0;
+	motion = 0;
+	if (previous.empty()) return false;
+
+	// how far each object moved since, and whether anything else about the
+	// scene changed.  a deleted object only takes its hits with it
+	vector<glm::vec3> moved(objects.size(), glm::vec3(0));
+	vector<bool> kept(objects.size(), false);
+	for (const SceneObject *obj : scene) {
+		auto was = std::find_if(objects.begin(), objects.end(), [obj](const Snapshot &s) { return s.obj == obj; });
+		if (was == objects.end()) return false;
+		if (obj->rotation != was->rotation || obj->radius != was->radius || obj->t != was->t) return false;
+		int k = was - objects.begin();
+		moved[k] = obj->position - was->position;
+		kept[k] = true;
+		motion = std::max(motion, glm::length(moved[k]));
+	}
+
+	// the nearest hit that lands on every pixel.  an old pixel is 2 * footprint
+	// * distance across at the hit, so in the new image it is about the ratio
+	// of the two of those pixels wide, and the hit covers that many
+	float inf = std::numeric_limits<float>::infinity();
+	vector<float> nearest(width * height, inf);
+	glm::vec3 c = cam.position;
+	float planeZ = cam.view.position.z;
+	glm::vec2 viewMin = cam.view.min;
+	glm::vec2 viewSize(cam.view.width(), cam.view.height());
+	for (const Hit &hit : previous) {
+		if (!hit.obj) continue;
+		int k = std::find_if(objects.begin(), objects.end(), [&hit](const Snapshot &s) { return s.obj == hit.obj; }) - objects.begin();
+		if (k == (int)objects.size() || !kept[k]) continue;
+
+		glm::vec3 q = hit.p + moved[k];
+		if ((q.z - c.z) * (planeZ - c.z) <= 0) continue;			// behind the camera
+		float s = (planeZ - c.z) / (q.z - c.z);
+		glm::vec2 uv = (glm::vec2(c.x, c.y) + (glm::vec2(q.x, q.y) - glm::vec2(c.x, c.y)) * s - viewMin) / viewSize;
+		int x = floor(uv.x * width), y = floor(uv.y * height);
+		if (x < 0 || y < 0 || x >= width || y >= height) continue;
+
+		float depth = glm::distance(q, c);
+		float before = cameraFootprint * glm::distance(hit.p, camera);
+		int r = std::min((int)ceil(0.5f * before / std::max(footprint * depth, 1e-6f)), 4);
+		for (int j = std::max(y - r, 0); j <= std::min(y + r, height - 1); j++) {
+			for (int i = std::max(x - r, 0); i <= std::min(x + r, width - 1); i++) {
+				float &n = nearest[j * width + i];
+				n = std::min(n, depth);
+			}
+		}
+	}
+
+	starts.assign(width * height, 0);
+	for (int i = 0; i < width * height; i++) {
+		if (nearest[i] == inf) continue;
+		starts[i] = std::max(nearest[i] * (1 - slack) - motion, 0.0f);
+		if (starts[i] > 0) reused++;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+	seconds = elapsed.count();
+	return reused > 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ofMain.h"
+
+class SceneObject;
+class RenderCam;
+
+//  Carries the hits of one frame of an animation over to the next, so its
+//  primary rays can start marching close to the surface instead of at the
+//  camera.
+//
+//  While a frame renders, record() keeps every pixel's hit point and the
+//  object it is on.  endFrame() keeps those, the camera and where every
+//  object was.  reproject() then moves each hit with its object's
+//  translation and splats it into the next frame's camera.  The splat is a
+//  square about as wide as the old pixel is in the new image.  Every new
+//  pixel takes the nearest depth that lands on it.  start() is that depth
+//  less a small fraction of it, less the furthest any object has moved
+//  since.  Moving surfaces can cut in front of the ray by at most that much.
+//
+//  Pixels no hit lands on have no start, which covers most of what the
+//  camera uncovers.  Near an occluder's edge its own splats are the nearest,
+//  so a thin uncovered strip starts in front of it.  It is not a proof: an
+//  object that no pixel saw last frame can still be skipped.  ofApp checks
+//  that a start isn't inside anything (see ofApp::reuseStart()).  A frame
+//  where an object was added, or changed any other way than moving, has
+//  nothing to reuse.
+//
+class DepthReprojection {
+public:
+	//  x, y are pixels the way marchPixel() counts them, y up from the bottom
+	//
+	void beginFrame(int w, int h);
+	void record(int x, int y, bool hit, const glm::vec3 &p, const SceneObject *obj) {
+		current[y * width + x] = { p, hit ? obj : nullptr };
+	}
+	void endFrame(RenderCam &cam, float footprint, const vector<SceneObject *> &scene);
+	void clear();
+
+	//  works out start() for every pixel of the next frame, seen from cam
+	//  (footprint as in ofApp::pixelFootprint()).  false if there is no
+	//  last frame to go from, or nothing of it can be used
+	//
+	bool reproject(RenderCam &cam, float footprint, const vector<SceneObject *> &scene);
+
+	//  how far along its ray pixel (x, y) can start, 0 if it has to start
+	//  at the camera
+	//
+	float start(int x, int y) const { return starts.empty() ? 0 : starts[y * width + x]; }
+
+	int reusedPixels() const { return reused; }
+	float maxMotion() const { return motion; }
+	double reprojectSeconds() const { return seconds; }
+
+	float slack = 0.02;			// fraction of the depth every start backs off by
+
+private:
+	struct Hit {
+		glm::vec3 p;
+		const SceneObject *obj;		// nullptr for a miss
+	};
+
+	struct Snapshot {
+		const SceneObject *obj;
+		glm::vec3 position, rotation;
+		float radius;
+		ofVec2f t;
+	};
+
+	int width = 0, height = 0;
+	vector<Hit> current, previous;
+	vector<Snapshot> objects;			// the scene when previous was rendered
+	glm::vec3 camera;					// and where it was seen from
+	float cameraFootprint = 0;
+	vector<float> starts;
+	int reused = 0;
+	float motion = 0;
+	double seconds = 0;
+};
@@ -0,0 +1,231 @@
+#include "heightfieldTracer.h"
+#include "ofApp.h"
+#include "parallel.h"
+
+void HeightfieldTracer::clear() {
+	baked = nullptr;
+	cells = glm::ivec2(0);
+	heights.clear();
+	levels.clear();
+	levelSize.clear();
+	seconds = 0;
+}
+
+bool HeightfieldTracer::isBaked(const WaterPool *pool) const {
+	return baked && baked == pool && bakedPosition == pool->position;
+}
+
+void HeightfieldTracer::bake(const WaterPool *pool, glm::vec3 min, glm::vec3 max, float cellSize, int threads) {
+	auto begin = std::chrono::high_resolution_clock::now();
+	clear();
+	baked = pool;
+	bakedPosition = pool->position;
+	cell = cellSize;
+	origin = glm::vec2(min.x, min.z);
+	cells = glm::max(glm::ivec2(glm::ceil((glm::vec2(max.x, max.z) - origin) / cell)), glm::ivec2(1));
+	end = origin + glm::vec2(cells) * cell;
+
+	// the octaves never add up to more than the bound either way (see WaterPool::sdfBound())
+	bottom = pool->position.y - pool->noise.bound();
+	top = pool->position.y + pool->noise.bound();
+
+	// the height at every corner, which is where nearly all of the time goes
+	int nx = cells.x + 1, nz = cells.y + 1;
+	heights.resize(nx * nz);
+	parallelTiles(nx, nz, 16, threads, [&](int x0, int z0, int x1, int z1) {
+		for (int z = z0; z < z1; z++) {
+			for (int x = x0; x < x1; x++) {
+				heights[z * nx + x] = surfaceHeight(origin.x + x * cell, origin.y + z * cell);
+			}
+		}
+	});
+
+	slope = 0;
+	for (int z = 0; z < nz; z++) {
+		for (int x = 0; x < nx; x++) {
+			float h = heights[z * nx + x];
+			if (x > 0) slope = std::max(slope, fabs(h - heights[z * nx + x - 1]) / cell);
+			if (z > 0) slope = std::max(slope, fabs(h - heights[(z - 1) * nx + x]) / cell);
+		}
+	}
+
+	// no point in a cell is further than its diagonal from the highest corner
+	float margin = slope * cell * sqrt(2.0f);
+	levels.push_back(vector<float>(cells.x * cells.y));
+	levelSize.push_back(cells);
+	for (int z = 0; z < cells.y; z++) {
+		for (int x = 0; x < cells.x; x++) {
+			float h = std::max(std::max(heights[z * nx + x], heights[z * nx + x + 1]), std::max(heights[(z + 1) * nx + x], heights[(z + 1) * nx + x + 1]));
+			levels[0][z * cells.x + x] = std::min(h + margin, top);
+		}
+	}
+
+	while (levelSize.back().x > 1 || levelSize.back().y > 1) {
+		int below = levels.size() - 1;
+		glm::ivec2 size = (levelSize[below] + 1) / 2;
+		vector<float> level(size.x * size.y, -std::numeric_limits<float>::infinity());
+		for (int z = 0; z < levelSize[below].y; z++) {
+			for (int x = 0; x < levelSize[below].x; x++) {
+				float &h = level[(z / 2) * size.x + x / 2];
+				h = std::max(h, maxHeight(below, x, z));
+			}
+		}
+		levels.push_back(level);
+		levelSize.push_back(size);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+	seconds = elapsed.count();
+}
+
+// the topmost y at (x, z) where the pool's sdf crosses 0.  the sdf is positive
+// at top and negative at bottom, so walk down from top by half of it and
+// bisect the first step that ends up below the surface
+float HeightfieldTracer::surfaceHeight(float x, float z) const {
+	float y = top;
+	float f = baked->sdf(glm::vec3(x, y, z));
+	while (y > bottom) {
+		float above = y;
+		y = std::max(y - std::max(0.5f * f, 0.01f), bottom);
+		f = baked->sdf(glm::vec3(x, y, z));
+		if (f <= 0) {
+			float below = y;
+			for (int i = 0; i < 12; i++) {
+				float mid = (above + below) / 2;
+				if (baked->sdf(glm::vec3(x, mid, z)) > 0) above = mid;
+				else below = mid;
+			}
+			return (above + below) / 2;
+		}
+	}
+	return bottom;
+}
+
+bool HeightfieldTracer::trace(const Ray &r, float maxT, float &t, int &evals, int &steps) const {
+	evals = 0;
+	steps = 0;
+	if (!baked) return false;
+	if (r.p.y <= bottom) {
+		t = 0;					// under the water already
+		return true;
+	}
+
+	// the part of the ray that is between bottom and top, above it there is
+	// nothing to hit and it can't get below bottom without a hit first
+	float t0 = 0, t1 = maxT;
+	if (r.d.y != 0) t1 = std::min(t1, std::max((top - r.p.y) / r.d.y, (bottom - r.p.y) / r.d.y));
+	else if (r.p.y > top) return false;
+	if (r.p.y > top) t0 = (top - r.p.y) / r.d.y;
+	if (t0 >= t1) return false;
+
+	// and the part of that over the grid
+	float g0 = t0, g1 = t1;
+	for (int axis = 0; axis < 2; axis++) {
+		float p = axis ? r.p.z : r.p.x, d = axis ? r.d.z : r.d.x;
+		float lo = axis ? origin.y : origin.x, hi = axis ? end.y : end.x;
+		if (d != 0) {
+			float a = (lo - p) / d, b = (hi - p) / d;
+			g0 = std::max(g0, std::min(a, b));
+			g1 = std::min(g1, std::max(a, b));
+		}
+		else if (p < lo || p > hi) g1 = g0;
+	}
+	if (g0 >= g1) return march(r, t0, t1, t, evals, steps);
+	if (march(r, t0, g0, t, evals, steps)) return true;
+
+	int topLevel = levels.size() - 1;
+	int level = topLevel;
+	float s = g0;
+	while (s < g1) {
+		steps++;
+		glm::vec3 q = r.p + r.d * (s + 1e-4f);			// just inside the node the ray goes through next
+		int x = ofClamp(floor((q.x - origin.x) / cell), 0, cells.x - 1);
+		int z = ofClamp(floor((q.z - origin.y) / cell), 0, cells.y - 1);
+		int i = x >> level, j = z >> level;
+
+		float size = cell * (1 << level);
+		glm::vec2 n0 = origin + glm::vec2(i, j) * size, n1 = n0 + size;
+		float tx = r.d.x > 0 ? (n1.x - r.p.x) / r.d.x : r.d.x < 0 ? (n0.x - r.p.x) / r.d.x : std::numeric_limits<float>::infinity();
+		float tz = r.d.z > 0 ? (n1.y - r.p.z) / r.d.z : r.d.z < 0 ? (n0.y - r.p.z) / r.d.z : std::numeric_limits<float>::infinity();
+		float exit = std::max(std::min(std::min(tx, tz), g1), s + 1e-4f);
+
+		float h = maxHeight(level, i, j);
+		if (std::min(r.p.y + r.d.y * s, r.p.y + r.d.y * exit) > h) {
+			s = exit;							// over everything in the node
+			level = std::min(level + 1, topLevel);
+			continue;
+		}
+		if (level > 0) {
+			level--;
+			continue;
+		}
+		if (refine(r, s, exit, h, t, evals)) return true;
+		s = exit;
+		level = std::min(level + 1, topLevel);
+	}
+
+	return march(r, g1, t1, t, evals, steps);
+}
+
+// samples the exact sdf from t0 to t1 (clipped to below height, the cell's top) every
+// half a cell and bisects the first sample that is below the surface
+bool HeightfieldTracer::refine(const Ray &r, float t0, float t1, float height, float &t, int &evals) const {
+	if (r.d.y < 0) t0 = std::max(t0, (height - r.p.y) / r.d.y);
+	else if (r.d.y > 0) t1 = std::min(t1, (height - r.p.y) / r.d.y);
+	if (t0 > t1) return false;
+
+	float above = t0;
+	evals++;
+	if (baked->sdf(r.p + r.d * above) <= 0) {
+		t = above;
+		return true;
+	}
+
+	int samples = std::max(2, (int)ceil((t1 - t0) / (0.5f * cell)));
+	for (int k = 1; k <= samples; k++) {
+		float below = t0 + (t1 - t0) * k / samples;
+		evals++;
+		if (baked->sdf(r.p + r.d * below) > 0) {
+			above = below;
+			continue;
+		}
+		for (int i = 0; i < 12; i++) {
+			float mid = (above + below) / 2;
+			evals++;
+			if (baked->sdf(r.p + r.d * mid) > 0) above = mid;
+			else below = mid;
+		}
+		t = above;				// on the outside, so shading starts off the surface
+		return true;
+	}
+	return false;
+}
+
+// plain sphere tracing from t0 to t1, for the parts of the ray off the grid
+bool HeightfieldTracer::march(const Ray &r, float t0, float t1, float &t, int &evals, int &steps) const {
+	float s = t0;
+	for (int i = 0; i < maxSteps && s < t1; i++) {
+		float d = baked->sdf(r.p + r.d * s);
+		evals++;
+		steps++;
+		if (d < hitDistance) {
+			t = s;
+			return true;
+		}
+		s += d;
+	}
+	return false;
+}
+
+size_t HeightfieldTracer::bytes() const {
+	size_t n = heights.size();
+	for (const vector<float> &level : levels) n += level.size();
+	return n * sizeof(float);
+}
+
+string HeightfieldTracer::report() const {
+	stringstream ss;
+	ss << "heightfield " << cells.x << "x" << cells.y << " cells of " << cell << ", " << levelCount() << " mip levels, "
+		<< bytes() / (1024.0 * 1024.0) << " MB, slope " << slope << ", in " << seconds << " s";
+	return ss.str();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ofMain.h"
+
+class Ray;
+class WaterPool;
+
+//  Traces rays against a WaterPool as a heightfield instead of sphere tracing
+//  its sdf.
+//
+//  The pool's surface is where sdf() crosses 0, and for every (x, z) nothing
+//  is above the topmost crossing.  bake() finds that height on a grid of
+//  cells over [min, max] in x and z and builds a max mip over it: level 0
+//  holds the highest point of each cell (its corners plus the most the
+//  surface can rise between them), every level above the highest of 2x2
+//  nodes below.  trace() walks the ray through the nodes, skips any node the
+//  ray stays above, and only in level 0 cells it dips into samples the exact
+//  sdf along the ray and bisects the crossing.  So the hit doesn't depend on
+//  how well sdf() estimates the distance, and a crossing can't be stepped
+//  over as long as it is wider than half a cell along the ray.
+//
+//  Outside the grid the ray falls back to sphere tracing the sdf.  Like
+//  SDFBrickCache the bake is only good for the pool as it was, isBaked()
+//  catches it moving.
+//
+class HeightfieldTracer {
+public:
+	//  samples pool over [min, max] in x and z (y is ignored) in cells of
+	//  cellSize, spread across threads (0 uses every core)
+	//
+	void bake(const WaterPool *pool, glm::vec3 min, glm::vec3 max, float cellSize, int threads = 0);
+	void clear();
+
+	bool isBaked(const WaterPool *pool) const;
+	const WaterPool *object() const { return baked; }
+
+	//  the first crossing of r with the surface up to maxT along it, if there
+	//  is one its distance goes in t.  evals and steps get the sdf evaluations
+	//  and the nodes visited
+	//
+	bool trace(const Ray &r, float maxT, float &t, int &evals, int &steps) const;
+
+	//  what the bake cost and what it holds
+	//
+	double bakeSeconds() const { return seconds; }
+	int levelCount() const { return (int)levels.size(); }
+	size_t bytes() const;
+	float lipschitz() const { return slope; }
+	string report() const;
+
+	float hitDistance = 0.01;		// for the parts of the ray off the grid, which are sphere traced
+	int maxSteps = 200;
+
+private:
+	float surfaceHeight(float x, float z) const;
+	float maxHeight(int level, int i, int j) const { return levels[level][j * levelSize[level].x + i]; }
+	bool refine(const Ray &r, float t0, float t1, float height, float &t, int &evals) const;
+	bool march(const Ray &r, float t0, float t1, float &t, int &evals, int &steps) const;
+
+	const WaterPool *baked = nullptr;
+	glm::vec3 bakedPosition;		// where the pool was, see isBaked()
+
+	glm::vec2 origin, end;			// the grid in x and z
+	float cell = 0;
+	glm::ivec2 cells = glm::ivec2(0);
+	float bottom = 0, top = 0;		// the pool's surface stays between these
+
+	vector<float> heights;			// the topmost crossing at every cell corner
+	vector<vector<float>> levels;	// the max mip, levels[0] per cell
+	vector<glm::ivec2> levelSize;
+
+	float slope = 0;				// steepest change in height between neighbouring corners, per unit
+	double seconds = 0;
+};
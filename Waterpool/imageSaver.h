@@ -0,0 +1,112 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+
+//  Saves images on a background thread so rendering can carry on while the
+//  previous frame is being encoded.
+//
+//  save() copies the pixels into a bounded queue and returns right away.  If
+//  the queue is full it blocks until the encoder has caught up, so a long
+//  animation can't pile up unbounded copies of the framebuffer.  flush() waits
+//  for everything queued so far to be written; the destructor flushes too.
+//
+class ImageSaver {
+public:
+	ImageSaver(int capacity = 4) {
+		this->capacity = capacity;
+		worker = std::thread(&ImageSaver::run, this);
+	}
+
+	~ImageSaver() {
+		flush();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bDone = true;
+		}
+		wake.notify_all();
+		worker.join();
+	}
+
+	//  queue pixels to be written to filename (in the data folder).  JPGs are
+	//  compressed at the level set with setQuality(), PNGs are always lossless.
+	//
+	void save(const ofPixels &pixels, const string &filename) {
+		std::unique_lock<std::mutex> lock(mutex);
+		space.wait(lock, [this] { return (int)queue.size() < capacity; });		// backpressure
+		queue.push_back(Job{ pixels, filename, quality });
+		wake.notify_one();
+	}
+
+	//  block until every queued image is on disk
+	//
+	void flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this] { return queue.empty() && !bBusy; });
+	}
+
+	void setQuality(ofImageQualityType q) {
+		std::lock_guard<std::mutex> lock(mutex);
+		quality = q;
+	}
+
+	//  best, high, medium, low or worst, as --jpeg-quality takes them.
+	//  anything else is warned about and left at best
+	//
+	static ofImageQualityType qualityFromName(const string &name) {
+		if (name == "best") return OF_IMAGE_QUALITY_BEST;
+		if (name == "high") return OF_IMAGE_QUALITY_HIGH;
+		if (name == "medium") return OF_IMAGE_QUALITY_MEDIUM;
+		if (name == "low") return OF_IMAGE_QUALITY_LOW;
+		if (name == "worst") return OF_IMAGE_QUALITY_WORST;
+		ofLogWarning("ImageSaver") << "unknown JPG quality \"" << name << "\", expected best, high, medium, low or worst; using best";
+		return OF_IMAGE_QUALITY_BEST;
+	}
+
+	int pending() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return queue.size() + (bBusy ? 1 : 0);
+	}
+
+private:
+	struct Job {
+		ofPixels pixels;
+		string filename;
+		ofImageQualityType quality;
+	};
+
+	void run() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return bDone || !queue.empty(); });
+				if (queue.empty()) return;		// done and drained
+				job = std::move(queue.front());
+				queue.pop_front();
+				bBusy = true;
+			}
+			space.notify_one();
+
+			if (!ofSaveImage(job.pixels, job.filename, job.quality)) {
+				ofLogError("ImageSaver") << "couldn't save " << job.filename;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				bBusy = false;
+			}
+			idle.notify_all();
+		}
+	}
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake, space, idle;
+	std::deque<Job> queue;
+	int capacity;
+	ofImageQualityType quality = OF_IMAGE_QUALITY_BEST;
+	bool bBusy = false;
+	bool bDone = false;
+};
@@ -1,13 +1,80 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "ofAppNoWindow.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char *argv[]){
+	ofApp *app = new ofApp();
+
+	// --benchmark renders the canonical scene without a window, appends the
+	// timings to bin/data/benchmark.json and exits
+	// --check also compares the renders against bin/data/golden/ and exits
+	// with 1 on a regression, --bless rewrites the references
+	// --psnr <dB> and --slowdown <fraction> set the tolerances
+	// --jpeg-quality <best|high|medium|low|worst> sets how much JPG renders are compressed (best)
+	// --threads <n> renders with n threads instead of one per core
+	// --bake marches the pool through a baked sparse brick grid of its sdf,
+	// --bake-voxel <size> sets the spacing of the samples near the surface (0.25)
+	// --heightfield traces the pool as a heightfield over a max mip of its
+	// surface instead of marching it, --heightfield-cell <size> sets the cells (0.125)
+	// --mesh starts with the viewport showing the scene's sdf as a mesh (n
+	// toggles it, N saves it to scene.obj), --mesh-cell <size> sets the cells (0.25)
+	// --animate <frames> makes m render that many frames to frame0000.PNG on,
+	// the camera moving --dolly <dz> (-0.1) and the objects going --turn
+	// <degrees> (0) around the pool each frame.  every frame after the first
+	// starts its rays from where the last one's hits reproject to, --no-reuse
+	// marches them all from the camera
+	// --fd-normals takes every normal from finite differences, even where the object has sdfDual()
+	// --shadow-k <k> sets how soft the ray marched shadows are, bigger is harder (default 8)
+	// --relax <w> ray marches with over-relaxed steps of w * dist (1.2 - 1.9)
+	// --lipschitz divides each object's sdf by how fast it can change, so no
+	// step goes through the pool (the steps get a lot shorter)
+	// --no-cones marches every primary ray from the camera, without the cone pre-pass
+	// --heatmap also writes the march steps of every pixel to marchHeatmap.PNG,
+	// how each one ended to marchEnd.PNG and a histogram to marchHistogram.txt
+	//
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--benchmark") app->bBenchmark = true;
+		else if (arg == "--check") app->check.enabled = true;
+		else if (arg == "--bless") app->check.enabled = app->check.bless = true;
+		else if (arg == "--psnr" && i + 1 < argc) app->check.minPSNR = ofToFloat(argv[++i]);
+		else if (arg == "--slowdown" && i + 1 < argc) app->check.maxSlowdown = ofToFloat(argv[++i]);
+		else if (arg == "--jpeg-quality" && i + 1 < argc) app->saver.setQuality(ImageSaver::qualityFromName(argv[++i]));
+		else if (arg == "--threads" && i + 1 < argc) app->numThreads = ofToInt(argv[++i]);
+		else if (arg == "--bake") app->bBake = true;
+		else if (arg == "--bake-voxel" && i + 1 < argc) app->bakeVoxel = ofToFloat(argv[++i]);
+		else if (arg == "--heightfield") app->bHeightfield = true;
+		else if (arg == "--heightfield-cell" && i + 1 < argc) app->heightfieldCell = ofToFloat(argv[++i]);
+		else if (arg == "--mesh") app->bMeshPreview = true;
+		else if (arg == "--mesh-cell" && i + 1 < argc) app->meshCell = ofToFloat(argv[++i]);
+		else if (arg == "--animate" && i + 1 < argc) {
+			app->bAnimate = true;
+			app->animFrames = ofToInt(argv[++i]);
+		}
+		else if (arg == "--dolly" && i + 1 < argc) app->animDolly = glm::vec3(0, 0, ofToFloat(argv[++i]));
+		else if (arg == "--turn" && i + 1 < argc) app->animTurn = ofToFloat(argv[++i]);
+		else if (arg == "--no-reuse") app->bReuse = false;
+		else if (arg == "--fd-normals") app->bDualNormals = false;
+		else if (arg == "--shadow-k" && i + 1 < argc) app->shadowK = ofToFloat(argv[++i]);
+		else if (arg == "--relax" && i + 1 < argc) app->relaxation = ofToFloat(argv[++i]);
+		else if (arg == "--lipschitz") app->bLipschitz = true;
+		else if (arg == "--no-cones") app->bCones = false;
+		else if (arg == "--heatmap") app->bHeatmap = true;
+	}
+	if (app->check.enabled) app->bBenchmark = true;
+
+	if (app->bBenchmark) {
+		ofAppNoWindow window;
+		ofSetupOpenGL(&window, 1024, 768, OF_WINDOW);
+		return ofRunApp(app);
+	}
+
 	ofSetupOpenGL(1024,768,OF_WINDOW);			// <-------- setup the GL context
 
 	// this kicks off the running of my app
 	// can be OF_WINDOW or OF_FULLSCREEN
 	// pass in width and height too:
-	ofRunApp(new ofApp());
+	ofRunApp(app);
 
 }
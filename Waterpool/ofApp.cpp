@@ -106,6 +106,14 @@ void ofApp::setup() {
 	//lights.push_back(new Light(50, glm::vec3(4, 6, 14), false));			//3 4 5   
 	//lights.push_back(new Light(100, glm::vec3(-7, 2, 7)));
 
+	//there is no GL context to back the textures when running headless
+	if (bBenchmark)
+	{
+		image.setUseTexture(false);
+		map.setUseTexture(false);
+		texture.setUseTexture(false);
+	}
+
 	image.allocate(imageW, imageH, ofImageType::OF_IMAGE_COLOR);		//allocates an image with desired dimensions
 	map.allocate(imageW, imageH, ofImageType::OF_IMAGE_COLOR);
 	
@@ -122,6 +130,11 @@ void ofApp::setup() {
 	gui.add(tValue.setup("t", ofVec2f(2, 0.75), ofVec2f(0, 0), ofVec2f(10, 10)));
 	bHide = false;
 
+	if (bBenchmark)
+	{
+		runBenchmark();
+		ofExit(check.passed() ? 0 : 1);
+	}
 }
 
 void ofApp::printChannel()
@@ -168,9 +181,22 @@ void ofApp::update(){
 		{
 			selected[0]->t = ofVec2f(tValue);
 		}
+
+		//a new radius or shape doesn't move the object, so the mesher has to be told
+		if (bRad || bAngle || bTValue) mesher.invalidate(selected[0]);
 	}
-	
 
+	//moved, added and deleted objects are found by the mesher itself
+	if (bMeshPreview)
+	{
+		if (!mesher.isBuilt()) meshScene();
+		else mesher.update(scene, numThreads);
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::exit(){
+	saver.flush();		//make sure the last render is on disk before we quit
 }
 
 // draws a three plane coordinate axis for reference
@@ -193,6 +219,7 @@ bool ofApp::isShadow(const Ray &r)
 {
 	glm::vec3 hp;
 	glm::vec3 nor;
+	rayCount++;
 
 	//loop through all the scene objects and see if any of them block a ray to a light source
 	for (int i = 0; i < scene.size(); i++)
@@ -212,6 +239,7 @@ bool ofApp::isSpotlightShadow(const Ray &r, const Light &l)
 {
 	glm::vec3 hp; 
 	glm::vec3 norm;
+	rayCount++;
 
 	for (int i = 0; i < scene.size(); i++)
 	{
@@ -227,18 +255,55 @@ bool ofApp::isSpotlightShadow(const Ray &r, const Light &l)
 	return false;
 }
 
-bool ofApp::isSpotlightShadowRM(const Ray &r, const Light &l)
+//marches a shadow ray from r.p toward a light maxT away and returns how much
+//of the light gets through, 0 in full shadow up to 1 fully lit
+//the march stops at the light instead of going on to MAX_DISTANCE, so
+//nothing behind the light can shadow it.  a ray that passes within h of a
+//surface t along is partly blocked, the smallest shadowK * h / t on the way
+//gives the penumbra (Quilez), and once that is too dark to show the rest of
+//the march is skipped
+//a pool that is traced as a heightfield either blocks the light or doesn't,
+//it has no penumbra
+float ofApp::shadowMarch(const Ray &r, float maxT)
 {
-	glm::vec3 hp;
-	if (rayMarch(r, hp))
+	float light = 1;
+	float t = 0;
+	int evals = 0, steps = 0;
+	int skip = tracedId();
+	rayCount++;
+
+	if (skip >= 0)
 	{
-		if (inSpotLight(l, hp))
+		float tHit;
+		int traceEvals, traceSteps;
+		bool blocked = heightfield.trace(r, maxT, tHit, traceEvals, traceSteps);
+		sdfCount += traceEvals;
+		stepCount += traceSteps;
+		if (blocked) return 0;
+	}
+
+	while (steps < MAX_RAY_STEPS && t < maxT)
+	{
+		SceneHit closest = sceneQuery(r.p + r.d*t, skip);
+		evals += closest.evals;
+		steps++;
+		if (closest.dist < DIST_THRESHOLD)
 		{
-			return true;
+			light = 0;
+			break;
+		}
+		if (t > 0) light = std::min(light, shadowK * closest.dist / t);
+		if (light < 1 / 255.0f)
+		{
+			light = 0;
+			break;
 		}
+		t += closest.dist;
 	}
 
-	return false;
+	sdfCount += evals;
+	stepCount += steps;
+	return light;
 }
 
 //function that checks to see if a point is within the scope of a spotlight
@@ -336,10 +401,7 @@ ofColor ofApp::allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColo
 			}
 			else
 			{
-				if (isSpotlightShadowRM(r2, *lights[i]))
-				{
-					tempColor = ofColor::black;			//if your in a shadow, then no light is reaching resulting in no color
-				}
+				tempColor *= shadowMarch(r2, glm::distance(r2.p, lights[i]->position));		//only the light that gets past the objects in the way
 			}
 
 		}
@@ -354,11 +416,7 @@ ofColor ofApp::allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColo
 			}
 			else
 			{
-				glm::vec3 hp;
-				if (rayMarch(r2, hp))
-				{
-					tempColor = ofColor::black;			//if your in a shadow, then no light is reaching resulting in no color
-				}
+				tempColor *= shadowMarch(r2, glm::distance(r2.p, lights[i]->position));		//only the light that gets past the objects in the way
 			}
 
 		}		//but of course if a scene has multiple lights and 1 >= more reaches that point, it'll start to show color and the shadow gets dimmer
@@ -381,244 +439,822 @@ ofColor ofApp::lookup(float u, float v)
 	return texture.getColor((int)fmod(i, texture.getWidth()), (int)fmod(j, texture.getHeight()));
 }
 
-// Ray Tracing algorithm to render an image
-// Invoked with the key 't'
-void ofApp::rayTrace()
-{	
-	
-	//for each pixel
-	for (int i = 0; i < imageW; i++)
+//traces the supersamples for pixel (i, j) and returns their average color
+//j counts up from the bottom of the image, the callers flip it into image rows
+ofColor ofApp::tracePixel(int i, int j)
+{
+	ofColor superColor = ofColor::black;
+	for (int p = 0; p < 4; p++)
 	{
-		int row = imageH - 1;
-		for (int j = 0; j < imageH; j++)
-		{		
-			ofColor superColor = ofColor::black;
-			for (int p = 0; p < 4; p++)
+		for (int q = 0; q < 4; q++)
+		{
+			//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
+			float u = (i + ((p + 0.5) / 4)) / imageW;
+			float v = (j + ((q + 0.5) / 4))  / imageH;
+			Ray r = renderCam.getRay(u, v);
+			rayCount++;
+
+			vector<float> distance;			//vector to hold all the distances in of objects from the renderCam
+			bool hit = false;				//boolean to signal an intersect 
+			int index = 0;					//index to scene vector to know what object was intersected
+			vector<glm::vec3> points;
+			vector<glm::vec3> n;
+			//check if the ray intersects with any object in the scene
+			for (int k = 0; k < scene.size(); k++)
 			{
-				for (int q = 0; q < 4; q++)
+				if (scene[k]->intersect(r, hitpoint, normal))
 				{
-					//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
-					float u = (i + ((p + 0.5) / 4)) / imageW;
-					float v = (j + ((q + 0.5) / 4))  / imageH;
-					Ray r = renderCam.getRay(u, v);
-
-					vector<float> distance;			//vector to hold all the distances in of objects from the renderCam
-					bool hit = false;				//boolean to signal an intersect 
-					int index = 0;					//index to scene vector to know what object was intersected
-					vector<glm::vec3> points;
-					vector<glm::vec3> n;
-					//check if the ray intersects with any object in the scene
-					for (int k = 0; k < scene.size(); k++)
-					{
-						if (scene[k]->intersect(r, hitpoint, normal))
-						{
-							//printf("scene index: %d\n", k);
-							hit = true;
-							float dist = glm::length(scene[k]->position - renderCam.position);
-							distance.push_back(dist);
-							index = k;							//set the index to the index in the scene vector
-							points.push_back(hitpoint);
-							n.push_back(normal);
-						}
-						else
-						{
-							distance.push_back(std::numeric_limits<float>::infinity());			//default big distance if nothing was intersected
-																//ensures that distance elements line up with scene elements 
-																//ex) distance[0] refers to distance from scene[0] to renderCam, etc... 
-							points.push_back(glm::vec3(0, 0, 0));
-							n.push_back(glm::vec3(0, 0, 0));
+					//printf("scene index: %d\n", k);
+					hit = true;
+					float dist = glm::length(scene[k]->position - renderCam.position);
+					distance.push_back(dist);
+					index = k;							//set the index to the index in the scene vector
+					points.push_back(hitpoint);
+					n.push_back(normal);
+				}
+				else
+				{
+					distance.push_back(std::numeric_limits<float>::infinity());			//default big distance if nothing was intersected
+														//ensures that distance elements line up with scene elements 
+														//ex) distance[0] refers to distance from scene[0] to renderCam, etc... 
+					points.push_back(glm::vec3(0, 0, 0));
+					n.push_back(glm::vec3(0, 0, 0));
 
-						}
-					}
+				}
+			}
 
-					//setColor follows (i, row, ofColor) format to flip and mirror the rendered image so that it matches 
-					//what is expected to be seen as viewed from the view plane
-					if (hit)
+			//setColor follows (i, row, ofColor) format to flip and mirror the rendered image so that it matches 
+			//what is expected to be seen as viewed from the view plane
+			if (hit)
+			{
+
+				if (distance.size() == 1)
+				{
+					//first element is the plane so use the texture map
+					if (index == 0)
 					{
+						//get the coordinates of the hitpoint
+						float x = hitpoint.x + (pWidth / 2);
+						float z = hitpoint.z + (pHeight / 2);
+						//convert hitpoint coordinates to uv coordinates
+						float uu = (x + .5) / pWidth;
+						float vv = (z + .5) / pHeight;
+						ofColor fc = allShader(hitpoint, normal, lookup(uu*squares, vv*squares), scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, fc);
+						superColor += fc/4;			//prevents adding too much color since were getting more color samples per pixel
+					}
+					else
+					{
+						ofColor objColor = allShader(hitpoint, normal, scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, objColor);
+						superColor += objColor/4;	//denominator should match the pq loop variant 
+					}
 
-						if (distance.size() == 1)
+				}
+				else
+				{
+					//finds the closest object in the scene to the renderCam
+					float c = std::numeric_limits<float>::infinity();		//the shortest distance to the renderCam
+					for (int a = 0; a < distance.size(); a++)
+					{
+						//sets the closest object to the renderCam
+						if (distance[a] < c)
 						{
-							//first element is the plane so use the texture map
-							if (index == 0)
-							{
-								//get the coordinates of the hitpoint
-								float x = hitpoint.x + (pWidth / 2);
-								float z = hitpoint.z + (pHeight / 2);
-								//convert hitpoint coordinates to uv coordinates
-								float uu = (x + .5) / pWidth;
-								float vv = (z + .5) / pHeight;
-								ofColor fc = allShader(hitpoint, normal, lookup(uu*squares, vv*squares), scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, fc);
-								superColor += fc/4;			//prevents adding too much color since were getting more color samples per pixel
-							}
-							else
-							{
-								ofColor objColor = allShader(hitpoint, normal, scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, objColor);
-								superColor += objColor/4;	//denominator should match the pq loop variant 
-							}
+							//updates the closest distance and the index of that object in the scene vector
+							c = distance[a];
+							index = a;
+							//cout << c << " " << index << endl;
 
 						}
-						else
-						{
-							//finds the closest object in the scene to the renderCam
-							float c = std::numeric_limits<float>::infinity();		//the shortest distance to the renderCam
-							for (int a = 0; a < distance.size(); a++)
-							{
-								//sets the closest object to the renderCam
-								if (distance[a] < c)
-								{
-									//updates the closest distance and the index of that object in the scene vector
-									c = distance[a];
-									index = a;
-									//cout << c << " " << index << endl;
-
-								}
-							}
-
-							//ofColor col = lambert(points[index], n[index], scene[index]->diffuseColor) + //ambient +
-							//	phong(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power);
-							//image.setColor(i, row, putShadow(points[index], col));	//set color of pixel to value computed from hit point
-							//first element is the plane so use the texture map
-							if (index == 0)
-							{
-								//gets the coordinates of the closest object 
-								float x = points[index].x + (pWidth / 2);
-								float z = points[index].z + (pHeight / 2);
-								//convert those coordinates to uv coordinates
-								float uu = (x + .5) / pWidth;
-								float vv = (z + .5) / pHeight;
-								ofColor fc = allShader(points[index], n[index], lookup(uu*squares, v*squares), scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, fc);
-								superColor += fc/4;
-							}
-							else
-							{
-								ofColor objColor = allShader(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
-								//image.setColor(i, row, objColor);
-								superColor += objColor/4;
-							}
-
+					}
 
-						}
+					//ofColor col = lambert(points[index], n[index], scene[index]->diffuseColor) + //ambient +
+					//	phong(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power);
+					//image.setColor(i, row, putShadow(points[index], col));	//set color of pixel to value computed from hit point
+					//first element is the plane so use the texture map
+					if (index == 0)
+					{
+						//gets the coordinates of the closest object 
+						float x = points[index].x + (pWidth / 2);
+						float z = points[index].z + (pHeight / 2);
+						//convert those coordinates to uv coordinates
+						float uu = (x + .5) / pWidth;
+						float vv = (z + .5) / pHeight;
+						ofColor fc = allShader(points[index], n[index], lookup(uu*squares, v*squares), scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, fc);
+						superColor += fc/4;
 					}
 					else
 					{
-						//image.setColor(i, row, ofColor::black);			//set the background color to black
-						//image.setColor(i, row, ambient);				//set the background color to the ambient color
-						superColor += ofColor::black;
+						ofColor objColor = allShader(points[index], n[index], scene[index]->diffuseColor, scene[index]->specularColor, power, scene[index]) + ambient;
+						//image.setColor(i, row, objColor);
+						superColor += objColor/4;
 					}
-					//row--;
+
+
 				}
 			}
-			image.setColor(i, row, superColor);	//we are outside the pq loop, so we can now set the image pixel
+			else
+			{
+				//image.setColor(i, row, ofColor::black);			//set the background color to black
+				//image.setColor(i, row, ambient);				//set the background color to the ambient color
+				superColor += ofColor::black;
+			}
+			//row--;
+		}
+	}
+	return superColor;
+}
+
+// Ray Tracing algorithm to render an image
+// Invoked with the key 't'
+void ofApp::rayTrace()
+{	
+	
+	//for each pixel
+	for (int i = 0; i < imageW; i++)
+	{
+		int row = imageH - 1;
+		for (int j = 0; j < imageH; j++)
+		{		
+			image.setColor(i, row, tracePixel(i, j));	//we are outside the pq loop, so we can now set the image pixel
 			row--;
 			
 		}
 		
 	}
 	
-	image.save("traceImage.PNG");	//put result into an image
+	saver.save(image.getPixels(), "traceImage.PNG");	//put result into an image
 }
 
-//returns the normal from a given point for any object using distances
-glm::vec3 ofApp::getNormalRM(const glm::vec3 &p)
+//the normal at p, the gradient of the scene sdf there
+//id is the object closest to p if the caller knows it (the one a ray hit),
+//otherwise it's looked up.  objects that can evaluate their sdf over Duals
+//give the gradient in one pass, for everything else it comes from finite
+//differences eps apart over the whole scene (marchPixel() widens eps with distance)
+glm::vec3 ofApp::getNormalRM(const glm::vec3 &p, float eps, int id)
 {
-	float eps = 0.01;
-	float dp = sceneSDF(p);
-	glm::vec3 n(dp - sceneSDF(glm::vec3(p.x-eps, p.y, p.z)), 
-				dp - sceneSDF(glm::vec3(p.x, p.y-eps, p.z)),
-				dp - sceneSDF(glm::vec3(p.x, p.y, p.z-eps)));
+	if (bDualNormals)
+	{
+		if (id < 0)
+		{
+			SceneHit closest = sceneQuery(p);
+			sdfCount += closest.evals;
+			id = closest.id;
+		}
+		Dual dist;
+		if (id >= 0 && scene[id]->sdfDual(Dual3::point(p), dist) && glm::length(dist.d) > 0)
+		{
+			sdfCount++;
+			return glm::normalize(dist.d);
+		}
+	}
+
+	SceneHit dp = sceneQuery(p);
+	SceneHit dx = sceneQuery(glm::vec3(p.x-eps, p.y, p.z));
+	SceneHit dy = sceneQuery(glm::vec3(p.x, p.y-eps, p.z));
+	SceneHit dz = sceneQuery(glm::vec3(p.x, p.y, p.z-eps));
+	sdfCount += dp.evals + dx.evals + dy.evals + dz.evals;
+	glm::vec3 n(dp.dist - dx.dist, 
+				dp.dist - dy.dist,
+				dp.dist - dz.dist);
 	return glm::normalize(n); 
 }
 
-//returns the closest distance to the scene
-float ofApp::sceneSDF(const glm::vec3 &p)
+//returns the distance to the closest object in the scene and which object it is
+//this only reads the scene, so the render threads can all call it at once
+//
+//the object with the nearest bound is evaluated first, after that any object
+//whose bound is already further than the best distance so far can't win and
+//its full sdf is skipped, so only the objects near p cost anything
+//scene[skip] is left out, for the object that is traced rather than marched
+SceneHit ofApp::sceneQuery(const glm::vec3 &p, int skip) const
 {
-	float closestDist = std::numeric_limits<float>::infinity();
+	SceneHit closest = { std::numeric_limits<float>::infinity(), -1, 0 };
+
+	int nearest = -1;
+	float nearestBound = std::numeric_limits<float>::infinity();
+	for (int i = 0; i < scene.size(); i++)
+	{
+		if (i == skip) continue;
+		float bound = scene[i]->sdfBound(p);
+		if (bound < nearestBound || nearest < 0)
+		{
+			nearestBound = bound;
+			nearest = i;
+		}
+	}
+	if (nearest < 0) return closest;
+	closest.dist = objectSDF(nearest, p);
+	closest.id = nearest;
+	closest.evals = 1;
+
 	for (int i = 0; i < scene.size(); i++)
 	{
-		float dist = scene[i]->sdf(p);
+		if (i == nearest || i == skip || scene[i]->sdfBound(p) >= closest.dist) continue;
+
+		float dist = objectSDF(i, p);
+		closest.evals++;
 		//cout << "dist: " << dist << endl;
-		if (dist < closestDist)
+		if (dist < closest.dist)
 		{
-			closestDist = dist;
-			sceneIdx = i;
+			closest.dist = dist;
+			closest.id = i;
 		}
 	}
 
-	return closestDist;
+	return closest;
+}
+
+//sdf of scene[i], from the baked bricks if it's the object that was baked
+//
+//with bLipschitz it's divided by the object's lipschitz(), which makes it a
+//distance the march can step without going through the surface.  sdfBound()
+//is never more than the distance either, and where it's bigger (far above
+//the pool, where the division would make the steps needlessly short) it's
+//the better step
+float ofApp::objectSDF(int i, const glm::vec3 &p) const
+{
+	float dist = (bBake && bake.object() == scene[i]) ? bake.sdf(p) : scene[i]->sdf(p);
+	if (bLipschitz) dist = std::max(dist / scene[i]->lipschitz(), scene[i]->sdfBound(p));
+	return dist;
+}
+
+//bakes scene[bakeId] over bakeMin - bakeMax into bricks, far from the surface
+//the march then steps by lookups into those instead of the 8 octaves of noise
+void ofApp::bakeScene()
+{
+	if (bakeId < 0 || bakeId >= scene.size()) return;
+	bake.bake(scene[bakeId], bakeMin, bakeMax, bakeVoxel, 8, numThreads);
+	cout << bake.report() << endl;
+}
+
+//bakes the max mip of scene[bakeId] over heightfieldMin - heightfieldMax in x
+//and z, from then on primary and shadow rays trace it as a heightfield instead
+//of marching its sdf (see tracedId()).  only a WaterPool can be traced
+void ofApp::bakeHeightfield()
+{
+	if (bakeId < 0 || bakeId >= scene.size()) return;
+	WaterPool *pool = dynamic_cast<WaterPool *>(scene[bakeId]);
+	if (!pool) return;
+	heightfield.bake(pool, heightfieldMin, heightfieldMax, heightfieldCell, numThreads);
+	cout << heightfield.report() << endl;
+}
+
+//meshes the whole scene over meshMin - meshMax for the viewport, after this
+//update() only remeshes the chunks of the objects that change
+void ofApp::meshScene()
+{
+	mesher.build(scene, meshMin, meshMax, meshCell, numThreads);
+	cout << mesher.report() << endl;
+}
+
+//the object the heightfield is traced for, which the scene queries of the
+//march leave out, -1 if there is none
+int ofApp::tracedId() const
+{
+	if (bHeightfield && bakeId >= 0 && bakeId < scene.size() && heightfield.object() && heightfield.object() == scene[bakeId]) return bakeId;
+	return -1;
+}
+
+//returns the closest distance to the scene
+float ofApp::sceneSDF(const glm::vec3 &p) const
+{
+	return sceneQuery(p).dist;
 }
 
 //this utilizes the ray marching algorithm to be used instead of the standard ray intersect method used prior
 //ray marches across the ray to determine if an object is hit or not
-bool ofApp::rayMarch(Ray r, glm::vec3 &p)
+//id is set to the index of the object that was hit, tStart is how far along r
+//the march starts (nothing may be closer than that, see coneMarch())
+//cost, if given, gets the steps and sdf evaluations the march took and how it ended
+//
+//a hit is closer than DIST_THRESHOLD, or for primary rays closer than the
+//ray's share of its pixel at that distance, footprint * t (see pixelFootprint()),
+//whichever is bigger.  far away a pixel covers more than DIST_THRESHOLD and
+//the steps to get any closer than that can't show up in the image
+//
+//with relaxation above 1 each step is relaxation * dist (over-relaxed sphere
+//tracing, Keinert et al. 2014).  the sphere of radius dist around a point is
+//empty, so as long as the spheres around two points in a row overlap nothing
+//was skipped between them.  when they stop overlapping the step went too far:
+//the ray goes back to the last safe point, takes the plain step from there and
+//stays with plain steps for the rest of the ray
+//
+//the object in tracedId() isn't marched, marchPixel() traces it separately
+bool ofApp::rayMarch(const Ray &r, glm::vec3 &p, int &id, float tStart, float footprint, MarchCost *cost)
 {
 	bool hit = false;
-	p = r.p;
+	bool escaped = false;
+	int evals = 0;
+	int steps = 0;
+	int skip = tracedId();
+	float omega = relaxation;
+	float step = 0;					//length of the last step taken
+	float prevDist = 0;				//distance at the point the last step started from
+	float t = tStart;
+	rayCount++;
+	p = r.p + r.d*tStart;
 	for (int i = 0; i < MAX_RAY_STEPS; i++)
 	{
 		//cout << "p: " << p << endl;
-		float dist = sceneSDF(p);
+		SceneHit closest = sceneQuery(p, skip);
+		float dist = closest.dist;
+		evals += closest.evals;
+		steps++;
+		if (omega > 1 && fabs(dist) + prevDist < step)
+		{
+			//the spheres don't overlap, back up and take the safe step
+			p += r.d*(prevDist - step);
+			t += prevDist - step;
+			step = prevDist;
+			omega = 1;
+			continue;
+		}
 		//cout << "distance: " << dist << endl;
-		if (dist < DIST_THRESHOLD)			//hit falls under the required threshold to quantify as a hit
+		if (dist < std::max(DIST_THRESHOLD, footprint*t))			//hit falls under the required threshold to quantify as a hit
 		{
 			//cout << "hit" << endl;
 			hit = true;
+			id = closest.id;
 			break;
 		}
 		else if (dist > MAX_DISTANCE)		//hit is too far away from target, so it's considered a miss
 		{
 			//cout << "off target" << endl;
+			escaped = true;
 			break;
 		}
 		else
 		{
 			//cout << "marching" << endl;
-			p += r.d*dist;					//march along the ray
+			step = dist*omega;
+			prevDist = dist;
+			p += r.d*step;					//march along the ray
+			t += step;
 		}
 	}
 
+	sdfCount += evals;		//added once per ray since every thread shares the counter
+	stepCount += steps;
+	if (cost)
+	{
+		cost->steps = steps;
+		cost->evals = evals;
+		cost->end = hit ? MarchCost::HIT : escaped ? MarchCost::ESCAPED : MarchCost::OUT_OF_STEPS;
+	}
 	return hit;		
 }
 
+//the angle (radius) each primary ray covers, so at distance t along the ray
+//it stands for a disc of radius pixelFootprint() * t.  the render camera looks
+//straight down z at the view plane
+float ofApp::pixelFootprint()
+{
+	float focal = fabs(renderCam.view.position.z - renderCam.position.z);
+	float pixel = std::max(renderCam.view.width() / imageW, renderCam.view.height() / imageH);
+	return 0.5f * pixel / focal;
+}
+
+//ray marches pixel (i, j) and returns its color
+//j counts up from the bottom of the image, the callers flip it into image rows
+//the rays start tStart from the camera, and what they cost is added to cost
+ofColor ofApp::marchPixel(int i, int j, float tStart, MarchCost *cost)
+{
+	ofColor superColor = ofColor::black;
+	float footprint = pixelFootprint();
+	
+	//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
+	float u = (i + 0.5) / imageW;
+	float v = (j + 0.5) / imageH;
+	Ray r = renderCam.getRay(u, v);
+
+	bool hit = false;
+	glm::vec3 pointOfIntersect;
+	int id = 0;
+	MarchCost rayCost;
+	hit = rayMarch(r, pointOfIntersect, id, tStart, footprint, &rayCost);
+
+	//the pool traced as a heightfield, from the camera since the cones didn't
+	//see it, and only up to whatever the march hit
+	int traced = tracedId();
+	if (traced >= 0)
+	{
+		float tPool;
+		int evals, steps;
+		if (heightfield.trace(r, hit ? glm::distance(pointOfIntersect, r.p) : heightfieldFar, tPool, evals, steps))
+		{
+			hit = true;
+			id = traced;
+			pointOfIntersect = r.evalPoint(tPool);
+			rayCost.end = MarchCost::HIT;
+		}
+		rayCost.evals += evals;
+		rayCost.steps += steps;
+		sdfCount += evals;
+		stepCount += steps;
+	}
+	if (cost) cost->add(rayCost);
+	if (bRecording) reprojection.record(i, j, hit, pointOfIntersect, hit ? scene[id] : nullptr);
+	if (hit)
+	{
+		//cout << "hit" << endl;
+		glm::vec3 norm = getNormalRM(pointOfIntersect, std::max(0.01f, footprint * glm::distance(pointOfIntersect, r.p)), id);
+		ofColor objColor = allShader(pointOfIntersect, norm, scene[id]->diffuseColor, scene[id]->specularColor, power, scene[id]);
+		superColor += objColor*2;
+	}
+	else
+	{
+		superColor += ofColor::black;
+	}
+	return superColor;
+}
+
+//renders the size x size block of pixels at (x0, y0), clipped to the image.
+//with bCones a cone around all of the block's rays is marched first, nothing is
+//inside it up to where it got, so the four quarter blocks (8x8, 4x4, 2x2) and
+//in the end the pixels carry on from there instead of from the camera
+void ofApp::marchBlock(int x0, int y0, int size, float tStart)
+{
+	if (x0 >= imageW || y0 >= imageH) return;
+	if (size == 1)
+	{
+		if (bReusing) tStart = reuseStart(x0, y0, tStart);
+		image.setColor(x0, imageH - 1 - y0, marchPixel(x0, y0, tStart, bHeatmap ? &marchCost.at(x0, imageH - 1 - y0) : nullptr));
+		return;
+	}
+
+	if (bCones) tStart = coneMarch(x0, y0, size, tStart);
+	int half = size / 2;
+	marchBlock(x0, y0, half, tStart);
+	marchBlock(x0 + half, y0, half, tStart);
+	marchBlock(x0, y0 + half, half, tStart);
+	marchBlock(x0 + half, y0 + half, half, tStart);
+}
+
+//marches a cone from the camera that holds every ray through the size x size
+//pixel block at (x0, y0), starting tStart along its axis.  returns how far the
+//rays of the block can start, the cone is empty (and further from every surface
+//than a ray's hit threshold, see rayMarch()) up to there
+//
+//t along the axis the cone is a disc of radius t * tan.  everything within dist
+//of the axis point is empty, and the cone between t and t + h lies within
+//h + (t + h) * tan of it, so the axis can move on h = (dist - t * tan) / (1 + tan),
+//less the hit threshold (which grows by footprint per unit of t as well).
+//a ray of the block is never further along the axis than it is along itself,
+//so the first t of every ray is inside what the cone covered
+float ofApp::coneMarch(int x0, int y0, int size, float tStart)
+{
+	int x1 = std::min(x0 + size, imageW);
+	int y1 = std::min(y0 + size, imageH);
+	Ray axis = renderCam.getRay((x0 + x1) * 0.5f / imageW, (y0 + y1) * 0.5f / imageH);
+
+	//the view plane is flat, so the widest ray is through one of the corners
+	float cosMin = 1;
+	for (int c = 0; c < 4; c++)
+	{
+		Ray corner = renderCam.getRay((float)((c & 1) ? x1 : x0) / imageW, (float)((c & 2) ? y1 : y0) / imageH);
+		cosMin = std::min(cosMin, glm::dot(corner.d, axis.d));
+	}
+	float tanA = sqrt(std::max(1 - cosMin * cosMin, 0.0f)) / cosMin;
+	float footprint = pixelFootprint();
+
+	float t = tStart;
+	int evals = 0;
+	int steps = 0;
+	int skip = tracedId();
+	for (int i = 0; i < MAX_RAY_STEPS; i++)
+	{
+		SceneHit closest = sceneQuery(axis.p + axis.d*t, skip);
+		evals += closest.evals;
+		steps++;
+		float h = (closest.dist - std::max(DIST_THRESHOLD, footprint*t) - t*tanA) / (1 + tanA + footprint);
+		if (h < DIST_THRESHOLD || closest.dist > MAX_DISTANCE) break;		//the cone is about to touch something, or left the scene
+		t += h;
+	}
+
+	sdfCount += evals;
+	stepCount += steps;
+	return t;
+}
+
+//where the ray of pixel (i, j) can start in a frame of an animation: where
+//the last frame's hits reprojected to (see DepthReprojection), unless that is
+//inside something, then tStart from the cones
+float ofApp::reuseStart(int i, int j, float tStart)
+{
+	float t = reprojection.start(i, j);
+	if (t <= tStart) return tStart;
+	Ray r = renderCam.getRay((i + 0.5) / imageW, (j + 0.5) / imageH);
+	SceneHit at = sceneQuery(r.p + r.d*t, tracedId());
+	sdfCount += at.evals;
+	return (at.dist < 0) ? tStart : t;
+}
+
 //this renders images as an output, based on the rayTrace(), but with some changes to it
 void ofApp::rayMarch()
 {
-	//for each pixel, just like ray tracing
-	for (int i = 0; i < imageW; i++)
+	marchFrame();
+	saver.save(image.getPixels(), "heightfield.PNG");
+	if (bHeatmap) marchCost.save(saver, "march", MAX_RAY_STEPS);
+}
+
+//marches every pixel of image, without saving it
+void ofApp::marchFrame()
+{
+	if (bBake && bakeId < scene.size() && !bake.isBaked(scene[bakeId])) bakeScene();		//first render, or the object moved
+	if (bHeightfield && bakeId < scene.size() && !heightfield.isBaked(dynamic_cast<WaterPool *>(scene[bakeId]))) bakeHeightfield();
+	if (bHeatmap) marchCost.allocate(imageW, imageH);
+
+	//for each pixel, just like ray tracing, but split into tiles that are
+	//rendered on every core.  each pixel only reads the scene so the threads
+	//don't need to coordinate beyond handing out the tiles
+	//the tiles are split further into 8x8 blocks for the cone pre-pass, 32 is
+	//a multiple of 8 so no block straddles two tiles
+	parallelTiles(imageW, imageH, 32, numThreads, [this](int x0, int y0, int x1, int y1)
 	{
-		int row = imageH - 1;
-		for (int j = 0; j < imageH; j++)
+		for (int i = x0; i < x1; i += 8)
 		{
-			ofColor superColor = ofColor::black;
-			
-					//compute viewing ray, taking into cosideration that we are getting more than one point per pixel
-					float u = (i + 0.5) / imageW;
-					float v = (j + 0.5) / imageH;
-					Ray r = renderCam.getRay(u, v);
-
-					bool hit = false;
-					glm::vec3 pointOfIntersect;
-					hit = rayMarch(r, pointOfIntersect);
-					if (hit)
-					{
-						//cout << "hit" << endl;
-						glm::vec3 norm = getNormalRM(pointOfIntersect);
-						ofColor objColor = allShader(pointOfIntersect, norm, scene[sceneIdx]->diffuseColor, scene[sceneIdx]->specularColor, power, scene[sceneIdx]);
-						superColor += objColor*2;
-					}
-					else
-					{
-						superColor += ofColor::black;
-					}
-
-			image.setColor(i, row, superColor);
-			row--;
+			for (int j = y0; j < y1; j += 8)
+			{
+				marchBlock(i, j, 8, 0);
+			}
 		}
+	});
+}
+
+//renders animFrames frames of the camera moving by animDolly and the objects
+//going around animCenter by animTurn degrees (they don't spin, so their
+//hits can be carried over) into frame0000.PNG on.  with bReuse every frame
+//after the first starts its rays from the last one's hits.  the camera and
+//the objects are put back where they were at the end
+void ofApp::renderAnimation(bool save)
+{
+	glm::vec3 camera = renderCam.position;
+	ViewPlane view = renderCam.view;
+	vector<glm::vec3> positions;
+	for (int i = 0; i < scene.size(); i++) positions.push_back(scene[i]->position);
+
+	reprojection.clear();
+	for (int f = 0; f < animFrames; f++)
+	{
+		if (f > 0) advanceFrame();
+		bReusing = bReuse && reprojection.reproject(renderCam, pixelFootprint(), scene);
+		bRecording = bReuse;
+		if (bRecording) reprojection.beginFrame(imageW, imageH);
+		marchFrame();
+		if (bRecording) reprojection.endFrame(renderCam, pixelFootprint(), scene);
+		if (save) saver.save(image.getPixels(), "frame" + ofToString(f, 4, '0') + ".PNG");
 	}
+	bReusing = false;
+	bRecording = false;
+
+	renderCam.position = camera;
+	renderCam.view = view;
+	for (int i = 0; i < scene.size(); i++) scene[i]->position = positions[i];
+}
+
+//moves the render camera (and its view plane with it) and the objects on by
+//one frame of the animation
+void ofApp::advanceFrame()
+{
+	renderCam.position += animDolly;
+	renderCam.view.position += animDolly;
+	renderCam.view.min += glm::vec2(animDolly.x, animDolly.y);
+	renderCam.view.max += glm::vec2(animDolly.x, animDolly.y);
 
-	image.save("heightfield.PNG");
+	float c = cos(glm::radians(animTurn)), s = sin(glm::radians(animTurn));
+	for (int i = 0; i < scene.size(); i++)
+	{
+		glm::vec3 p = scene[i]->position - animCenter;
+		scene[i]->position = animCenter + glm::vec3(c*p.x + s*p.z, p.y, -s*p.x + c*p.z);
+	}
+}
+
+//renders the canonical heightfield scene from setup() and times the sdf kernels
+//on a fixed set of points, then appends the results to benchmark.json
+//with --check the renders are also compared against the golden images and
+//timings in bin/data/golden/ (see regression.h)
+//started with the --benchmark flag (see main.cpp)
+void ofApp::runBenchmark()
+{
+	Benchmark bench("Waterpool");
+
+	//full render of the fbm heightfield
+	bTrace = false;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double marchTime = bench.stop();
+	bench.add("rayMarch", marchTime, { {"rays", (double)rayCount}, {"sdf_evals", (double)sdfCount}, {"steps", (double)stepCount}, {"omega", relaxation}, {"cones", (double)bCones}, {"pixels", (double)imageW * imageH} });
+	check.image("rayMarch", image.getPixels());
+	check.time("rayMarch", marchTime);
+
+	//the same render over-relaxed, to see how many march steps that saves
+	//(with --relax the first render was already relaxed and this one is plain)
+	uint64_t steps = stepCount;
+	float w = relaxation;
+	relaxation = (w > 1) ? 1 : 1.6;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double relaxedTime = bench.stop();
+	bench.add(w > 1 ? "rayMarch plain" : "rayMarch relaxed", relaxedTime, { {"omega", relaxation}, {"steps", (double)stepCount}, {"steps_saved", (double)steps - (double)stepCount}, {"sdf_evals", (double)sdfCount} });
+	relaxation = w;
+
+	//and without the cone pre-pass (or with it, if --no-cones turned it off)
+	bCones = !bCones;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double conesTime = bench.stop();
+	bench.add(bCones ? "rayMarch cones" : "rayMarch no cones", conesTime, { {"steps", (double)stepCount}, {"sdf_evals", (double)sdfCount} });
+	bCones = !bCones;
+
+	//and with steps divided by the lipschitz bound (or without, with --lipschitz),
+	//safe steps are shorter so this is mostly what they cost
+	bLipschitz = !bLipschitz;
+	rayCount = 0;
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double lipschitzTime = bench.stop();
+	bench.add(bLipschitz ? "rayMarch lipschitz" : "rayMarch unscaled", lipschitzTime, { {"steps", (double)stepCount}, {"sdf_evals", (double)sdfCount}, {"lipschitz", scene[0]->lipschitz()} });
+	bLipschitz = !bLipschitz;
+
+	//exact against baked: what the bake costs, what it saves a render and so
+	//after how many renders of the same pool it has paid for itself
+	bool baked = bBake;
+	bool traced = bHeightfield;
+	bBake = false;
+	bHeightfield = false;
+	sdfCount = 0;
+	bench.start();
+	rayMarch();
+	double exactTime = bench.stop();
+	uint64_t exactEvals = sdfCount;
+	ofPixels exact = image.getPixels();
+
+	bBake = true;
+	bake.clear();
+	bakeScene();
+	bench.add("bake", bake.bakeSeconds(), { {"bricks", (double)bake.brickCount()}, {"cells", (double)bake.cellCount()}, {"megabytes", bake.bytes() / (1024.0 * 1024.0)}, {"voxel", bakeVoxel} });
+	sdfCount = 0;
+	bench.start();
+	rayMarch();
+	double bakedTime = bench.stop();
+	auto changedPixels = [&]() {
+		int changed = 0;
+		for (int y = 0; y < imageH; y++)
+		{
+			for (int x = 0; x < imageW; x++)
+			{
+				ofColor a = exact.getColor(x, y), b = image.getPixels().getColor(x, y);
+				if (abs(a.r - b.r) > 8 || abs(a.g - b.g) > 8 || abs(a.b - b.b) > 8) changed++;
+			}
+		}
+		return changed;
+	};
+	bench.add("rayMarch baked", bakedTime, { {"sdf_evals", (double)sdfCount}, {"exact_seconds", exactTime}, {"exact_sdf_evals", (double)exactEvals}, {"pixels_changed", (double)changedPixels()} });
+
+	cout << "bake " << bake.bakeSeconds() << " s, render " << exactTime << " s exact and " << bakedTime << " s baked";
+	if (bakedTime < exactTime) cout << ", the bake pays for itself after " << ceil(bake.bakeSeconds() / (exactTime - bakedTime)) << " renders" << endl;
+	else cout << ", the bake never pays for itself" << endl;
+
+	//marched against traced as a heightfield.  the pixels that change are
+	//mostly ones the march missed or stopped short of the surface on
+	bBake = false;
+	bHeightfield = true;
+	heightfield.clear();
+	bakeHeightfield();
+	bench.add("heightfield bake", heightfield.bakeSeconds(), { {"levels", (double)heightfield.levelCount()}, {"megabytes", heightfield.bytes() / (1024.0 * 1024.0)}, {"cell", heightfieldCell}, {"slope", heightfield.lipschitz()} });
+	sdfCount = 0;
+	stepCount = 0;
+	bench.start();
+	rayMarch();
+	double tracedTime = bench.stop();
+	bench.add("rayMarch heightfield", tracedTime, { {"sdf_evals", (double)sdfCount}, {"steps", (double)stepCount}, {"exact_seconds", exactTime}, {"exact_sdf_evals", (double)exactEvals}, {"pixels_changed", (double)changedPixels()} });
+	cout << "heightfield bake " << heightfield.bakeSeconds() << " s, render " << exactTime << " s marched and " << tracedTime << " s traced" << endl;
+	bBake = baked;
+	bHeightfield = traced;
+
+	//the viewport mesh: all of it, then the chunks a sphere dropped into the
+	//pool, moved along it and deleted again cost to remesh
+	mesher.clear();
+	meshScene();
+	double buildTime = mesher.buildSeconds();
+	bench.add("mesh build", buildTime, { {"chunks", (double)mesher.chunkCount()}, {"vertices", (double)mesher.vertexCount()}, {"triangles", (double)mesher.triangleCount()}, {"cell", meshCell} });
+	Sphere *drop = new Sphere(glm::vec3(0, -2, -5), 1.5, ofColor::red);
+	double updateTime = 0;
+	int rebuilt = 0;
+	auto remesh = [&]() {
+		rebuilt += mesher.update(scene, numThreads);
+		updateTime += mesher.buildSeconds();
+	};
+	scene.push_back(drop);
+	remesh();
+	drop->position += glm::vec3(3, 0, 0);
+	remesh();
+	scene.pop_back();
+	remesh();
+	delete drop;
+	bench.add("mesh update", updateTime, { {"updates", 3}, {"chunks_rebuilt", (double)rebuilt}, {"chunks", (double)mesher.chunkCount()}, {"triangles", (double)mesher.triangleCount()} });
+	cout << "mesh build " << buildTime << " s, 3 updates " << updateTime << " s for " << rebuilt << " of " << mesher.chunkCount() << " chunks" << endl;
+
+	//a short flythrough with a sphere going around the pool, every frame
+	//marched from the camera and then from where the last frame's hits
+	//reproject to.  pixels_changed counts the pixels the reuse got different
+	int frames = animFrames;
+	glm::vec3 dolly = animDolly;
+	float turn = animTurn;
+	bool reuse = bReuse;
+	glm::vec3 camera = renderCam.position;
+	ViewPlane view = renderCam.view;
+	animFrames = 8;
+	animDolly = glm::vec3(0, 0, -0.1);
+	animTurn = 2;
+	Sphere *orbit = new Sphere(glm::vec3(3, 0, -5), 1, ofColor::red);
+	scene.push_back(orbit);
+	vector<ofPixels> fresh;
+	double animTime[2];
+	uint64_t animSteps[2], animEvals[2];
+	int reusedPixels = 0;
+	int wrongPixels = 0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		//one frame at a time so the frames can be compared, renderAnimation()
+		//only keeps the last one
+		bReuse = (pass == 1);
+		reprojection.clear();
+		sdfCount = 0;
+		stepCount = 0;
+		bench.start();
+		for (int f = 0; f < animFrames; f++)
+		{
+			if (f > 0) advanceFrame();
+			bReusing = bReuse && reprojection.reproject(renderCam, pixelFootprint(), scene);
+			if (bReusing) reusedPixels += reprojection.reusedPixels();
+			bRecording = bReuse;
+			if (bRecording) reprojection.beginFrame(imageW, imageH);
+			marchFrame();
+			if (bRecording) reprojection.endFrame(renderCam, pixelFootprint(), scene);
+			if (pass == 0) fresh.push_back(image.getPixels());
+			else
+			{
+				exact = fresh[f];
+				wrongPixels += changedPixels();
+			}
+		}
+		animTime[pass] = bench.stop();
+		animSteps[pass] = stepCount;
+		animEvals[pass] = sdfCount;
+		bReusing = bRecording = false;
+		renderCam.position = camera;
+		renderCam.view = view;
+		orbit->position = glm::vec3(3, 0, -5);
+	}
+	bench.add("animation", animTime[0], { {"frames", (double)animFrames}, {"steps", (double)animSteps[0]}, {"sdf_evals", (double)animEvals[0]} });
+	bench.add("animation reuse", animTime[1], { {"frames", (double)animFrames}, {"steps", (double)animSteps[1]}, {"sdf_evals", (double)animEvals[1]},
+		{"steps_saved", (double)animSteps[0] - (double)animSteps[1]}, {"reused_pixels", (double)reusedPixels}, {"pixels_changed", (double)wrongPixels} });
+	cout << "animation " << animTime[0] << " s marched from the camera, " << animTime[1] << " s reusing " << reusedPixels << " pixels, " << wrongPixels << " pixels changed" << endl;
+	scene.pop_back();
+	delete orbit;
+	animFrames = frames;
+	animDolly = dolly;
+	animTurn = turn;
+	bReuse = reuse;
+	reprojection.clear();
+
+	//kernels, sampled in a box around the surface of the pool
+	vector<glm::vec3> points = Benchmark::samplePoints(4096, glm::vec3(-10, -4, -15), glm::vec3(10, 2, 5));
+	SceneObject *pool = scene[0];
+	bench.micro("WaterPool::sdf", 200000, [&](int i) { return pool->sdf(points[i % points.size()]); });
+	bench.micro("WaterPool::sdf8", 25000, [&](int i) {
+		alignas(32) float x[8], y[8], z[8], dist[8];
+		for (int k = 0; k < 8; k++)
+		{
+			const glm::vec3 &p = points[(i * 8 + k) % points.size()];
+			x[k] = p.x;
+			y[k] = p.y;
+			z[k] = p.z;
+		}
+		pool->sdf8(x, y, z, dist);
+		return dist[0];
+	});
+	bench.micro(bDualNormals ? "getNormalRM" : "getNormalRM finite differences", 50000, [&](int i) { return getNormalRM(points[i % points.size()]).x; });
+	bDualNormals = !bDualNormals;
+	bench.micro(bDualNormals ? "getNormalRM" : "getNormalRM finite differences", 50000, [&](int i) { return getNormalRM(points[i % points.size()]).x; });
+	bDualNormals = !bDualNormals;
+
+	bench.print();
+	bench.save("benchmark.json");
 }
 
 //--------------------------------------------------------------
@@ -650,12 +1286,20 @@ void ofApp::draw(){
 	}
 
 	
-	//draws the objects in the scene
-	for (int i = 0; i < scene.size(); i++)
+	//draws the objects in the scene, or what the renders will show of them
+	if (bMeshPreview)
 	{
-		ofColor ballColor = scene[i]->diffuseColor;
-		ofSetColor(ballColor);
-		scene[i]->draw();
+		ofSetColor(ofColor::white);
+		mesher.draw();
+	}
+	else
+	{
+		for (int i = 0; i < scene.size(); i++)
+		{
+			ofColor ballColor = scene[i]->diffuseColor;
+			ofSetColor(ballColor);
+			scene[i]->draw();
+		}
 	}
 
 	theCam->end();
@@ -723,6 +1367,13 @@ void ofApp::keyPressed(int key){
 		break;
 	case 'm':
 		bTrace = false;
+		if (bAnimate && animFrames > 0)
+		{
+			printf("rendering %d frames...\n", animFrames);
+			renderAnimation();
+			printf("animation complete\n");
+			break;
+		}
 		printf("ray marching in progress...\n");
 		rayMarch();
 		printf("ray march complete\n");
@@ -773,6 +1424,13 @@ void ofApp::keyPressed(int key){
 	case 'p':
 		printChannel();
 		break;
+	case 'n':
+		bMeshPreview = !bMeshPreview;
+		break;
+	case 'N':
+		if (!mesher.isBuilt()) meshScene();
+		if (mesher.saveOBJ("scene.obj")) printf("mesh saved to scene.obj\n");
+		break;
 	case 'r':
 		bRad = true;
 		break;
@@ -874,12 +1532,15 @@ void ofApp::mouseDragged(int x, int y, int button){
 		mouseToDragPlane(x, y, point);
 		if (bRotateX) {
 			selected[0]->rotation += glm::vec3((point.x - lastPoint.x) * 20.0, 0, 0);
+			mesher.invalidate(selected[0]);
 		}
 		else if (bRotateY) {
 			selected[0]->rotation += glm::vec3(0, (point.x - lastPoint.x) * 20.0, 0);
+			mesher.invalidate(selected[0]);
 		}
 		else if (bRotateZ) {
 			selected[0]->rotation += glm::vec3(0, 0, (point.x - lastPoint.x) * 20.0);
+			mesher.invalidate(selected[0]);
 		}
 		else {
 			selected[0]->position += (point - lastPoint);
@@ -2,6 +2,17 @@
 
 #include "ofMain.h"
 #include "ofxGui.h"
+#include "benchmark.h"
+#include "regression.h"
+#include "imageSaver.h"
+#include "parallel.h"
+#include "marchCost.h"
+#include "dual.h"
+#include "perlinNoise.h"
+#include "sdfBrickCache.h"
+#include "heightfieldTracer.h"
+#include "sdfMesher.h"
+#include "depthReprojection.h"
 
 //  General Purpose Ray class 
 //
@@ -24,7 +35,31 @@ public:
 	virtual void draw() = 0;    // pure virtual funcs - must be overloaded
 	virtual bool intersect(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) { return false; }
 	virtual bool intersectToMove(const Ray &ray, glm::vec3 &point, glm::vec3 &normal) { return false; }
-	virtual float sdf(const glm::vec3 & p) { return 0.0; }
+	virtual float sdf(const glm::vec3 & p) const { return 0.0; }
+
+	//  a cheap lower bound on sdf(p) so the scene query can skip objects that
+	//  are too far away to be the closest one.  the default can't rule anything
+	//  out, objects with a bounding volume override it
+	//
+	virtual float sdfBound(const glm::vec3 &p) const { return -std::numeric_limits<float>::infinity(); }
+
+	//  how fast sdf() can change per unit of distance.  a true distance changes
+	//  by at most 1, an sdf that can change faster has to be divided by this
+	//  before a step of that length is safe (see ofApp::objectSDF())
+	//
+	virtual float lipschitz() const { return 1; }
+
+	//  sdf(p) over Duals, the distance and its gradient in one pass.  objects
+	//  that can't return false and their normals come from finite differences
+	//
+	virtual bool sdfDual(const Dual3 &p, Dual &dist) const { return false; }
+
+	//  sdf() of eight points, (x[i], y[i], z[i]) into dist[i], for the bakes.
+	//  objects with a batched kernel override it
+	//
+	virtual void sdf8(const float *x, const float *y, const float *z, float *dist) const {
+		for (int i = 0; i < 8; i++) dist[i] = sdf(glm::vec3(x[i], y[i], z[i]));
+	}
 
 	// commonly used transformations
 	//
@@ -122,7 +157,7 @@ public:
 		return (glm::intersectRaySphere(glm::vec3(p), d, glm::vec3(0, 0, 0), radius, point, normal));
 	}
 
-	float sdf(const glm::vec3 &p)
+	float sdf(const glm::vec3 &p) const
 	{
 		//cout << "p: " << p << endl;
 		//cout << "position: " << position << endl;
@@ -130,6 +165,14 @@ public:
 		return glm::length(p - position) - radius;			//straight from the slides
 	}
 
+	bool sdfDual(const Dual3 &p, Dual &dist) const
+	{
+		dist = length(p - position) - radius;
+		return true;
+	}
+
+	float sdfBound(const glm::vec3 &p) const { return sdf(p); }		//as cheap as it gets already
+
 	void draw() {
 		//   get the current transformation matrix for this object
 		//
@@ -173,7 +216,7 @@ public:
 		return (glm::intersectRaySphere(glm::vec3(p), d, glm::vec3(0, 0, 0), radius, point, normal));
 	}
 
-	float sdf(const glm::vec3 &p1)
+	float sdf(const glm::vec3 &p1) const
 	{
 		glm::mat4 m = glm::translate(glm::mat4(1.0), position);
 		glm::mat4 M = glm::rotate(m, glm::radians(angleRotate), rotation);
@@ -182,6 +225,21 @@ public:
 		return glm::length(q) - t.y;
 	}
 
+	bool sdfDual(const Dual3 &p1, Dual &dist) const
+	{
+		glm::mat4 m = glm::translate(glm::mat4(1.0), position);
+		glm::mat4 M = glm::rotate(m, glm::radians(angleRotate), rotation);
+		Dual3 p = transform(glm::inverse(M), p1);
+		dist = length(length(p.x, p.z) - t.x, p.y) - t.y;
+		return true;
+	}
+
+	//the torus fits in a sphere of radius t.x + t.y around its center
+	float sdfBound(const glm::vec3 &p) const
+	{
+		return glm::length(p - position) - (t.x + t.y);
+	}
+
 	//don't confused this "draw" with what's being "drawn" (rendered) for the output image
 	//this draws in the scene
 	void draw() {
@@ -228,7 +286,7 @@ public:
 	}
 	bool intersect(const Ray &ray, glm::vec3 & point, glm::vec3 & normal);
 
-	float sdf(const glm::vec3 & p)
+	float sdf(const glm::vec3 & p) const
 	{
 		if (normal == glm::vec3(0, 1, 0))
 		{
@@ -244,6 +302,14 @@ public:
 		}
 	}
 
+	bool sdfDual(const Dual3 &p, Dual &dist) const
+	{
+		if (normal == glm::vec3(0, 1, 0)) dist = p.y - position.y;
+		else if (normal == glm::vec3(0, 0, 1)) dist = p.z - position.z;
+		else return false;				//sdf() has no gradient to give
+		return true;
+	}
+
 	glm::vec3 getNormal(const glm::vec3 &p) { return this->normal; }
 	void draw() {
 		plane.setPosition(position);
@@ -276,24 +342,35 @@ public:
 	bool intersect(const Ray &ray, glm::vec3 & point, glm::vec3 & normal);
 
 	//prototyping heightfield sdf for project 2 part3
-	float sdf(const glm::vec3 & p)
+	//the octaves of glm::perlin() come from the tables in noise, see perlinNoise.h
+	float sdf(const glm::vec3 & p) const
 	{
-		float noise = 0;
-		frequency = 0.1;		//variable to change
-		octaves = 8;		
-		amplitude = 4.0;		//variable to change
-		for (int i = 0; i < octaves; i++)
-		{
-			noise += amplitude/2 * (glm::perlin(frequency * p));
-			amplitude /= 2;
-			frequency *= 2;
-		}
+		return p.y - (position.y + noise.eval(p));
+	}
+
+	//the same octaves over Duals, every octave's noise comes with its gradient
+	bool sdfDual(const Dual3 &p, Dual &dist) const
+	{
+		dist = p.y - (position.y + noise.eval(p));
+		return true;
+	}
 
+	void sdf8(const float *x, const float *y, const float *z, float *dist) const
+	{
+		noise.eval8(x, y, z, dist);
+		for (int i = 0; i < 8; i++) dist[i] = y[i] - (position.y + dist[i]);
+	}
 
-		return p.y - (position.y + noise);
-		
+	//the octaves never add up to more than noise.bound() either way, anything
+	//further above the pool than that can't be closer
+	float sdfBound(const glm::vec3 &p) const
+	{
+		return p.y - (position.y + noise.bound());
 	}
 
+	//the gradient is (0, 1, 0) less the noise's, which is at most noise.lipschitz() long
+	float lipschitz() const { return 1 + noise.lipschitz(); }
+
 	glm::vec3 getNormal(const glm::vec3 &p) { return this->normal; }
 	void draw() {
 		plane.setPosition(position);
@@ -306,9 +383,7 @@ public:
 	glm::vec3 normal;
 	float width = 20;
 	float height = 20;
-	float amplitude = 8.0;
-	float frequency = 0.8;
-	int octaves = 8;
+	FBm noise = FBm(4.0, 0.1, 8);	//amplitude and frequency of the first octave, halved and doubled every octave after
 };
 
 // view plane for render camera
@@ -466,6 +541,14 @@ public:
 	float coneLength = 3;
 };
 
+//result of a scene distance query, the distance to the closest object and
+//that object's index in the scene vector (-1 for an empty scene)
+struct SceneHit {
+	float dist;
+	int id;
+	int evals;			//exact sdf() calls the query needed, for the benchmark
+};
+
 /*
 	Michael Wong CS 116A Final Project
 */
@@ -476,6 +559,7 @@ class ofApp : public ofBaseApp{
 		void setup();
 		void update();
 		void draw();
+		void exit();
 
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -492,13 +576,27 @@ class ofApp : public ofBaseApp{
 		void drawAxis(glm::vec3 pos);
 		void rayTrace();
 		void rayMarch();
-		bool rayMarch(Ray r, glm::vec3 &p);
-		float sceneSDF(const glm::vec3 &p);
+		void marchFrame();
+		void renderAnimation(bool save = true);
+		void advanceFrame();
+		float reuseStart(int i, int j, float tStart);
+		ofColor tracePixel(int i, int j);
+		ofColor marchPixel(int i, int j, float tStart = 0, MarchCost *cost = nullptr);
+		void marchBlock(int x0, int y0, int size, float tStart);
+		float coneMarch(int x0, int y0, int size, float tStart);
+		bool rayMarch(const Ray &r, glm::vec3 &p, int &id, float tStart = 0, float footprint = 0, MarchCost *cost = nullptr);
+		SceneHit sceneQuery(const glm::vec3 &p, int skip = -1) const;
+		float objectSDF(int i, const glm::vec3 &p) const;
+		float sceneSDF(const glm::vec3 &p) const;
+		void bakeScene();
+		void bakeHeightfield();
+		void meshScene();
+		int tracedId() const;
 		ofColor ofApp::lambert(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse);
 		ofColor ofApp::phong(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse, const ofColor specular, float power);
 		bool isShadow(const Ray &r);
 		bool isSpotlightShadow(const Ray &r, const Light &l);
-		bool isSpotlightShadowRM(const Ray &r, const Light &l);
+		float shadowMarch(const Ray &r, float maxT);
 		ofColor allShader(const glm::vec3 &p, const glm::vec3 &norm, const ofColor diffuse, const ofColor specular, float power, SceneObject* obj);	
 		ofColor lookup(float u, float v);
 		bool objSelected() { return (selected.size() ? true : false); };
@@ -506,7 +604,9 @@ class ofApp : public ofBaseApp{
 		void printChannel();
 		void deleteObj();
 		bool inSpotLight(const Light &l, const glm::vec3 &p);
-		glm::vec3 getNormalRM(const glm::vec3 &p);
+		glm::vec3 getNormalRM(const glm::vec3 &p, float eps = 0.01, int id = -1);
+		float pixelFootprint();
+		void runBenchmark();
 
 		bool bMouse = true;
 		bool bHide;
@@ -519,6 +619,7 @@ class ofApp : public ofBaseApp{
 		RenderCam renderCam;
 		ofImage image, map;
 		ofImage texture;
+		ImageSaver saver;							//encodes renders on a background thread so the next one can start right away
 
 		Plane plane;
 		ViewPlane vp; 
@@ -526,7 +627,6 @@ class ofApp : public ofBaseApp{
 		vector<SceneObject*> selected;				//vector to hold an object that is selected
 		int imageH = 600, imageW = 900;			//dimensions for the image to render
 		float squares = 10;							//the dimensions for how many tiles you want layed on the plane
-		int sceneIdx = 0;
 
 		glm::vec3 hitpoint, normal;					//vec3s to be used later for intersect
 		Light light;
@@ -562,4 +662,44 @@ class ofApp : public ofBaseApp{
 		bool bAnimate = false;
 		bool bAngle = false;
 		bool bTValue = false;
+		bool bBenchmark = false;					//set by --benchmark in main(), renders the canonical scene headless and exits
+		RegressionCheck check;						//golden image and timing checks for the benchmark renders (--check)
+
+		int numThreads = 0;							//threads rayMarch() renders with, 0 uses every core (--threads)
+		bool bDualNormals = true;					//normals from sdfDual() where the object has it, see getNormalRM() (--fd-normals turns it off)
+		float shadowK = 8;							//penumbra sharpness of the ray marched shadows, bigger is harder, see shadowMarch() (--shadow-k)
+		float relaxation = 1;						//step factor for over-relaxed marching, 1 is plain sphere tracing (--relax)
+		bool bLipschitz = false;					//divide every object's sdf by its lipschitz() so each step is safe, see objectSDF() (--lipschitz)
+		bool bHeatmap = false;						//record what every pixel cost to march, see MarchCostPass (--heatmap)
+		MarchCostPass marchCost;
+		bool bCones = true;							//primary rays start where a cone over their pixel block got to, see marchBlock() (--no-cones)
+		bool bBake = false;							//march scene[bakeId] through a baked SDFBrickCache, see bakeScene() (--bake)
+		int bakeId = 0;								//the object to bake, the pool (also for the heightfield)
+		float bakeVoxel = 0.25;						//spacing of the baked samples near the surface (--bake-voxel)
+		glm::vec3 bakeMin = glm::vec3(-16, -8, -32);	//the box that gets baked, outside it the exact sdf is used
+		glm::vec3 bakeMax = glm::vec3(16, 4, 8);
+		SDFBrickCache bake;
+		bool bHeightfield = false;					//trace scene[bakeId] as a heightfield instead of marching it, see bakeHeightfield() (--heightfield)
+		float heightfieldCell = 0.125;				//size of the heightfield's cells (--heightfield-cell)
+		glm::vec3 heightfieldMin = glm::vec3(-32, 0, -48);	//x and z of the grid, off it the pool is sphere traced
+		glm::vec3 heightfieldMax = glm::vec3(32, 0, 16);
+		float heightfieldFar = 200;					//rays that haven't hit the pool by then miss it
+		HeightfieldTracer heightfield;
+		bool bMeshPreview = false;					//draw the scene's sdf as a mesh in the viewport instead of the primitives, see meshScene() (n, --mesh)
+		float meshCell = 0.25;						//size of the mesh's cells (--mesh-cell)
+		glm::vec3 meshMin = glm::vec3(-32, -8, -48);	//the box that gets meshed
+		glm::vec3 meshMax = glm::vec3(32, 8, 16);
+		SDFMesher mesher;
+		int animFrames = 0;							//frames 'm' renders when bAnimate is set, see renderAnimation() (--animate <frames>)
+		glm::vec3 animDolly = glm::vec3(0, 0, -0.1);	//how far the render camera moves each frame (--dolly <dz>)
+		float animTurn = 0;							//degrees every object goes around animCenter each frame (--turn <degrees>)
+		glm::vec3 animCenter = glm::vec3(0, 0, -5);
+		bool bReuse = true;							//frames after the first start their rays where the last one's hits reproject to, see reuseStart() (--no-reuse)
+		bool bRecording = false;					//the frame being marched records its hits for the next one
+		bool bReusing = false;						//and it has the last one's to start from
+		DepthReprojection reprojection;
+
+		std::atomic<uint64_t> rayCount{ 0 };		//rays cast since the last reset, for the benchmark
+		std::atomic<uint64_t> sdfCount{ 0 };		//object sdf evaluations since the last reset
+		std::atomic<uint64_t> stepCount{ 0 };		//march steps since the last reset
 };
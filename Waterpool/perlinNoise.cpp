@@ -0,0 +1,196 @@
+#include "perlinNoise.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// the helpers from glm's noise, on floats
+static float mod289(float x) { return x - floor(x * (1.0f / 289.0f)) * 289.0f; }
+static float permute(float x) { return mod289((x * 34.0f + 1.0f) * x); }
+static float taylorInvSqrt(float r) { return 1.79284291400159f - 0.85373472095314f * r; }
+static float fract(float x) { return x - floor(x); }
+
+template<typename T>
+static T fade(const T &t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+
+template<typename T>
+static T mix(const T &x, const T &y, const T &a) { return x * (1.0f - a) + y * a; }
+
+// the pseudo random gradient for a corner hash, the same as the lanes of gx0,
+// gy0, gz0 in glm
+static glm::vec3 cornerGradient(float hash) {
+	float gx = hash * (1.0f / 7.0f);
+	float gy = fract(floor(gx) * (1.0f / 7.0f)) - 0.5f;
+	gx = fract(gx);
+	float gz = 0.5f - fabs(gx) - fabs(gy);
+	float sz = 0 < gz ? 0.0f : 1.0f;				// step(gz, 0)
+	gx -= sz * ((gx < 0 ? 0.0f : 1.0f) - 0.5f);		// step(0, gx)
+	gy -= sz * ((gy < 0 ? 0.0f : 1.0f) - 0.5f);
+	glm::vec3 g(gx, gy, gz);
+	return g * taylorInvSqrt(glm::dot(g, g));
+}
+
+// cell is floor(p) and (fx, fy, fz) the position inside it.  the gradients only
+// depend on the cell, everything that depends on the position goes through T
+//
+template<typename T>
+static T noise(const glm::vec3 &cell, const T &fx, const T &fy, const T &fz) {
+	glm::vec3 pi0 = cell, pi1 = cell + 1.0f;
+	pi0 = glm::vec3(mod289(pi0.x), mod289(pi0.y), mod289(pi0.z));
+	pi1 = glm::vec3(mod289(pi1.x), mod289(pi1.y), mod289(pi1.z));
+
+	// corners in glm's lane order: (0, 0), (1, 0), (0, 1), (1, 1) in x and y,
+	// once at z = 0 and once at z = 1
+	float ix[4] = { pi0.x, pi1.x, pi0.x, pi1.x };
+	float iy[4] = { pi0.y, pi0.y, pi1.y, pi1.y };
+	T nz[4];
+	for (int k = 0; k < 4; k++) {
+		float ixy = permute(permute(ix[k]) + iy[k]);
+		glm::vec3 g0 = cornerGradient(permute(ixy + pi0.z));
+		glm::vec3 g1 = cornerGradient(permute(ixy + pi1.z));
+
+		T x = fx - (float)(k & 1);
+		T y = fy - (float)(k >> 1);
+		T n0 = x * g0.x + y * g0.y + fz * g0.z;
+		T n1 = x * g1.x + y * g1.y + (fz - 1.0f) * g1.z;
+		nz[k] = mix(n0, n1, fade(fz));
+	}
+
+	T ny0 = mix(nz[0], nz[2], fade(fy));
+	T ny1 = mix(nz[1], nz[3], fade(fy));
+	return mix(ny0, ny1, fade(fx)) * 2.2f;
+}
+
+float perlinNoise(const glm::vec3 &p) {
+	glm::vec3 cell = glm::floor(p);
+	return noise(cell, p.x - cell.x, p.y - cell.y, p.z - cell.z);
+}
+
+Dual perlinNoise(const Dual3 &p) {
+	glm::vec3 cell = glm::floor(p.value());
+	return noise(cell, p.x - cell.x, p.y - cell.y, p.z - cell.z);
+}
+
+#ifdef __AVX2__
+
+// the same steps as noise() above, a point per lane
+
+static __m256 mod289(__m256 x) { return _mm256_sub_ps(x, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.0f / 289.0f))), _mm256_set1_ps(289.0f))); }
+static __m256 permute(__m256 x) { return mod289(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(34.0f)), _mm256_set1_ps(1.0f)), x)); }
+static __m256 fract(__m256 x) { return _mm256_sub_ps(x, _mm256_floor_ps(x)); }
+static __m256 absolute(__m256 x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+
+static __m256 fade(__m256 t) {
+	__m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+static __m256 mix(__m256 x, __m256 y, __m256 a) {
+	return _mm256_add_ps(_mm256_mul_ps(x, _mm256_sub_ps(_mm256_set1_ps(1.0f), a)), _mm256_mul_ps(y, a));
+}
+
+// cornerGradient() dotted with the offset (x, y, z) from the corner
+static __m256 cornerDot(__m256 hash, __m256 x, __m256 y, __m256 z) {
+	__m256 one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f), zero = _mm256_setzero_ps();
+	__m256 gx = _mm256_mul_ps(hash, _mm256_set1_ps(1.0f / 7.0f));
+	__m256 gy = _mm256_sub_ps(fract(_mm256_mul_ps(_mm256_floor_ps(gx), _mm256_set1_ps(1.0f / 7.0f))), half);
+	gx = fract(gx);
+	__m256 gz = _mm256_sub_ps(_mm256_sub_ps(half, absolute(gx)), absolute(gy));
+	__m256 sz = _mm256_andnot_ps(_mm256_cmp_ps(zero, gz, _CMP_LT_OQ), one);				// step(gz, 0)
+	gx = _mm256_sub_ps(gx, _mm256_mul_ps(sz, _mm256_sub_ps(_mm256_andnot_ps(_mm256_cmp_ps(gx, zero, _CMP_LT_OQ), one), half)));
+	gy = _mm256_sub_ps(gy, _mm256_mul_ps(sz, _mm256_sub_ps(_mm256_andnot_ps(_mm256_cmp_ps(gy, zero, _CMP_LT_OQ), one), half)));
+
+	__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy)), _mm256_mul_ps(gz, gz));
+	__m256 inv = _mm256_sub_ps(_mm256_set1_ps(1.79284291400159f), _mm256_mul_ps(_mm256_set1_ps(0.85373472095314f), r));
+	gx = _mm256_mul_ps(gx, inv);
+	gy = _mm256_mul_ps(gy, inv);
+	gz = _mm256_mul_ps(gz, inv);
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, gx), _mm256_mul_ps(y, gy)), _mm256_mul_ps(z, gz));
+}
+
+void perlinNoise8(const float *x, const float *y, const float *z, float *out) {
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 px = _mm256_loadu_ps(x), py = _mm256_loadu_ps(y), pz = _mm256_loadu_ps(z);
+	__m256 cx = _mm256_floor_ps(px), cy = _mm256_floor_ps(py), cz = _mm256_floor_ps(pz);
+	__m256 fx = _mm256_sub_ps(px, cx), fy = _mm256_sub_ps(py, cy), fz = _mm256_sub_ps(pz, cz);
+
+	__m256 ix[2] = { mod289(cx), mod289(_mm256_add_ps(cx, one)) };
+	__m256 iy[2] = { mod289(cy), mod289(_mm256_add_ps(cy, one)) };
+	__m256 iz[2] = { mod289(cz), mod289(_mm256_add_ps(cz, one)) };
+	__m256 px0[2] = { permute(ix[0]), permute(ix[1]) };
+	__m256 fz1 = _mm256_sub_ps(fz, one);
+	__m256 wz = fade(fz);
+
+	__m256 nz[4];
+	for (int k = 0; k < 4; k++) {
+		__m256 ixy = permute(_mm256_add_ps(px0[k & 1], iy[k >> 1]));
+		__m256 lx = (k & 1) ? _mm256_sub_ps(fx, one) : fx;
+		__m256 ly = (k >> 1) ? _mm256_sub_ps(fy, one) : fy;
+		__m256 n0 = cornerDot(permute(_mm256_add_ps(ixy, iz[0])), lx, ly, fz);
+		__m256 n1 = cornerDot(permute(_mm256_add_ps(ixy, iz[1])), lx, ly, fz1);
+		nz[k] = mix(n0, n1, wz);
+	}
+
+	__m256 wy = fade(fy);
+	__m256 ny0 = mix(nz[0], nz[2], wy);
+	__m256 ny1 = mix(nz[1], nz[3], wy);
+	_mm256_storeu_ps(out, _mm256_mul_ps(mix(ny0, ny1, fade(fx)), _mm256_set1_ps(2.2f)));
+}
+
+#else
+
+void perlinNoise8(const float *x, const float *y, const float *z, float *out) {
+	for (int i = 0; i < 8; i++) out[i] = perlinNoise(glm::vec3(x[i], y[i], z[i]));
+}
+
+#endif
+
+FBm::FBm(float amplitude, float frequency, int octaves) {
+	count = ofClamp(octaves, 0, MAX_OCTAVES);
+	for (int i = 0; i < count; i++) {
+		scales[i] = frequency;
+		weights[i] = amplitude / 2;
+		total += weights[i];
+		slope += SLOPE * weights[i] * scales[i];
+		amplitude /= 2;
+		frequency *= 2;
+	}
+}
+
+float FBm::eval(const glm::vec3 &p) const {
+	alignas(32) float x[8], y[8], z[8], n[8];
+	float sum = 0;
+	for (int first = 0; first < count; first += 8) {
+		// lanes past the last octave repeat it and are left out of the sum
+		int lanes = std::min(8, count - first);
+		for (int i = 0; i < 8; i++) {
+			float s = scales[first + std::min(i, lanes - 1)];
+			x[i] = s * p.x;
+			y[i] = s * p.y;
+			z[i] = s * p.z;
+		}
+		perlinNoise8(x, y, z, n);
+		for (int i = 0; i < lanes; i++) sum += weights[first + i] * n[i];
+	}
+	return sum;
+}
+
+Dual FBm::eval(const Dual3 &p) const {
+	Dual sum;
+	for (int i = 0; i < count; i++) sum = sum + weights[i] * perlinNoise(p * scales[i]);
+	return sum;
+}
+
+void FBm::eval8(const float *x, const float *y, const float *z, float *out) const {
+	alignas(32) float sx[8], sy[8], sz[8], n[8];
+	for (int j = 0; j < 8; j++) out[j] = 0;
+	for (int i = 0; i < count; i++) {
+		for (int j = 0; j < 8; j++) {
+			sx[j] = scales[i] * x[j];
+			sy[j] = scales[i] * y[j];
+			sz[j] = scales[i] * z[j];
+		}
+		perlinNoise8(sx, sy, sz, n);
+		for (int j = 0; j < 8; j++) out[j] += weights[i] * n[j];
+	}
+}
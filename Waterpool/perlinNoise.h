@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ofMain.h"
+#include "dual.h"
+
+//  glm::perlin() for 3D points - Stefan Gustavson's classic noise, ported from
+//  glm step for step - written once over floats and once over Duals.
+//
+//  Inside a lattice cell the corner gradients are fixed and the noise is a
+//  polynomial in the position, so the Dual version differentiates it exactly
+//  and gives the gradient of the noise along with its value.
+//
+float perlinNoise(const glm::vec3 &p);
+Dual perlinNoise(const Dual3 &p);
+
+//  perlinNoise() of eight points at once, (x[i], y[i], z[i]) into out[i].
+//  With AVX2 each point gets a lane, without it this is a loop.
+//
+void perlinNoise8(const float *x, const float *y, const float *z, float *out);
+
+//  The octaves of fBm: perlinNoise() at doubling frequencies and halving
+//  amplitudes, summed.  The constructor works out every octave's frequency
+//  (scale()) and what its noise is multiplied by (weight()) once, and nothing
+//  changes them after, so one FBm can be read by every render thread.
+//
+//  eval() puts the octaves of one point in the lanes of perlinNoise8(), so
+//  eight octaves cost one call.  eval8() does eight points, an octave per call.
+//  Both add the octaves up in the same order as a plain loop would, so the
+//  result is the same as perlinNoise() octave by octave.
+//
+class FBm {
+public:
+	static const int MAX_OCTAVES = 16;
+
+	//  a bound on how much perlinNoise() changes per unit.  inside a cell the
+	//  noise is 2.2 times the sum over the corners of W * g.d, W the product
+	//  of the three fades and d the offset from the corner, so its gradient is
+	//  2.2 * (sum W g + sum grad(W) g.d).  the first is an average of corner
+	//  gradients, and none of the 289 of them is longer than 0.9987.  along
+	//  each axis the second is fade'(t) <= 1.875 times the difference of two
+	//  g.d, each at most |g.x| + |g.y| + |g.z| <= 1.664 (every |d| component
+	//  is at most 1), so at most 1.875 * 2 * 1.664 per axis and sqrt(3) times
+	//  that in all.  2.2 * (0.9987 + 10.81) = 25.97.  hill climbing never
+	//  found a gradient over 3.94, but that is no bound.
+	//
+	//  an octave scales the point by scale() and the noise by weight(), so its
+	//  slope is at most SLOPE * weight() * scale() and the fBm's is at most the
+	//  sum of those
+	//
+	static constexpr float SLOPE = 26;
+
+	FBm(float amplitude = 4.0, float frequency = 0.1, int octaves = 8);
+
+	int octaves() const { return count; }
+	float scale(int i) const { return scales[i]; }
+	float weight(int i) const { return weights[i]; }
+	float bound() const { return total; }		// the sum of the weights, perlinNoise() stays in [-1, 1] so the fBm stays under this
+	float lipschitz() const { return slope; }	// the most the fBm can change per unit, see SLOPE
+
+	float eval(const glm::vec3 &p) const;
+	Dual eval(const Dual3 &p) const;
+	void eval8(const float *x, const float *y, const float *z, float *out) const;
+
+private:
+	int count = 0;
+	float scales[MAX_OCTAVES];
+	float weights[MAX_OCTAVES];
+	float total = 0;
+	float slope = 0;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Golden image and timing checks for the benchmark renders.
+//
+//  References live in bin/data/golden/: <name>.png for each image and
+//  baseline.txt with one "<name> <seconds>" line per timed render.  A render
+//  passes if its PSNR against the reference is at least minPSNR and no more
+//  than maxBadPixels of its pixels are off by more than badPixelDelta in any
+//  channel.  A timing passes if it is at most (1 + maxSlowdown) times the
+//  baseline.  Failed images leave <name>_actual.png and <name>_diff.png next
+//  to the reference.  Missing references are written, not failed, and with
+//  bless set every reference is rewritten from the current run.
+//
+class RegressionCheck {
+public:
+	bool enabled = false;
+	bool bless = false;
+	float minPSNR = 40;				// dB
+	float maxBadPixels = 0.001;		// fraction of the image
+	int badPixelDelta = 16;			// per channel, 0-255
+	float maxSlowdown = 0.10;		// 10% over baseline
+	string dir = "golden/";
+
+	void image(const string &name, const ofPixels &actual) {
+		if (!enabled) return;
+		string refPath = dir + name + ".png";
+		ofDirectory::createDirectory(dir, true, true);
+
+		ofPixels ref;
+		if (bless || !ofFile::doesFileExist(refPath) || !ofLoadImage(ref, refPath)) {
+			ofSaveImage(actual, refPath);
+			report(name, true, "wrote reference " + refPath);
+			return;
+		}
+		if (ref.getWidth() != actual.getWidth() || ref.getHeight() != actual.getHeight()) {
+			ofSaveImage(actual, dir + name + "_actual.png");
+			report(name, false, "size " + ofToString(actual.getWidth()) + "x" + ofToString(actual.getHeight()) +
+				" doesn't match reference " + ofToString(ref.getWidth()) + "x" + ofToString(ref.getHeight()));
+			return;
+		}
+
+		//  accumulate the squared error and build the diff image as we go, the
+		//  diff is scaled up so small errors are still visible
+		//
+		ofPixels diff;
+		diff.allocate(actual.getWidth(), actual.getHeight(), OF_IMAGE_COLOR);
+		double sse = 0;
+		int bad = 0;
+		for (int y = 0; y < actual.getHeight(); y++) {
+			for (int x = 0; x < actual.getWidth(); x++) {
+				ofColor a = actual.getColor(x, y);
+				ofColor b = ref.getColor(x, y);
+				int worst = 0;
+				ofColor d;
+				for (int c = 0; c < 3; c++) {
+					int e = abs((int)a[c] - (int)b[c]);
+					sse += e * e;
+					worst = max(worst, e);
+					d[c] = min(255, e * 8);
+				}
+				if (worst > badPixelDelta) bad++;
+				diff.setColor(x, y, d);
+			}
+		}
+
+		double pixels = (double)actual.getWidth() * actual.getHeight();
+		double mse = sse / (pixels * 3);
+		double psnr = mse == 0 ? std::numeric_limits<double>::infinity() : 10 * log10(255.0 * 255.0 / mse);
+		double badFraction = bad / pixels;
+
+		bool pass = psnr >= minPSNR && badFraction <= maxBadPixels;
+		if (!pass) {
+			ofSaveImage(actual, dir + name + "_actual.png");
+			ofSaveImage(diff, dir + name + "_diff.png");
+		}
+		report(name, pass, "psnr " + ofToString(psnr, 2) + " dB, " + ofToString(badFraction * 100, 3) + "% pixels off");
+	}
+
+	void time(const string &name, double seconds) {
+		if (!enabled) return;
+		map<string, double> baseline = loadBaseline();
+
+		if (bless || baseline.count(name) == 0) {
+			baseline[name] = seconds;
+			saveBaseline(baseline);
+			report(name + " time", true, "wrote baseline " + ofToString(seconds, 3) + " s");
+			return;
+		}
+		double limit = baseline[name] * (1 + maxSlowdown);
+		report(name + " time", seconds <= limit, ofToString(seconds, 3) + " s, baseline " + ofToString(baseline[name], 3) + " s");
+	}
+
+	bool passed() { return failures == 0; }
+
+	int failures = 0;
+
+private:
+	void report(const string &name, bool pass, const string &detail) {
+		if (!pass) failures++;
+		cout << (pass ? "PASS " : "FAIL ") << name << ": " << detail << endl;
+	}
+
+	map<string, double> loadBaseline() {
+		map<string, double> baseline;
+		ifstream in(ofToDataPath(dir + "baseline.txt"));
+		string name;
+		double seconds;
+		while (in >> name >> seconds) baseline[name] = seconds;
+		return baseline;
+	}
+
+	void saveBaseline(const map<string, double> &baseline) {
+		ofstream out(ofToDataPath(dir + "baseline.txt"));
+		for (const auto &b : baseline) out << b.first << " " << b.second << endl;
+	}
+};
@@ -0,0 +1,173 @@
+#include "sdfBrickCache.h"
+#include "ofApp.h"
+#include "parallel.h"
+
+void SDFBrickCache::clear() {
+	baked = nullptr;
+	cells = glm::ivec3(0);
+	coarse.clear();
+	cellBrick.clear();
+	brickStart.clear();
+	bricks.clear();
+	seconds = 0;
+}
+
+bool SDFBrickCache::isBaked(const SceneObject *obj) const {
+	return baked && baked == obj && bakedPosition == obj->position;
+}
+
+void SDFBrickCache::bake(const SceneObject *obj, glm::vec3 min, glm::vec3 max, float voxelSize, int brickSize, int threads) {
+	auto begin = std::chrono::high_resolution_clock::now();
+	clear();
+	baked = obj;
+	bakedPosition = obj->position;
+	this->brickSize = brickSize;
+	voxel = voxelSize;
+	cellSize = voxel * brickSize;
+	origin = min;
+	cells = glm::max(glm::ivec3(glm::ceil((max - min) / cellSize)), glm::ivec3(1));
+	end = origin + glm::vec3(cells) * cellSize;
+
+	// the coarse field, a tile of corner columns per task
+	int nx = cells.x + 1, ny = cells.y + 1, nz = cells.z + 1;
+	coarse.resize(nx * ny * nz);
+	parallelTiles(nx, nz, 8, threads, [&](int x0, int z0, int x1, int z1) {
+		for (int z = z0; z < z1; z++) {
+			for (int y = 0; y < ny; y++) {
+				for (int x = x0; x < x1; x++) {
+					coarse[(z * ny + y) * nx + x] = obj->sdf(origin + glm::vec3(x, y, z) * cellSize);
+				}
+			}
+		}
+	});
+
+	slope = 1;
+	for (int z = 0; z < nz; z++) {
+		for (int y = 0; y < ny; y++) {
+			for (int x = 0; x < nx; x++) {
+				float d = coarseSample(x, y, z);
+				if (x > 0) slope = std::max(slope, fabs(d - coarseSample(x - 1, y, z)) / cellSize);
+				if (y > 0) slope = std::max(slope, fabs(d - coarseSample(x, y - 1, z)) / cellSize);
+				if (z > 0) slope = std::max(slope, fabs(d - coarseSample(x, y, z - 1)) / cellSize);
+			}
+		}
+	}
+
+	// a cell gets a brick if the surface may pass through it, that is if one
+	// of its corners is closer to the surface than the field can change
+	// across the cell
+	float diagonal = cellSize * sqrt(3.0f);
+	int samples = (brickSize + 1) * (brickSize + 1) * (brickSize + 1);
+	cellBrick.assign(cellCount(), -1);
+	for (int z = 0; z < cells.z; z++) {
+		for (int y = 0; y < cells.y; y++) {
+			for (int x = 0; x < cells.x; x++) {
+				float nearest = std::numeric_limits<float>::infinity();
+				for (int c = 0; c < 8; c++) nearest = std::min(nearest, fabs(coarseSample(x + (c & 1), y + ((c >> 1) & 1), z + (c >> 2))));
+				if (nearest > slope * diagonal) continue;
+
+				int cell = (z * cells.y + y) * cells.x + x;
+				cellBrick[cell] = brickStart.size() * samples;
+				brickStart.push_back(cell);
+			}
+		}
+	}
+
+	// the bricks, which is where nearly all of the time goes
+	bricks.resize(brickStart.size() * samples);
+	parallelTiles(brickStart.size(), 1, 4, threads, [&](int b0, int, int b1, int) {
+		for (int b = b0; b < b1; b++) bakeBrick(brickStart[b], b * samples);
+	});
+
+	int n = brickSize + 1;
+	for (int b = 0; b < brickStart.size(); b++) {
+		int start = b * samples;
+		for (int z = 0; z < n; z++) {
+			for (int y = 0; y < n; y++) {
+				for (int x = 0; x < n; x++) {
+					float d = brickSample(start, x, y, z);
+					if (x > 0) slope = std::max(slope, fabs(d - brickSample(start, x - 1, y, z)) / voxel);
+					if (y > 0) slope = std::max(slope, fabs(d - brickSample(start, x, y - 1, z)) / voxel);
+					if (z > 0) slope = std::max(slope, fabs(d - brickSample(start, x, y, z - 1)) / voxel);
+				}
+			}
+		}
+	}
+
+	// trilinear interpolation is off by at most slope times the distance to
+	// the furthest corner, the diagonal of a voxel or cell
+	fineMargin = slope * voxel * sqrt(3.0f);
+	coarseMargin = slope * diagonal;
+	nearDistance = voxel;
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+	seconds = elapsed.count();
+}
+
+// a row of samples at a time through sdf8(), in runs of eight.  the lanes
+// past the end of the row repeat its last sample and are dropped
+void SDFBrickCache::bakeBrick(int cell, int start) {
+	int x0 = cell % cells.x, y0 = (cell / cells.x) % cells.y, z0 = cell / (cells.x * cells.y);
+	glm::vec3 corner = origin + glm::vec3(x0, y0, z0) * cellSize;
+	int n = brickSize + 1;
+	alignas(32) float px[8], py[8], pz[8], d[8];
+	for (int z = 0; z < n; z++) {
+		for (int y = 0; y < n; y++) {
+			for (int x = 0; x < n; x += 8) {
+				int lanes = std::min(8, n - x);
+				for (int i = 0; i < 8; i++) {
+					glm::vec3 p = corner + glm::vec3(x + std::min(i, lanes - 1), y, z) * voxel;
+					px[i] = p.x;
+					py[i] = p.y;
+					pz[i] = p.z;
+				}
+				baked->sdf8(px, py, pz, d);
+				for (int i = 0; i < lanes; i++) bricks[start + (z * n + y) * n + x + i] = d[i];
+			}
+		}
+	}
+}
+
+float SDFBrickCache::sdf(const glm::vec3 &p) const {
+	if (!baked) return 0;
+	if (p.x < origin.x || p.y < origin.y || p.z < origin.z || p.x >= end.x || p.y >= end.y || p.z >= end.z) return baked->sdf(p);
+
+	glm::vec3 q = (p - origin) / cellSize;
+	glm::ivec3 c = glm::min(glm::ivec3(q), cells - 1);
+	int brick = cellBrick[(c.z * cells.y + c.y) * cells.x + c.x];
+
+	float d;
+	if (brick < 0) {
+		glm::vec3 f = q - glm::vec3(c);
+		float x00 = ofLerp(coarseSample(c.x, c.y, c.z), coarseSample(c.x + 1, c.y, c.z), f.x);
+		float x10 = ofLerp(coarseSample(c.x, c.y + 1, c.z), coarseSample(c.x + 1, c.y + 1, c.z), f.x);
+		float x01 = ofLerp(coarseSample(c.x, c.y, c.z + 1), coarseSample(c.x + 1, c.y, c.z + 1), f.x);
+		float x11 = ofLerp(coarseSample(c.x, c.y + 1, c.z + 1), coarseSample(c.x + 1, c.y + 1, c.z + 1), f.x);
+		d = ofLerp(ofLerp(x00, x10, f.y), ofLerp(x01, x11, f.y), f.z) - coarseMargin;
+	}
+	else {
+		glm::vec3 v = (q - glm::vec3(c)) * (float)brickSize;
+		glm::ivec3 i = glm::min(glm::ivec3(v), glm::ivec3(brickSize - 1));
+		glm::vec3 f = v - glm::vec3(i);
+		float x00 = ofLerp(brickSample(brick, i.x, i.y, i.z), brickSample(brick, i.x + 1, i.y, i.z), f.x);
+		float x10 = ofLerp(brickSample(brick, i.x, i.y + 1, i.z), brickSample(brick, i.x + 1, i.y + 1, i.z), f.x);
+		float x01 = ofLerp(brickSample(brick, i.x, i.y, i.z + 1), brickSample(brick, i.x + 1, i.y, i.z + 1), f.x);
+		float x11 = ofLerp(brickSample(brick, i.x, i.y + 1, i.z + 1), brickSample(brick, i.x + 1, i.y + 1, i.z + 1), f.x);
+		d = ofLerp(ofLerp(x00, x10, f.y), ofLerp(x01, x11, f.y), f.z) - fineMargin;
+	}
+
+	// close to the surface only the real thing will do
+	return d > nearDistance ? d : baked->sdf(p);
+}
+
+size_t SDFBrickCache::bytes() const {
+	return (coarse.size() + bricks.size()) * sizeof(float) + (cellBrick.size() + brickStart.size()) * sizeof(int);
+}
+
+string SDFBrickCache::report() const {
+	stringstream ss;
+	ss << "baked " << cells.x << "x" << cells.y << "x" << cells.z << " cells of " << cellSize << ", "
+		<< brickCount() << " bricks of " << brickSize << "^3 voxels (" << 100.0 * brickCount() / std::max(cellCount(), 1) << "% of the cells), "
+		<< bytes() / (1024.0 * 1024.0) << " MB, slope " << slope << ", in " << seconds << " s";
+	return ss.str();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+
+class SceneObject;
+
+//  One object's sdf baked into a sparse grid of bricks.
+//
+//  The box being baked is split into cells brickSize voxels across.  The
+//  cell corners are sampled everywhere (the coarse field), and only cells the
+//  surface may pass through get a brick: (brickSize + 1)^3 samples, one per
+//  voxel corner (the narrow band).  sdf() interpolates the samples around p
+//  and lowers the result by how far the field can change across a voxel or
+//  cell, so what it returns is never more than the real distance and the
+//  marcher can step by it safely.  Once that gets within nearDistance of the
+//  surface it calls the object's own sdf() instead, so hits and normals are
+//  exact; outside the box it always does.
+//
+//  The bake is only good for the object as it was: bake again whenever it
+//  changes.  isBaked() catches the object moving.
+//
+class SDFBrickCache {
+public:
+	//  samples obj over [min, max] with voxels of voxelSize, spread across
+	//  threads (0 uses every core)
+	//
+	void bake(const SceneObject *obj, glm::vec3 min, glm::vec3 max, float voxelSize, int brickSize = 8, int threads = 0);
+	void clear();
+
+	bool isBaked(const SceneObject *obj) const;
+	const SceneObject *object() const { return baked; }
+
+	float sdf(const glm::vec3 &p) const;
+
+	//  what the bake cost and what it holds
+	//
+	double bakeSeconds() const { return seconds; }
+	int brickCount() const { return (int)brickStart.size(); }
+	int cellCount() const { return cells.x * cells.y * cells.z; }
+	size_t bytes() const;
+	float lipschitz() const { return slope; }
+	string report() const;
+
+	float nearDistance = 0;		// set by bake() to a voxel, the exact sdf is used closer than this
+
+private:
+	float coarseSample(int x, int y, int z) const { return coarse[(z * (cells.y + 1) + y) * (cells.x + 1) + x]; }
+	float brickSample(int brick, int x, int y, int z) const { return bricks[brick + (z * (brickSize + 1) + y) * (brickSize + 1) + x]; }
+	void bakeBrick(int cell, int start);
+
+	const SceneObject *baked = nullptr;
+	glm::vec3 bakedPosition;		// where the object was, see isBaked()
+
+	glm::vec3 origin, end;
+	float voxel = 0, cellSize = 0;
+	int brickSize = 8;
+	glm::ivec3 cells = glm::ivec3(0);
+
+	vector<float> coarse;			// the cell corners
+	vector<int> cellBrick;			// per cell, where its brick starts in bricks, -1 if it has none
+	vector<int> brickStart;			// the same for the cells that have one, in the order they were baked
+	vector<float> bricks;
+
+	float slope = 1;				// steepest change between neighbouring samples, per unit
+	float coarseMargin = 0, fineMargin = 0;
+	double seconds = 0;
+};
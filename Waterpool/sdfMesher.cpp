@@ -0,0 +1,300 @@
+#include "sdfMesher.h"
+#include "ofApp.h"
+#include "parallel.h"
+
+void SDFMesher::clear() {
+	chunks.clear();
+	meshed.clear();
+	cells = chunkGrid = glm::ivec3(0);
+	seconds = 0;
+}
+
+void SDFMesher::build(const vector<SceneObject *> &scene, glm::vec3 min, glm::vec3 max, float cellSize, int threads) {
+	clear();
+	cell = cellSize;
+	origin = min;
+	cells = glm::max(glm::ivec3(glm::ceil((max - min) / cell)), glm::ivec3(1));
+	chunkGrid = (cells + CHUNK - 1) / CHUNK;
+
+	vector<int> all;
+	for (int z = 0; z < chunkGrid.z; z++) {
+		for (int y = 0; y < chunkGrid.y; y++) {
+			for (int x = 0; x < chunkGrid.x; x++) {
+				Chunk chunk;
+				chunk.first = glm::ivec3(x, y, z) * CHUNK;
+				all.push_back(chunks.size());
+				chunks.push_back(chunk);
+			}
+		}
+	}
+	rebuild(all, scene, threads);
+}
+
+void SDFMesher::invalidate(const SceneObject *obj) {
+	for (Meshed &m : meshed) {
+		if (m.obj == obj) m.dirty = true;
+	}
+}
+
+int SDFMesher::update(const vector<SceneObject *> &scene, int threads) {
+	if (chunks.empty()) return 0;
+
+	// objects that are gone, moved or were invalidated, and the ones that are new
+	vector<const SceneObject *> changed;
+	for (const Meshed &m : meshed) {
+		bool kept = std::find(scene.begin(), scene.end(), m.obj) != scene.end();
+		if (!kept || m.dirty || m.obj->position != m.position) changed.push_back(m.obj);
+	}
+	for (const SceneObject *obj : scene) {
+		if (std::none_of(meshed.begin(), meshed.end(), [obj](const Meshed &m) { return m.obj == obj; })) changed.push_back(obj);
+	}
+	if (changed.empty()) return 0;
+
+	// a chunk changes if one of them was in it or is now.  only the ones
+	// still in the scene can be asked where they are
+	vector<int> which;
+	for (int i = 0; i < chunks.size(); i++) {
+		const Chunk &chunk = chunks[i];
+		for (const SceneObject *obj : changed) {
+			bool was = std::find(chunk.objects.begin(), chunk.objects.end(), obj) != chunk.objects.end();
+			bool kept = std::find(scene.begin(), scene.end(), obj) != scene.end();
+			if (was || (kept && reaches(obj, chunk))) {
+				which.push_back(i);
+				break;
+			}
+		}
+	}
+	rebuild(which, scene, threads);
+	return which.size();
+}
+
+void SDFMesher::rebuild(const vector<int> &which, const vector<SceneObject *> &scene, int threads) {
+	auto begin = std::chrono::high_resolution_clock::now();
+	parallelTiles(which.size(), 1, 1, threads, [&](int c0, int, int c1, int) {
+		for (int c = c0; c < c1; c++) buildChunk(chunks[which[c]], scene);
+	});
+
+	meshed.clear();
+	for (const SceneObject *obj : scene) meshed.push_back({ obj, obj->position, false });
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - begin;
+	seconds = elapsed.count();
+}
+
+// whether obj's surface can come within the corners the chunk samples, from
+// the distance at their center.  inside the object the sdf over its
+// lipschitz() is a bound on how far the surface is, outside sdfBound() can be
+// the better one.  a chunk deep inside an object is left without it too, it
+// has no surface there and anything else in the chunk only adds hidden faces
+bool SDFMesher::reaches(const SceneObject *obj, const Chunk &chunk) const {
+	glm::vec3 lo = origin + glm::vec3(chunk.first - 1) * cell;
+	glm::vec3 hi = origin + glm::vec3(chunk.first + CHUNK) * cell;
+	glm::vec3 center = (lo + hi) * 0.5f;
+	float radius = glm::length(hi - lo) * 0.5f;
+
+	float d = obj->sdf(center);
+	float bound = d >= 0 ? std::max(d / obj->lipschitz(), obj->sdfBound(center)) : -d / obj->lipschitz();
+	return bound <= radius;
+}
+
+// samples the chunk's objects at every corner from one cell before the chunk
+// to its far side, so the cells around its first edges have vertices too,
+// then places the vertices and connects them up
+void SDFMesher::buildChunk(Chunk &chunk, const vector<SceneObject *> &scene) const {
+	chunk.mesh.clear();
+	chunk.mesh.setMode(OF_PRIMITIVE_TRIANGLES);
+	chunk.objects.clear();
+	for (const SceneObject *obj : scene) {
+		if (reaches(obj, chunk)) chunk.objects.push_back(obj);
+	}
+	if (chunk.objects.empty()) return;
+
+	const int n = CHUNK + 2;
+	glm::vec3 base = origin + glm::vec3(chunk.first - 1) * cell;
+	vector<float> field(n * n * n, std::numeric_limits<float>::infinity());
+	auto sample = [&](int x, int y, int z) { return field[(z * n + y) * n + x]; };
+
+	// a row at a time through sdf8(), the lanes past the end of the row
+	// repeat its last corner and are dropped
+	alignas(32) float px[8], py[8], pz[8], row[8];
+	for (int z = 0; z < n; z++) {
+		for (int y = 0; y < n; y++) {
+			for (int x = 0; x < n; x += 8) {
+				int lanes = std::min(8, n - x);
+				for (int i = 0; i < 8; i++) {
+					glm::vec3 p = base + glm::vec3(x + std::min(i, lanes - 1), y, z) * cell;
+					px[i] = p.x;
+					py[i] = p.y;
+					pz[i] = p.z;
+				}
+				for (const SceneObject *obj : chunk.objects) {
+					obj->sdf8(px, py, pz, row);
+					for (int i = 0; i < lanes; i++) {
+						float &f = field[(z * n + y) * n + x + i];
+						f = std::min(f, row[i]);
+					}
+				}
+			}
+		}
+	}
+
+	// the closest of the chunk's objects at p, and the gradient of the scene
+	// there from its sdfDual() or from finite differences
+	auto closest = [&](const glm::vec3 &p, float &dist) {
+		const SceneObject *best = nullptr;
+		dist = std::numeric_limits<float>::infinity();
+		for (const SceneObject *obj : chunk.objects) {
+			float d = obj->sdf(p);
+			if (d < dist) {
+				dist = d;
+				best = obj;
+			}
+		}
+		return best;
+	};
+	auto gradient = [&](const SceneObject *obj, const glm::vec3 &p) {
+		Dual dist;
+		if (obj->sdfDual(Dual3::point(p), dist)) return dist.d;
+		float e = cell * 0.1f, d;
+		closest(p, d);
+		float dx, dy, dz;
+		closest(p + glm::vec3(e, 0, 0), dx);
+		closest(p + glm::vec3(0, e, 0), dy);
+		closest(p + glm::vec3(0, 0, e), dz);
+		return glm::vec3(dx - d, dy - d, dz - d) / e;
+	};
+
+	// a vertex in every cell of the grid with corners on both sides of the surface
+	const int m = n - 1;
+	vector<int> vertex(m * m * m, -1);
+	glm::vec3 light = glm::normalize(glm::vec3(0.4, 1, 0.3));
+	for (int z = 0; z < m; z++) {
+		for (int y = 0; y < m; y++) {
+			for (int x = 0; x < m; x++) {
+				glm::ivec3 c = chunk.first - 1 + glm::ivec3(x, y, z);
+				if (c.x < 0 || c.y < 0 || c.z < 0 || c.x >= cells.x || c.y >= cells.y || c.z >= cells.z) continue;
+
+				// where the 12 edges cross, on average
+				glm::vec3 sum(0);
+				int crossings = 0;
+				for (int e = 0; e < 12; e++) {
+					int a = e / 4, b = (a + 1) % 3, k = (a + 2) % 3;
+					glm::ivec3 o(0);
+					o[b] = e & 1;
+					o[k] = (e >> 1) & 1;
+					glm::ivec3 o1 = o;
+					o1[a] = 1;
+					float d0 = sample(x + o.x, y + o.y, z + o.z), d1 = sample(x + o1.x, y + o1.y, z + o1.z);
+					if ((d0 < 0) == (d1 < 0)) continue;
+					glm::vec3 q = glm::vec3(o);
+					q[a] = d0 / (d0 - d1);
+					sum += q;
+					crossings++;
+				}
+				if (crossings == 0) continue;
+
+				// then a Newton step onto the surface, kept inside the cell
+				glm::vec3 lo = base + glm::vec3(x, y, z) * cell;
+				glm::vec3 p = lo + sum / (float)crossings * cell;
+				float dist;
+				const SceneObject *obj = closest(p, dist);
+				glm::vec3 g = gradient(obj, p);
+				if (glm::dot(g, g) > 0) p = glm::clamp(p - g * (dist / glm::dot(g, g)), lo, lo + cell);
+				obj = closest(p, dist);
+				glm::vec3 normal = gradient(obj, p);
+				normal = glm::length(normal) > 0 ? glm::normalize(normal) : glm::vec3(0, 1, 0);
+
+				// the viewport isn't lit, so the shading goes into the color
+				ofFloatColor color = obj->diffuseColor;
+				color *= 0.35f + 0.65f * std::max(glm::dot(normal, light), 0.0f);
+				color.a = 1;
+
+				vertex[(z * m + y) * m + x] = chunk.mesh.getNumVertices();
+				chunk.mesh.addVertex(p);
+				chunk.mesh.addNormal(normal);
+				chunk.mesh.addColor(color);
+			}
+		}
+	}
+
+	// a quad for every edge the chunk owns (the ones starting at its own
+	// corners) that crosses the surface, between the four cells around it,
+	// wound so it faces out of the surface
+	for (int z = 1; z < n - 1; z++) {
+		for (int y = 1; y < n - 1; y++) {
+			for (int x = 1; x < n - 1; x++) {
+				float d0 = sample(x, y, z);
+				for (int a = 0; a < 3; a++) {
+					int b = (a + 1) % 3, k = (a + 2) % 3;
+					glm::ivec3 g(x, y, z), ea(0), eb(0), ek(0);
+					ea[a] = eb[b] = ek[k] = 1;
+					glm::ivec3 g1 = g + ea;
+					float d1 = sample(g1.x, g1.y, g1.z);
+					if ((d0 < 0) == (d1 < 0)) continue;
+
+					glm::ivec3 around[4] = { g - eb - ek, g - ek, g, g - eb };
+					int v[4];
+					bool complete = true;
+					for (int i = 0; i < 4; i++) {
+						v[i] = vertex[(around[i].z * m + around[i].y) * m + around[i].x];
+						complete = complete && v[i] >= 0;
+					}
+					if (!complete) continue;
+					if (d0 >= 0) std::swap(v[1], v[3]);
+					chunk.mesh.addTriangle(v[0], v[1], v[2]);
+					chunk.mesh.addTriangle(v[0], v[2], v[3]);
+				}
+			}
+		}
+	}
+}
+
+void SDFMesher::draw() const {
+	for (const Chunk &chunk : chunks) {
+		if (chunk.mesh.getNumIndices() > 0) chunk.mesh.draw();
+	}
+}
+
+bool SDFMesher::saveOBJ(const string &path) const {
+	ofstream out(ofToDataPath(path));
+	if (!out) return false;
+	out << "# " << vertexCount() << " vertices, " << triangleCount() << " triangles\n";
+	int offset = 1;
+	for (const Chunk &chunk : chunks) {
+		const ofMesh &mesh = chunk.mesh;
+		for (int i = 0; i < mesh.getNumVertices(); i++) {
+			glm::vec3 p = mesh.getVertex(i), n = mesh.getNormal(i);
+			out << "v " << p.x << " " << p.y << " " << p.z << "\n";
+			out << "vn " << n.x << " " << n.y << " " << n.z << "\n";
+		}
+		for (int i = 0; i + 2 < mesh.getNumIndices(); i += 3) {
+			out << "f";
+			for (int j = 0; j < 3; j++) {
+				int v = mesh.getIndex(i + j) + offset;
+				out << " " << v << "//" << v;
+			}
+			out << "\n";
+		}
+		offset += mesh.getNumVertices();
+	}
+	return (bool)out;
+}
+
+int SDFMesher::vertexCount() const {
+	int count = 0;
+	for (const Chunk &chunk : chunks) count += chunk.mesh.getNumVertices();
+	return count;
+}
+
+int SDFMesher::triangleCount() const {
+	int count = 0;
+	for (const Chunk &chunk : chunks) count += chunk.mesh.getNumIndices() / 3;
+	return count;
+}
+
+string SDFMesher::report() const {
+	stringstream ss;
+	ss << "mesh " << cells.x << "x" << cells.y << "x" << cells.z << " cells of " << cell << " in " << chunkCount() << " chunks, "
+		<< vertexCount() << " vertices, " << triangleCount() << " triangles, in " << seconds << " s";
+	return ss.str();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ofMain.h"
+
+class SceneObject;
+
+//  The scene's sdf turned into a triangle mesh, so the viewport can show
+//  what rayMarch() will render instead of a sphere for every torus and a
+//  flat plane for the pool.
+//
+//  The mesh is extracted with surface nets, the simplest of the dual
+//  methods dual contouring belongs to.  The scene is sampled at the corners
+//  of a grid of cells.  Every cell the surface passes through gets one
+//  vertex: the average of where its edges cross the surface, pulled onto the
+//  surface along the sdf gradient.  Every grid edge the surface crosses
+//  becomes a quad between the four cells around it.  There are no case
+//  tables, and the vertices are shared between the quads.
+//
+//  The grid is split into chunks of CHUNK^3 cells, each with its own mesh
+//  and a list of the objects that can reach into it.  update() finds the
+//  objects that moved, were added or were removed since the last build, or
+//  were passed to invalidate().  It then rebuilds only the chunks those
+//  objects were in or are in now.  Chunks are built in parallel, each
+//  sampling only its own objects through sdf8().
+//
+class SDFMesher {
+public:
+	static const int CHUNK = 16;
+
+	//  meshes scene over [min, max] with cells of cellSize, spread across
+	//  threads (0 uses every core)
+	//
+	void build(const vector<SceneObject *> &scene, glm::vec3 min, glm::vec3 max, float cellSize, int threads = 0);
+	void clear();
+
+	//  rebuilds what changed since the last build or update, returns the
+	//  number of chunks that were rebuilt
+	//
+	int update(const vector<SceneObject *> &scene, int threads = 0);
+
+	//  obj changed in a way that doesn't move it (a new radius), the next
+	//  update() rebuilds its chunks
+	//
+	void invalidate(const SceneObject *obj);
+
+	bool isBuilt() const { return !chunks.empty(); }
+	void draw() const;
+
+	//  writes the mesh as a Wavefront OBJ, positions and normals.  false if
+	//  the file couldn't be written
+	//
+	bool saveOBJ(const string &path) const;
+
+	//  what the last build or update cost and what the mesh holds
+	//
+	double buildSeconds() const { return seconds; }
+	int chunkCount() const { return (int)chunks.size(); }
+	int vertexCount() const;
+	int triangleCount() const;
+	string report() const;
+
+private:
+	struct Chunk {
+		glm::ivec3 first;						// its first cell in the grid
+		vector<const SceneObject *> objects;	// what could reach into it when it was built
+		ofMesh mesh;
+	};
+
+	struct Meshed {
+		const SceneObject *obj;
+		glm::vec3 position;						// where it was, see update()
+		bool dirty;
+	};
+
+	bool reaches(const SceneObject *obj, const Chunk &chunk) const;
+	void buildChunk(Chunk &chunk, const vector<SceneObject *> &scene) const;
+	void rebuild(const vector<int> &which, const vector<SceneObject *> &scene, int threads);
+
+	glm::vec3 origin;
+	float cell = 0;
+	glm::ivec3 cells = glm::ivec3(0);			// in the whole grid
+	glm::ivec3 chunkGrid = glm::ivec3(0);
+
+	vector<Chunk> chunks;
+	vector<Meshed> meshed;						// the scene as it was when last meshed
+	double seconds = 0;
+};
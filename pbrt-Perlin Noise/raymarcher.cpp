@@ -57,6 +57,13 @@ Bounds3f RayMarcher::ObjectBound() const {
 #define MAX_DISTANCE 100
 #define NORMAL_EPS .01
 
+STAT_COUNTER("RayMarcher/March steps", rayMarcherMarchSteps);
+STAT_COUNTER("RayMarcher/Over-relaxed steps backtracked", rayMarcherBacktracks);
+STAT_INT_DISTRIBUTION("RayMarcher/March steps per ray", rayMarcherStepsPerRay);
+STAT_COUNTER("RayMarcher/Rays hit", rayMarcherHits);
+STAT_COUNTER("RayMarcher/Rays escaped past maxdist", rayMarcherEscapes);
+STAT_COUNTER("RayMarcher/Rays out of steps", rayMarcherOutOfSteps);
+
 //  Template Method
 //
 bool RayMarcher::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
@@ -68,13 +75,31 @@ bool RayMarcher::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
     Vector3f dir = Normalize(r.d);  // ray direction vectors are not normalized
                                     // in PBRT by default (KMS)
     bool hit = false;
-	Float hitDist;
+	Float hitDist = 0;
 
 	//the ray marching algorithm
+	//with omega > 1 the steps are over-relaxed (Keinert et al. 2014): each one is
+	//omega * dist, and as long as the empty spheres around two points in a row
+	//overlap nothing was skipped between them.  when they don't the step went
+	//too far, so go back, take the plain step and stay with plain steps
     Point3f point = r.o;
+    Float w = omega;
+    Float step = 0, prevDist = 0;
+    bool escaped = false;
+    int steps = 0;
     for (int i = 0; i < (int)maxray; i++) {
         Float dist = sdf(point);  
-		hitDist = hitDist + dist;
+        ++rayMarcherMarchSteps;
+        steps++;
+        if (w > 1 && std::abs(dist) + prevDist < step)
+		{
+            ++rayMarcherBacktracks;
+            hitDist += prevDist - step;
+            point += dir*(prevDist - step);
+            step = prevDist;
+            w = 1;
+            continue;
+		}
         
         if (dist < distthres) 
 		{
@@ -83,14 +108,25 @@ bool RayMarcher::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
 		}
 		else if (dist > maxdist)
 		{
+            escaped = true;
             break;
 		}
 		else
 		{
-			point += dir*dist;
+			step = dist*w;
+			prevDist = dist;
+			hitDist += step;
+			point += dir*step;
 		}
     }
 
+	//how the march went, the distribution shows where the steps go and the
+	//counters how the rays ended
+	ReportValue(rayMarcherStepsPerRay, steps);
+	if (hit) ++rayMarcherHits;
+	else if (escaped) ++rayMarcherEscapes;
+	else ++rayMarcherOutOfSteps;
+
 	Vector3f dpdu = Vector3f(0, 0, 0);
 	Vector3f dpdv = Vector3f(0, 0, 0);
 
@@ -102,12 +138,17 @@ bool RayMarcher::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
 	float mult = 10 * (float)distthres;
 	Vector3f pError(mult*point.x, mult*point.y, mult*point.z);	//(10*(float)distthres)*(Vector3f)point
 
+	//pbrt has no AOV outputs, so with costuv the cost goes out through the uv
+	//instead and a "uv" texture on the material renders it as a heatmap
+	Point2f uv(0, 0);
+	if (costuv) uv = Point2f(steps / maxray, 0);
+
     if (hit && tHit != nullptr && isect != nullptr) {
         // Thiis where you return your SurfaceInteraction structure and your
         // tHit Important Note: You must check for null pointer as Intersect is
         // called by IntersectP() with null values for these parameters.
         *isect = (*ObjectToWorld)(
-            SurfaceInteraction(point, pError, Point2f(0, 0), -r.d, dpdu, dpdv,
+            SurfaceInteraction(point, pError, uv, -r.d, dpdu, dpdv,
                                Normal3f(0, 0, 0), Normal3f(0, 0, 0), r.time, this));
 		//*tHit = (Float)hitDist;
 		Vector3f distance = point - Point3f(0, 0, 0);
@@ -125,12 +166,27 @@ Float RayMarcher::sdf(const Point3f &pos) const {
     return distance.Length() - radius;
 }
 
-// Get Normal using Gradient (Finite Distances Methods )  - See class slides.
+//  sdf() and its gradient in one pass: the gradient of |p| - radius is the
+//  direction away from the center, zero at the center itself
+//
+Float RayMarcher::SdfGradient(const Point3f &pos, Vector3f *grad) const {
+    Vector3f v = pos - Point3f(0, 0, 0);
+    Float length = v.Length();
+    *grad = length > 0 ? v / length : Vector3f(0, 0, 0);
+    return length - radius;
+}
+
+// Get Normal using Gradient - analytic from SdfGradient(), with finite
+//  differences eps apart as the fallback where that has none.
 //  Note if the normal you calculate has zero length, return the defaultNormal
 //
 Vector3f RayMarcher::GetNormalRM(const Point3f &p, float eps,
                                  const Vector3f &defaultNormal) const {
 
+    Vector3f grad;
+    SdfGradient(p, &grad);
+    if (grad.Length() > 0) return Normalize(grad);
+
 	Float dp = sdf(p);
     Vector3f n(dp - sdf(Point3f(p.x - eps, p.y, p.z)),
                dp - sdf(Point3f(p.x, p.y - eps, p.z)),
@@ -174,8 +230,10 @@ std::shared_ptr<Shape> CreateRayMarcherShape(const Transform *o2w,
     Float distthres = params.FindOneFloat("distthres", 0.01);
     Float maxdist = params.FindOneFloat("maxdist", 100);
     Float eps = params.FindOneFloat("eps", 0.01);
+    Float omega = params.FindOneFloat("omega", 1);		// over-relaxation, 1 is plain sphere tracing
+    bool costuv = params.FindOneBool("costuv", false);	// march cost as uv, see Intersect()
     return std::make_shared<RayMarcher>(o2w, w2o, reverseOrientation, radius,
-                                        zmin, zmax, phimax, maxray, distthres, maxdist, eps);
+                                        zmin, zmax, phimax, maxray, distthres, maxdist, eps, omega, costuv);
 }
 
 }  // namespace pbrt
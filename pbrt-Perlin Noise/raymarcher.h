@@ -53,7 +53,7 @@ class RayMarcher : public Shape {
     // Sphere Public Methods
     RayMarcher(const Transform *ObjectToWorld, const Transform *WorldToObject,
            bool reverseOrientation, Float radius, Float zMin, Float zMax,
-           Float phiMax, Float maxray, Float distthres, Float maxdist, Float eps)
+           Float phiMax, Float maxray, Float distthres, Float maxdist, Float eps, Float omega, bool costuv)
         : Shape(ObjectToWorld, WorldToObject, reverseOrientation),
           radius(radius),
           zMin(Clamp(std::min(zMin, zMax), -radius, radius)),
@@ -64,7 +64,9 @@ class RayMarcher : public Shape {
 		  maxray(maxray),
 		  distthres(distthres),
 		  maxdist(maxdist),
-		  eps(eps){}
+		  eps(eps),
+		  omega(omega),
+		  costuv(costuv){}
 
     Bounds3f ObjectBound() const;
     bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
@@ -73,6 +75,7 @@ class RayMarcher : public Shape {
                              const Vector3f &defaultNormal) const;
 
     Float sdf(const Point3f &pos) const;
+    Float SdfGradient(const Point3f &pos, Vector3f *grad) const;
     Float Area() const;
     Interaction Sample(const Point2f &u, Float *pdf) const;
     Interaction Sample(const Interaction &ref, const Point2f &u,
@@ -84,6 +87,8 @@ class RayMarcher : public Shape {
     const Float zMin, zMax;
     const Float thetaMin, thetaMax, phiMax;
     const Float maxray, distthres, maxdist, eps;
+    const Float omega;		// step factor for over-relaxed marching
+    const bool costuv;		// hits report (steps / maxray, 0) as their uv, for a march cost AOV
 };
 
 std::shared_ptr<Shape> CreateRayMarcherShape(const Transform *o2w,
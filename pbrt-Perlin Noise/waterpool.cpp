@@ -41,6 +41,11 @@
 #include "sampling.h"
 #include "stats.h"
 
+#if defined(__AVX2__) && !defined(PBRT_FLOAT_AS_DOUBLE)
+#include <immintrin.h>
+#define WATERPOOL_NOISE8
+#endif
+
 namespace pbrt {
 
 // Sphere Method Definitions
@@ -56,6 +61,14 @@ Bounds3f WaterPool::ObjectBound() const {
 #define DIST_THRESHOLD .01
 #define MAX_DISTANCE 100
 #define NORMAL_EPS .01
+#define WATER_LEVEL -2
+
+STAT_COUNTER("WaterPool/March steps", waterPoolMarchSteps);
+STAT_COUNTER("WaterPool/Over-relaxed steps backtracked", waterPoolBacktracks);
+STAT_INT_DISTRIBUTION("WaterPool/March steps per ray", waterPoolStepsPerRay);
+STAT_COUNTER("WaterPool/Rays hit", waterPoolHits);
+STAT_COUNTER("WaterPool/Rays escaped past maxdist", waterPoolEscapes);
+STAT_COUNTER("WaterPool/Rays out of steps", waterPoolOutOfSteps);
 
 //  Template Method
 //
@@ -68,9 +81,34 @@ bool WaterPool::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
 	
 
 	//the ray marching algorithm
+	//with omega > 1 the steps are over-relaxed (Keinert et al. 2014): each one is
+	//omega * dist, and as long as the empty spheres around two points in a row
+	//overlap nothing was skipped between them.  when they don't the step went
+	//too far, so go back, take the plain step and stay with plain steps
+	//
+	//the gradient of sdf() is longer than 1 wherever the noise slopes, so a
+	//step of dist can go through a crest.  with the lipschitz param dist is
+	//divided by the most it can change per unit, and above the highest the
+	//noise reaches the height over that is the longer safe step
     Point3f point = r.o;
+    Float w = omega;
+    Float step = 0, prevDist = 0;
+    bool escaped = false;
+    int steps = 0;
     for (int i = 0; i < (int)maxray; i++) {
         Float dist = sdf(point);  
+        if (lipschitz > 1)
+            dist = std::max(dist / lipschitz, point.y - (WATER_LEVEL + noise.Bound()));
+        ++waterPoolMarchSteps;
+        steps++;
+        if (w > 1 && std::abs(dist) + prevDist < step)
+		{
+            ++waterPoolBacktracks;
+            point += dir*(prevDist - step);
+            step = prevDist;
+            w = 1;
+            continue;
+		}
         
         if (dist < distthres) 
 		{
@@ -79,14 +117,24 @@ bool WaterPool::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
 		}
 		else if (dist > maxdist)
 		{
+            escaped = true;
             break;
 		}
 		else
 		{
-			point += dir*dist;
+			step = dist*w;
+			prevDist = dist;
+			point += dir*step;
 		}
     }
 
+	//how the march went, the distribution shows where the steps go and the
+	//counters how the rays ended
+	ReportValue(waterPoolStepsPerRay, steps);
+	if (hit) ++waterPoolHits;
+	else if (escaped) ++waterPoolEscapes;
+	else ++waterPoolOutOfSteps;
+
 	Vector3f dpdu = Vector3f(0, 0, 0);
 	Vector3f dpdv = Vector3f(0, 0, 0);
     Vector3f defaultNorm = Normalize(Vector3f(0, 1, 0));
@@ -96,12 +144,17 @@ bool WaterPool::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
 	float mult = 10 * (float)distthres;
 	Vector3f pError(mult*point.x, mult*point.y, mult*point.z);	//(10*(float)distthres)*(Vector3f)point
 
+	//pbrt has no AOV outputs, so with costuv the cost goes out through the uv
+	//instead and a "uv" texture on the material renders it as a heatmap
+	Point2f uv(0, 0);
+	if (costuv) uv = Point2f(steps / maxray, 0);
+
     if (hit && tHit != nullptr && isect != nullptr) {
         // Thiis where you return your SurfaceInteraction structure and your
         // tHit Important Note: You must check for null pointer as Intersect is
         // called by IntersectP() with null values for these parameters.
         *isect = (*ObjectToWorld)(
-            SurfaceInteraction(point, pError, Point2f(0, 0), -r.d, dpdu, dpdv,
+            SurfaceInteraction(point, pError, uv, -r.d, dpdu, dpdv,
                                Normal3f(0, 0, 0), Normal3f(0, 0, 0), r.time, this));
 		
 		Vector3f distance = point - Point3f(0, 0, 0);
@@ -114,25 +167,251 @@ bool WaterPool::Intersect(const Ray &r, Float *tHit, SurfaceInteraction *isect,
 //  Template Method
 //
 Float WaterPool::sdf(const Point3f &pos) const {
-	Float noise = 0;
-	Point3f located = Point3f(0, -2, 0);		//the location of the waterpool
-	Float ampl = amplitude;
-	Float freq = frequency;
-	for (int i = 0; i < octave; i++)
+	Point3f located = Point3f(0, WATER_LEVEL, 0);		//the location of the waterpool
+	return pos.y - (located.y + noise.Evaluate(pos));
+}
+
+//  Noise() along with its gradient.  pbrt keeps the permutation table and
+//  Grad() private to core/texture.cpp, so these are copies of both; the
+//  value comes out the same as Noise(p)
+//
+static const int GradNoisePermSize = 256;
+static const int GradNoisePerm[2 * GradNoisePermSize] = {
+    151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+    140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+    247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+    57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+    74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+    60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+    65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+    200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+    52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+    207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+    119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+    129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+    81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+    184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+    222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+    // the same again, so corner + 1 needs no wrapping
+    151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+    140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+    247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+    57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+    74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+    60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+    65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+    200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+    52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+    207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+    119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+    129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+    81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+    184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+    222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+};
+
+// Grad() for one corner, and the corner's gradient vector in *g
+static Float GradCorner(int x, int y, int z, Float dx, Float dy, Float dz,
+                        Vector3f *g) {
+    int h = GradNoisePerm[GradNoisePerm[GradNoisePerm[x] + y] + z];
+    h &= 15;
+    bool uIsX = h < 8 || h == 12 || h == 13;
+    bool vIsY = h < 4 || h == 12 || h == 13;
+    Float su = (h & 1) ? -1 : 1, sv = (h & 2) ? -1 : 1;
+    *g = Vector3f(uIsX ? su : 0, uIsX ? 0 : su, 0);
+    if (vIsY) g->y += sv;
+    else g->z += sv;
+    return g->x * dx + g->y * dy + g->z * dz;
+}
+
+static Float NoiseWeight(Float t) {
+    Float t3 = t * t * t;
+    Float t4 = t3 * t;
+    return 6 * t4 * t - 15 * t4 + 10 * t3;
+}
+
+#ifdef WATERPOOL_NOISE8
+
+// Noise() of eight points at once, a point per lane, with the same steps in
+// the same order so the lanes come out exactly as Noise() would
+static __m256 NoiseWeight8(__m256 t) {
+    __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    __m256 t4 = _mm256_mul_ps(t3, t);
+    return _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(6), t4), t),
+                                       _mm256_mul_ps(_mm256_set1_ps(15), t4)),
+                         _mm256_mul_ps(_mm256_set1_ps(10), t3));
+}
+
+static __m256 Lerp8(__m256 t, __m256 v1, __m256 v2) {
+    return _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(1), t), v1), _mm256_mul_ps(t, v2));
+}
+
+static __m256i Perm8(__m256i i) { return _mm256_i32gather_epi32(GradNoisePerm, i, 4); }
+
+// Grad() for a corner per lane, h is the corner's hash
+static __m256 Grad8(__m256i h, __m256 dx, __m256 dy, __m256 dz) {
+    h = _mm256_and_si256(h, _mm256_set1_epi32(15));
+    __m256i is12or13 = _mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+                                       _mm256_cmpeq_epi32(h, _mm256_set1_epi32(13)));
+    __m256i uIsX = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h), is12or13);
+    __m256i vIsY = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h), is12or13);
+    __m256 u = _mm256_blendv_ps(dy, dx, _mm256_castsi256_ps(uIsX));
+    __m256 v = _mm256_blendv_ps(dz, dy, _mm256_castsi256_ps(vIsY));
+
+    // bits 0 and 1 of h flip the signs of u and v
+    __m256 su = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    __m256 sv = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+    return _mm256_add_ps(_mm256_xor_ps(u, su), _mm256_xor_ps(v, sv));
+}
+
+static void Noise8(const Float *x, const Float *y, const Float *z, Float *out) {
+    __m256 px = _mm256_loadu_ps(x), py = _mm256_loadu_ps(y), pz = _mm256_loadu_ps(z);
+    __m256 fx = _mm256_floor_ps(px), fy = _mm256_floor_ps(py), fz = _mm256_floor_ps(pz);
+    __m256 dx = _mm256_sub_ps(px, fx), dy = _mm256_sub_ps(py, fy), dz = _mm256_sub_ps(pz, fz);
+    __m256i mask = _mm256_set1_epi32(GradNoisePermSize - 1);
+    __m256i ix = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+    __m256i iy = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+    __m256i iz = _mm256_and_si256(_mm256_cvttps_epi32(fz), mask);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256 onef = _mm256_set1_ps(1);
+
+    // the corner values, indexed by (x, y, z) bits as in NoiseGradient()
+    __m256 w[8];
+    for (int c = 0; c < 8; c++) {
+        int cx = c & 1, cy = (c >> 1) & 1, cz = c >> 2;
+        __m256i h = Perm8(_mm256_add_epi32(Perm8(_mm256_add_epi32(Perm8(cx ? _mm256_add_epi32(ix, one) : ix),
+                                                                  cy ? _mm256_add_epi32(iy, one) : iy)),
+                                           cz ? _mm256_add_epi32(iz, one) : iz));
+        w[c] = Grad8(h, cx ? _mm256_sub_ps(dx, onef) : dx, cy ? _mm256_sub_ps(dy, onef) : dy,
+                     cz ? _mm256_sub_ps(dz, onef) : dz);
+    }
+
+    __m256 wx = NoiseWeight8(dx), wy = NoiseWeight8(dy), wz = NoiseWeight8(dz);
+    __m256 x00 = Lerp8(wx, w[0], w[1]), x10 = Lerp8(wx, w[2], w[3]);
+    __m256 x01 = Lerp8(wx, w[4], w[5]), x11 = Lerp8(wx, w[6], w[7]);
+    __m256 y0 = Lerp8(wy, x00, x10), y1 = Lerp8(wy, x01, x11);
+    _mm256_storeu_ps(out, Lerp8(wz, y0, y1));
+}
+
+#endif  // WATERPOOL_NOISE8
+
+// a bound on how much Noise() changes per unit.  inside a cell it is the sum
+// over the corners of W * g.d, W the product of the three NoiseWeight()s and
+// d the offset from the corner, so its gradient is sum W g + sum grad(W) g.d.
+// the first is an average of the corner gradients, all sqrt(2) long.  along
+// each axis the second is NoiseWeight'(t) <= 1.875 times the difference of
+// two g.d, each at most 2 (two of g's components are +-1, the third 0, and
+// every |d| component is at most 1), so at most 1.875 * 4 per axis and
+// sqrt(3) times that in all: sqrt(2) + 12.99 = 14.40.  hill climbing never
+// found a gradient over 3.39, but that is no bound.  an octave's slope is at
+// most this times its weight and scale, the fBm's at most the sum of those
+#define NOISE_SLOPE 14.41
+
+WaterPoolNoise::WaterPoolNoise(Float amplitude, Float frequency, int octaves) {
+    for (int i = 0; i < octaves; i++) {
+        scale.push_back(frequency);
+        weight.push_back(amplitude / 2);
+        bound += amplitude / 2;
+        slope += NOISE_SLOPE * (amplitude / 2) * frequency;
+        amplitude /= 2;
+        frequency *= 2;
+    }
+}
+
+Float WaterPoolNoise::Evaluate(const Point3f &p) const {
+    Float noise = 0;
+#ifdef WATERPOOL_NOISE8
+    alignas(32) Float x[8], y[8], z[8], n[8];
+    for (int first = 0; first < Octaves(); first += 8) {
+        // lanes past the last octave repeat it and are left out of the sum
+        int lanes = std::min(8, Octaves() - first);
+        for (int i = 0; i < 8; i++) {
+            Float s = scale[first + std::min(i, lanes - 1)];
+            x[i] = s * p.x;
+            y[i] = s * p.y;
+            z[i] = s * p.z;
+        }
+        Noise8(x, y, z, n);
+        for (int i = 0; i < lanes; i++) noise += weight[first + i] * n[i];
+    }
+#else
+    for (int i = 0; i < Octaves(); i++) noise += weight[i] * Noise(scale[i] * p);
+#endif
+    return noise;
+}
+
+static Float NoiseWeightDerivative(Float t) {
+    return 30 * t * t * (t - 1) * (t - 1);
+}
+
+static Float NoiseGradient(const Point3f &p, Vector3f *grad) {
+    // Compute noise cell coordinates and offsets
+    int ix = std::floor(p.x), iy = std::floor(p.y), iz = std::floor(p.z);
+    Float dx = p.x - ix, dy = p.y - iy, dz = p.z - iz;
+    ix &= GradNoisePermSize - 1;
+    iy &= GradNoisePermSize - 1;
+    iz &= GradNoisePermSize - 1;
+
+    // the corner values w and their gradients g, indexed by (x, y, z) bits
+    Float w[8];
+    Vector3f g[8];
+    for (int c = 0; c < 8; c++) {
+        int cx = c & 1, cy = (c >> 1) & 1, cz = c >> 2;
+        w[c] = GradCorner(ix + cx, iy + cy, iz + cz, dx - cx, dy - cy, dz - cz, &g[c]);
+    }
+
+    // trilinear interpolation, as Noise() does it, with the product rule for
+    // the weights
+    Float wx = NoiseWeight(dx), wy = NoiseWeight(dy), wz = NoiseWeight(dz);
+    Float x00 = Lerp(wx, w[0], w[1]), x10 = Lerp(wx, w[2], w[3]);
+    Float x01 = Lerp(wx, w[4], w[5]), x11 = Lerp(wx, w[6], w[7]);
+    Float y0 = Lerp(wy, x00, x10), y1 = Lerp(wy, x01, x11);
+
+    Vector3f gx00 = g[0] * (1 - wx) + g[1] * wx, gx10 = g[2] * (1 - wx) + g[3] * wx;
+    Vector3f gx01 = g[4] * (1 - wx) + g[5] * wx, gx11 = g[6] * (1 - wx) + g[7] * wx;
+    Vector3f gy0 = gx00 * (1 - wy) + gx10 * wy, gy1 = gx01 * (1 - wy) + gx11 * wy;
+    *grad = gy0 * (1 - wz) + gy1 * wz;
+
+    Float dwx = NoiseWeightDerivative(dx), dwy = NoiseWeightDerivative(dy),
+          dwz = NoiseWeightDerivative(dz);
+    grad->x += dwx * Lerp(wz, Lerp(wy, w[1] - w[0], w[3] - w[2]),
+                              Lerp(wy, w[5] - w[4], w[7] - w[6]));
+    grad->y += dwy * Lerp(wz, x10 - x00, x11 - x01);
+    grad->z += dwz * (y1 - y0);
+    return Lerp(wz, y0, y1);
+}
+
+//  sdf() and its gradient in one pass, every octave's noise comes with its
+//  gradient from NoiseGradient() instead of three more sdf() calls for the
+//  finite differences
+//
+Float WaterPool::SdfGradient(const Point3f &pos, Vector3f *grad) const {
+	Float value = 0;
+	Vector3f noiseGrad(0, 0, 0);
+	Point3f located = Point3f(0, WATER_LEVEL, 0);		//the location of the waterpool
+	for (int i = 0; i < noise.Octaves(); i++)
 	{
-		noise += ampl/2 * (Noise(freq * pos));
-		ampl /= 2;
-		freq *= 2;
+		Vector3f g;
+		value += noise.Weight(i) * NoiseGradient(noise.Scale(i) * pos, &g);
+		noiseGrad += g * (noise.Weight(i) * noise.Scale(i));
 	}
-	return pos.y - (located.y + noise);
+	*grad = Vector3f(0, 1, 0) - noiseGrad;
+	return pos.y - (located.y + value);
 }
 
-// Get Normal using Gradient (Finite Distances Methods )  - See class slides.
+// Get Normal using Gradient - analytic from SdfGradient(), with finite
+//  differences eps apart as the fallback where that has none.
 //  Note if the normal you calculate has zero length, return the defaultNormal
 //
 Vector3f WaterPool::GetNormalRM(const Point3f &p, float eps,
                                  const Vector3f &defaultNormal) const {
 
+    Vector3f grad;
+    SdfGradient(p, &grad);
+    if (grad.Length() > 0) return Normalize(grad);
+
 	Float dp = sdf(p);
     Vector3f n(dp - sdf(Point3f(p.x - eps, p.y, p.z)),
                dp - sdf(Point3f(p.x, p.y - eps, p.z)),
@@ -176,11 +455,14 @@ std::shared_ptr<Shape> CreateWaterPoolShape(const Transform *o2w,
     Float distthres = params.FindOneFloat("distthres", 0.01);
     Float maxdist = params.FindOneFloat("maxdist", 100);
     Float eps = params.FindOneFloat("eps", 0.01);
+    Float omega = params.FindOneFloat("omega", 1);		// over-relaxation, 1 is plain sphere tracing
+    bool costuv = params.FindOneBool("costuv", false);	// march cost as uv, see Intersect()
+    bool lipschitz = params.FindOneBool("lipschitz", false);	// steps scaled to the noise's slope, see Intersect()
 	Float amplitude = params.FindOneFloat("amplitude", 3.0);
 	Float frequency = params.FindOneFloat("frequency", 0.08);
 	int octave = params.FindOneInt("octave", 8);
     return std::make_shared<WaterPool>(o2w, w2o, reverseOrientation, radius,
-                                        zmin, zmax, phimax, maxray, distthres, maxdist, eps, amplitude, frequency, octave);
+                                        zmin, zmax, phimax, maxray, distthres, maxdist, eps, amplitude, frequency, octave, omega, costuv, lipschitz);
 }
 
 }  // namespace pbrt
@@ -47,13 +47,37 @@
 
 namespace pbrt {
 
+// The octaves of fBm the pool is displaced by: Noise() at doubling
+// frequencies and halving amplitudes.  Each octave's frequency (Scale()) and
+// the weight of its noise are worked out once when the shape is created and
+// never change after.  Evaluate() puts the octaves of one point in the lanes
+// of an 8 wide AVX2 Noise() (Noise8() in waterpool.cpp), and adds them up in
+// the same order as the plain loop, so the result is the same.
+class WaterPoolNoise {
+  public:
+    WaterPoolNoise(Float amplitude, Float frequency, int octaves);
+
+    int Octaves() const { return (int)scale.size(); }
+    Float Scale(int i) const { return scale[i]; }
+    Float Weight(int i) const { return weight[i]; }
+    Float Bound() const { return bound; }  // sum of the weights, |Evaluate()| stays under it
+    Float Lipschitz() const { return slope; }  // the most Evaluate() changes per unit, see NOISE_SLOPE
+
+    Float Evaluate(const Point3f &p) const;
+
+  private:
+    std::vector<Float> scale, weight;
+    Float bound = 0;
+    Float slope = 0;
+};
+
 // Sphere Declarations
 class WaterPool : public Shape {
   public:
     // Sphere Public Methods
     WaterPool(const Transform *ObjectToWorld, const Transform *WorldToObject,
            bool reverseOrientation, Float radius, Float zMin, Float zMax,
-           Float phiMax, Float maxray, Float distthres, Float maxdist, Float eps, Float amplitude, Float frequency, int octave)
+           Float phiMax, Float maxray, Float distthres, Float maxdist, Float eps, Float amplitude, Float frequency, int octave, Float omega, bool costuv, bool lipschitz)
         : Shape(ObjectToWorld, WorldToObject, reverseOrientation),
           radius(radius),
           zMin(Clamp(std::min(zMin, zMax), -radius, radius)),
@@ -65,9 +89,10 @@ class WaterPool : public Shape {
 		  distthres(distthres),
 		  maxdist(maxdist),
 		  eps(eps),
-		  amplitude(amplitude),
-		  frequency(frequency),
-		  octave(octave){}
+		  noise(amplitude, frequency, octave),
+		  lipschitz(lipschitz ? 1 + noise.Lipschitz() : 1),
+		  omega(omega),
+		  costuv(costuv){}
 
     Bounds3f ObjectBound() const;
     bool Intersect(const Ray &ray, Float *tHit, SurfaceInteraction *isect,
@@ -76,6 +101,7 @@ class WaterPool : public Shape {
                              const Vector3f &defaultNormal) const;
 
     Float sdf(const Point3f &pos) const;
+    Float SdfGradient(const Point3f &pos, Vector3f *grad) const;
     Float Area() const;
     Interaction Sample(const Point2f &u, Float *pdf) const;
     Interaction Sample(const Interaction &ref, const Point2f &u,
@@ -87,8 +113,10 @@ class WaterPool : public Shape {
     const Float zMin, zMax;
     const Float thetaMin, thetaMax, phiMax;
     const Float maxray, distthres, maxdist, eps;
-	const int octave;
-	Float amplitude, frequency;
+	const WaterPoolNoise noise;
+    const Float lipschitz;	// sdf() is divided by this before stepping, 1 steps it as it is
+    const Float omega;		// step factor for over-relaxed marching
+    const bool costuv;		// hits report (steps / maxray, 0) as their uv, for a march cost AOV
 };
 
 std::shared_ptr<Shape> CreateWaterPoolShape(const Transform *o2w,